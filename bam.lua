@@ -141,15 +141,17 @@ function GenerateMacOSXSettings(settings, conf, arch, compiler)
 	-- Build server launcher before adding game stuff
 	local serverlaunch = Link(settings, "serverlaunch", Compile(settings, "src/osxlaunch/server.m"))
 
-	-- Master server, version server and tools
+	-- Master server, version server
 	BuildEngineCommon(settings)
 	BuildMasterserver(settings)
 	BuildVersionserver(settings)
-	BuildTools(settings)
 
 	-- Add requirements for Server & Client
 	BuildGameCommon(settings)
 
+	-- Tools, they may use the game protocol
+	BuildTools(settings)
+
 	-- Server
 	settings.link.frameworks:Add("Cocoa")
 	local server_exe = BuildServer(settings)
@@ -185,15 +187,17 @@ function GenerateLinuxSettings(settings, conf, arch, compiler)
 
 	GenerateCommonSettings(settings, conf, arch, compiler)
 
-	-- Master server, version server and tools
+	-- Master server, version server
 	BuildEngineCommon(settings)
-	BuildTools(settings)
 	BuildMasterserver(settings)
 	BuildVersionserver(settings)
 
 	-- Add requirements for Server & Client
 	BuildGameCommon(settings)
 
+	-- Tools, they may use the game protocol
+	BuildTools(settings)
+
 	-- Server
 	BuildServer(settings)
 
@@ -245,15 +249,17 @@ function GenerateWindowsSettings(settings, conf, target_arch, compiler)
 
 	GenerateCommonSettings(settings, conf, target_arch, compiler)
 
-	-- Master server, version server and tools
+	-- Master server, version server
 	BuildEngineCommon(settings)
 	BuildMasterserver(settings)
 	BuildVersionserver(settings)
-	BuildTools(settings)
 
 	-- Add requirements for Server & Client
 	BuildGameCommon(settings)
 
+	-- Tools, they may use the game protocol
+	BuildTools(settings)
+
 	-- Server
 	local server_settings = settings:Copy()
 	server_settings.link.extrafiles:Add(icons.server)
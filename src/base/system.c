@@ -1,5 +1,9 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+	#define _GNU_SOURCE /* recvmmsg, sendmmsg */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -27,6 +31,10 @@
 
 	#include <dirent.h>
 
+	#if defined(__linux__)
+		#include <sys/inotify.h>
+	#endif
+
 	#if defined(CONF_PLATFORM_MACOSX)
 		#include <Carbon/Carbon.h>
 	#endif
@@ -39,6 +47,8 @@
 	#include <fcntl.h>
 	#include <direct.h>
 	#include <errno.h>
+	#include <sys/types.h>
+	#include <sys/stat.h>
 	#include <wincrypt.h>
 #else
 	#error NOT IMPLEMENTED
@@ -256,14 +266,19 @@ typedef struct MEMTAIL
 
 static struct MEMHEADER *first = 0;
 static const int MEM_GUARD_VAL = 0xbaadc0de;
+static MEMSTATS memory_stats = {0};
 
 void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned alignment)
 {
+	memory_stats.total_allocations++;
+	memory_stats.active_allocations++;
 	return malloc(size);
 }
 
 void mem_free(void *p)
 {
+	if(p)
+		memory_stats.active_allocations--;
 	free(p);
 }
 
@@ -277,6 +292,11 @@ void mem_move(void *dest, const void *source, unsigned size)
 	memmove(dest, source, size);
 }
 
+const MEMSTATS *mem_stats()
+{
+	return &memory_stats;
+}
+
 void mem_zero(void *block,unsigned size)
 {
 	memset(block, 0, size);
@@ -499,6 +519,29 @@ void thread_detach(void *thread)
 #endif
 }
 
+int thread_num_cpus()
+{
+#if defined(CONF_FAMILY_UNIX)
+	long num = sysconf(_SC_NPROCESSORS_ONLN);
+	return num > 0 ? (int)num : 1;
+#elif defined(CONF_FAMILY_WINDOWS)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+	#error not implemented
+#endif
+}
+
+void sync_barrier()
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
 
 
 
@@ -569,20 +612,43 @@ void lock_unlock(LOCK lock)
 #endif
 }
 
-#if !defined(CONF_PLATFORM_MACOSX)
-	#if defined(CONF_FAMILY_UNIX)
+#if defined(CONF_PLATFORM_MACOSX)
+	void semaphore_init(SEMAPHORE *sem) { *sem = dispatch_semaphore_create(0); }
+	void semaphore_wait(SEMAPHORE *sem) { dispatch_semaphore_wait(*sem, DISPATCH_TIME_FOREVER); }
+	int semaphore_wait_timeout(SEMAPHORE *sem, int ms) { return dispatch_semaphore_wait(*sem, dispatch_time(DISPATCH_TIME_NOW, (int64_t)ms*NSEC_PER_MSEC)) == 0; }
+	void semaphore_signal(SEMAPHORE *sem) { dispatch_semaphore_signal(*sem); }
+	void semaphore_destroy(SEMAPHORE *sem) { dispatch_release(*sem); }
+#elif defined(CONF_FAMILY_UNIX)
 	void semaphore_init(SEMAPHORE *sem) { sem_init(sem, 0, 0); }
 	void semaphore_wait(SEMAPHORE *sem) { sem_wait(sem); }
+	int semaphore_wait_timeout(SEMAPHORE *sem, int ms)
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += ms/1000;
+		ts.tv_nsec += (ms%1000)*1000000;
+		if(ts.tv_nsec >= 1000000000)
+		{
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		while(sem_timedwait(sem, &ts) != 0)
+		{
+			if(errno != EINTR)
+				return 0;
+		}
+		return 1;
+	}
 	void semaphore_signal(SEMAPHORE *sem) { sem_post(sem); }
 	void semaphore_destroy(SEMAPHORE *sem) { sem_destroy(sem); }
-	#elif defined(CONF_FAMILY_WINDOWS)
-	void semaphore_init(SEMAPHORE *sem) { *sem = CreateSemaphore(0, 0, 10000, 0); }
+#elif defined(CONF_FAMILY_WINDOWS)
+	void semaphore_init(SEMAPHORE *sem) { *sem = CreateSemaphore(0, 0, 0x7fffffff, 0); }
 	void semaphore_wait(SEMAPHORE *sem) { WaitForSingleObject((HANDLE)*sem, INFINITE); }
+	int semaphore_wait_timeout(SEMAPHORE *sem, int ms) { return WaitForSingleObject((HANDLE)*sem, ms) == WAIT_OBJECT_0; }
 	void semaphore_signal(SEMAPHORE *sem) { ReleaseSemaphore((HANDLE)*sem, 1, NULL); }
 	void semaphore_destroy(SEMAPHORE *sem) { CloseHandle((HANDLE)*sem); }
-	#else
-		#error not implemented on this platform
-	#endif
+#else
+	#error not implemented on this platform
 #endif
 
 
@@ -1146,6 +1212,152 @@ int net_udp_close(NETSOCKET sock)
 	return priv_net_close_all_sockets(sock);
 }
 
+#if defined(CONF_PLATFORM_LINUX)
+static int priv_net_send_batch(int socket, const NETPACKET *packets, int num)
+{
+	struct mmsghdr msgs[NET_BATCH_MAX_PACKETS];
+	struct iovec iovecs[NET_BATCH_MAX_PACKETS];
+	struct sockaddr_in6 addrs[NET_BATCH_MAX_PACKETS];
+	int i, done = 0, sent = 0;
+
+	mem_zero(msgs, sizeof(struct mmsghdr)*num);
+	for(i = 0; i < num; i++)
+	{
+		if(packets[i].addr.type == NETTYPE_IPV4)
+		{
+			netaddr_to_sockaddr_in(&packets[i].addr, (struct sockaddr_in *)&addrs[i]);
+			msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		}
+		else
+		{
+			netaddr_to_sockaddr_in6(&packets[i].addr, &addrs[i]);
+			msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+		}
+		iovecs[i].iov_base = packets[i].data;
+		iovecs[i].iov_len = packets[i].size;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while(done < num)
+	{
+		int result = sendmmsg(socket, &msgs[done], num-done, 0);
+		if(result <= 0)
+		{
+			if(result < 0 && errno == EINTR)
+				continue;
+			done++; /* skip the packet that failed, like net_udp_send does */
+			continue;
+		}
+		for(i = done; i < done+result; i++)
+		{
+			network_stats.sent_bytes += packets[i].size;
+			network_stats.sent_packets++;
+		}
+		done += result;
+		sent += result;
+	}
+	return sent;
+}
+#endif
+
+int net_udp_send_batch(NETSOCKET sock, const NETPACKET *packets, int num)
+{
+#if defined(CONF_PLATFORM_LINUX)
+	int i = 0;
+	int sent = 0;
+	while(i < num)
+	{
+		/* send runs of packets that go through the same socket together,
+			broadcasts take the normal path */
+		int type = packets[i].addr.type;
+		int socket = type == NETTYPE_IPV4 ? sock.ipv4sock : type == NETTYPE_IPV6 ? sock.ipv6sock : -1;
+		int end = i+1;
+
+		if(socket < 0)
+		{
+			if(net_udp_send(sock, &packets[i].addr, packets[i].data, packets[i].size) >= 0)
+				sent++;
+			i++;
+			continue;
+		}
+
+		while(end < num && end-i < NET_BATCH_MAX_PACKETS && packets[end].addr.type == (unsigned)type)
+			end++;
+		sent += priv_net_send_batch(socket, &packets[i], end-i);
+		i = end;
+	}
+	return sent;
+#else
+	int i, sent = 0;
+	for(i = 0; i < num; i++)
+	{
+		if(net_udp_send(sock, &packets[i].addr, packets[i].data, packets[i].size) >= 0)
+			sent++;
+	}
+	return sent;
+#endif
+}
+
+#if defined(CONF_PLATFORM_LINUX)
+static int priv_net_recv_batch(int socket, NETPACKET *packets, int num, int maxsize)
+{
+	struct mmsghdr msgs[NET_BATCH_MAX_PACKETS];
+	struct iovec iovecs[NET_BATCH_MAX_PACKETS];
+	struct sockaddr_in6 addrs[NET_BATCH_MAX_PACKETS];
+	int i, received;
+
+	if(num > NET_BATCH_MAX_PACKETS)
+		num = NET_BATCH_MAX_PACKETS;
+
+	mem_zero(msgs, sizeof(struct mmsghdr)*num);
+	for(i = 0; i < num; i++)
+	{
+		iovecs[i].iov_base = packets[i].data;
+		iovecs[i].iov_len = maxsize;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	received = recvmmsg(socket, msgs, num, MSG_DONTWAIT, NULL);
+	if(received <= 0)
+		return 0;
+
+	for(i = 0; i < received; i++)
+	{
+		sockaddr_to_netaddr((struct sockaddr *)&addrs[i], &packets[i].addr);
+		packets[i].size = msgs[i].msg_len;
+		network_stats.recv_bytes += msgs[i].msg_len;
+		network_stats.recv_packets++;
+	}
+	return received;
+}
+#endif
+
+int net_udp_recv_batch(NETSOCKET sock, NETPACKET *packets, int num, int maxsize)
+{
+	int received = 0;
+#if defined(CONF_PLATFORM_LINUX)
+	if(sock.ipv4sock >= 0)
+		received += priv_net_recv_batch(sock.ipv4sock, packets, num, maxsize);
+	if(received < num && sock.ipv6sock >= 0)
+		received += priv_net_recv_batch(sock.ipv6sock, &packets[received], num-received, maxsize);
+#else
+	while(received < num)
+	{
+		int bytes = net_udp_recv(sock, &packets[received].addr, packets[received].data, maxsize);
+		if(bytes <= 0)
+			break;
+		packets[received].size = bytes;
+		received++;
+	}
+#endif
+	return received;
+}
+
 NETSOCKET net_tcp_create(NETADDR bindaddr)
 {
 	NETSOCKET sock = invalid_socket;
@@ -1582,6 +1794,117 @@ int fs_rename(const char *oldname, const char *newname)
 	return 0;
 }
 
+struct FS_WATCH
+{
+	char filename[512];
+	const char *basename;
+	int fd; /* inotify descriptor, -1 when polling */
+	time_t modified;
+};
+
+static time_t fs_modified_time(const char *filename)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	struct _stat sb;
+	if(_stat(filename, &sb) != 0)
+		return 0;
+#else
+	struct stat sb;
+	if(stat(filename, &sb) != 0)
+		return 0;
+#endif
+	return sb.st_mtime;
+}
+
+FS_WATCH *fs_watch_create(const char *filename)
+{
+	FS_WATCH *watch = (FS_WATCH *)mem_alloc(sizeof(FS_WATCH), 1);
+	const char *p;
+	if(!watch)
+		return 0;
+
+	str_copy(watch->filename, filename, sizeof(watch->filename));
+	watch->basename = watch->filename;
+	for(p = watch->filename; *p; p++)
+	{
+		if(*p == '/' || *p == '\\')
+			watch->basename = p+1;
+	}
+	watch->fd = -1;
+	watch->modified = fs_modified_time(filename);
+
+#if defined(__linux__)
+	watch->fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+	if(watch->fd >= 0)
+	{
+		/* watch the directory, editors tend to replace the file instead of writing it.
+		   a created file is still empty, it counts once it was closed or moved in */
+		char dir[512];
+		int len = (int)(watch->basename - watch->filename);
+		if(len == 0)
+			str_copy(dir, ".", sizeof(dir));
+		else if(len == 1)
+			str_copy(dir, "/", sizeof(dir));
+		else
+			str_copy(dir, watch->filename, len < (int)sizeof(dir) ? len : (int)sizeof(dir));
+		if(inotify_add_watch(watch->fd, dir, IN_CLOSE_WRITE|IN_MOVED_TO) < 0)
+		{
+			close(watch->fd);
+			watch->fd = -1;
+		}
+	}
+#endif
+
+	return watch;
+}
+
+int fs_watch_changed(FS_WATCH *watch)
+{
+	int changed = 0;
+	time_t modified;
+
+#if defined(__linux__)
+	if(watch->fd >= 0)
+	{
+		char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+		int bytes;
+		while((bytes = read(watch->fd, buf, sizeof(buf))) > 0)
+		{
+			char *p = buf;
+			while(p < buf + bytes)
+			{
+				const struct inotify_event *event = (const struct inotify_event *)p;
+				if(event->len && str_comp(event->name, watch->basename) == 0)
+					changed = 1;
+				p += sizeof(struct inotify_event) + event->len;
+			}
+		}
+		if(changed)
+			watch->modified = fs_modified_time(watch->filename);
+		return changed;
+	}
+#endif
+
+	modified = fs_modified_time(watch->filename);
+	if(modified != watch->modified)
+	{
+		watch->modified = modified;
+		changed = 1;
+	}
+	return changed;
+}
+
+void fs_watch_destroy(FS_WATCH *watch)
+{
+	if(!watch)
+		return;
+#if defined(__linux__)
+	if(watch->fd >= 0)
+		close(watch->fd);
+#endif
+	mem_free(watch);
+}
+
 void swap_endian(void *data, unsigned elem_size, unsigned num)
 {
 	char *src = (char*) data;
@@ -2167,6 +2490,19 @@ unsigned str_quickhash(const char *str)
 	return hash;
 }
 
+unsigned str_quickhash_nocase(const char *str)
+{
+	unsigned hash = 5381;
+	for(; *str; str++)
+	{
+		char c = *str;
+		if(c >= 'A' && c <= 'Z')
+			c += 'a'-'A';
+		hash = ((hash << 5) + hash) + (unsigned char)c; /* hash * 33 + c */
+	}
+	return hash;
+}
+
 struct SECURE_RANDOM_DATA
 {
 	int initialized;
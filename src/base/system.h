@@ -170,6 +170,22 @@ void mem_zero(void *block, unsigned size);
 */
 int mem_comp(const void *a, const void *b, int size);
 
+typedef struct
+{
+	int total_allocations;
+	int active_allocations;
+} MEMSTATS;
+
+/*
+	Function: mem_stats
+		Returns the number of blocks allocated through <mem_alloc>.
+
+	Remarks:
+		- The counters are not synchronized, allocations from other
+		threads might be missed.
+*/
+const MEMSTATS *mem_stats();
+
 /* Group: File IO */
 enum {
 	IOFLAG_READ = 1,
@@ -314,6 +330,7 @@ int io_close(IOHANDLE io);
 int io_flush(IOHANDLE io);
 
 
+
 /*
 	Function: io_stdin
 		Returns an <IOHANDLE> to the standard input.
@@ -390,6 +407,23 @@ void thread_yield();
 */
 void thread_detach(void *thread);
 
+/*
+	Function: thread_num_cpus
+		Returns the number of processors that are online, at least 1.
+*/
+int thread_num_cpus();
+
+/*
+	Function: sync_barrier
+		Full memory barrier. Makes sure that all memory accesses
+		before the barrier are visible to other threads before any
+		access after it.
+
+	Remarks:
+		Needed for data that is shared between threads without a lock.
+*/
+void sync_barrier();
+
 /* Group: Locks */
 typedef void* LOCK;
 
@@ -403,22 +437,26 @@ void lock_unlock(LOCK lock);
 
 /* Group: Semaphores */
 
-#if !defined(CONF_PLATFORM_MACOSX)
-	#if defined(CONF_FAMILY_UNIX)
-		#include <semaphore.h>
-		typedef sem_t SEMAPHORE;
-	#elif defined(CONF_FAMILY_WINDOWS)
-		typedef void* SEMAPHORE;
-	#else
-		#error missing sempahore implementation
-	#endif
-
-	void semaphore_init(SEMAPHORE *sem);
-	void semaphore_wait(SEMAPHORE *sem);
-	void semaphore_signal(SEMAPHORE *sem);
-	void semaphore_destroy(SEMAPHORE *sem);
+#if defined(CONF_PLATFORM_MACOSX)
+	/* unnamed posix semaphores are not supported there */
+	#include <dispatch/dispatch.h>
+	typedef dispatch_semaphore_t SEMAPHORE;
+#elif defined(CONF_FAMILY_UNIX)
+	#include <semaphore.h>
+	typedef sem_t SEMAPHORE;
+#elif defined(CONF_FAMILY_WINDOWS)
+	typedef void* SEMAPHORE;
+#else
+	#error missing sempahore implementation
 #endif
 
+void semaphore_init(SEMAPHORE *sem);
+void semaphore_wait(SEMAPHORE *sem);
+/* returns 1 when signaled, 0 when the timeout in milliseconds ran out */
+int semaphore_wait_timeout(SEMAPHORE *sem, int ms);
+void semaphore_signal(SEMAPHORE *sem);
+void semaphore_destroy(SEMAPHORE *sem);
+
 /* Group: Timer */
 #ifdef __GNUC__
 /* if compiled with -pedantic-errors it will complain about long
@@ -630,6 +668,60 @@ int net_udp_recv(NETSOCKET sock, NETADDR *addr, void *data, int maxsize);
 */
 int net_udp_close(NETSOCKET sock);
 
+typedef struct
+{
+	NETADDR addr;
+	void *data;
+	int size;
+} NETPACKET;
+
+enum
+{
+	NET_BATCH_MAX_PACKETS = 64
+};
+
+/*
+	Function: net_udp_send_batch
+		Sends several packets over an UDP socket with as few system
+		calls as possible.
+
+	Parameters:
+		sock - Socket to use.
+		packets - Packets to send, addr, data and size must be set.
+		num - Number of packets.
+
+	Returns:
+		The number of packets that were sent.
+
+	Remarks:
+		- Uses sendmmsg where available, falls back to one
+		  net_udp_send per packet otherwise.
+*/
+int net_udp_send_batch(NETSOCKET sock, const NETPACKET *packets, int num);
+
+/*
+	Function: net_udp_recv_batch
+		Receives several packets over an UDP socket with as few
+		system calls as possible.
+
+	Parameters:
+		sock - Socket to use.
+		packets - Packets to fill, data must point to a buffer of
+			maxsize bytes. addr and size will be set.
+		num - Maximum number of packets to receive.
+		maxsize - Size of each data buffer.
+
+	Returns:
+		The number of packets that were received, 0 if there was
+		nothing to read.
+
+	Remarks:
+		- Uses recvmmsg where available, falls back to one
+		  net_udp_recv per packet otherwise.
+		- Does not block.
+*/
+int net_udp_recv_batch(NETSOCKET sock, NETPACKET *packets, int num, int maxsize);
+
 
 /* Group: Network TCP */
 
@@ -1163,6 +1255,50 @@ int fs_remove(const char *filename);
 */
 int fs_rename(const char *oldname, const char *newname);
 
+typedef struct FS_WATCH FS_WATCH;
+
+/*
+	Function: fs_watch_create
+		Starts watching a file for modifications.
+
+	Parameters:
+		filename - The file to watch, it does not have to exist yet
+
+	Returns:
+		Returns a handle for <fs_watch_changed>, 0 on failure.
+
+	Remarks:
+		- Uses inotify on the parent directory where available, so files
+		  replaced by a rename are noticed too. Otherwise the modification
+		  time is polled.
+		- Release the handle with <fs_watch_destroy>.
+*/
+FS_WATCH *fs_watch_create(const char *filename);
+
+/*
+	Function: fs_watch_changed
+		Checks whether the watched file was modified since the last call.
+
+	Parameters:
+		watch - Handle returned by <fs_watch_create>
+
+	Returns:
+		Returns 1 if the file changed, 0 otherwise.
+
+	Remarks:
+		- Never blocks.
+*/
+int fs_watch_changed(FS_WATCH *watch);
+
+/*
+	Function: fs_watch_destroy
+		Stops watching and frees the handle.
+
+	Parameters:
+		watch - Handle returned by <fs_watch_create>
+*/
+void fs_watch_destroy(FS_WATCH *watch);
+
 /*
 	Group: Undocumented
 */
@@ -1231,6 +1367,7 @@ float str_tofloat(const char *str);
 int str_isspace(char c);
 char str_uppercase(char c);
 unsigned str_quickhash(const char *str);
+unsigned str_quickhash_nocase(const char *str);
 
 char *str_utf8_skip_whitespaces(char *str);
 
@@ -27,6 +27,11 @@ public:
 	virtual bool IsLoaded() = 0;
 	virtual void Unload() = 0;
 	virtual unsigned Crc() = 0;
+	// the map file as it was read, what clients download
+	virtual const unsigned char *FileData() = 0;
+	virtual unsigned FileSize() = 0;
+	// exchanges the loaded maps, both have to come from CreateEngineMap
+	virtual void Swap(IEngineMap *pOther) = 0;
 };
 
 extern IEngineMap *CreateEngineMap();
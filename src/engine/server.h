@@ -32,8 +32,12 @@ public:
 	virtual bool ClientIngame(int ClientID) const = 0;
 	virtual int GetClientInfo(int ClientID, CClientInfo *pInfo) const = 0;
 	virtual void GetClientAddr(int ClientID, char *pAddrStr, int Size) const = 0;
+	// hash of the address without port, equal for clients from the same ip, 0 for empty slots
+	virtual int64 ClientAddrKey(int ClientID) const = 0;
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID) = 0;
+	// sends the packed message to every client in the mask, recording it only once
+	virtual int SendMsgMask(CMsgPacker *pMsg, int Flags, int64 ClientMask) = 0;
 
 	template<class T>
 	int SendPackMsg(T *pMsg, int Flags, int ClientID)
@@ -44,11 +48,23 @@ public:
 		return SendMsg(&Packer, Flags, ClientID);
 	}
 
+	template<class T>
+	int SendPackMsgMask(T *pMsg, int Flags, int64 ClientMask)
+	{
+		CMsgPacker Packer(pMsg->MsgID(), false);
+		if(pMsg->Pack(&Packer))
+			return -1;
+		return SendMsgMask(&Packer, Flags, ClientMask);
+	}
+
 	virtual void SetClientName(int ClientID, char const *pName) = 0;
 	virtual void SetClientClan(int ClientID, char const *pClan) = 0;
 	virtual void SetClientCountry(int ClientID, int Country) = 0;
 	virtual void SetClientScore(int ClientID, int Score) = 0;
 
+	// call when something changed that shows up in the server info
+	virtual void ExpireServerInfo() = 0;
+
 	virtual int SnapNewID() = 0;
 	virtual void SnapFreeID(int ID) = 0;
 	virtual void *SnapNewItem(int Type, int ID, int Size) = 0;
@@ -67,6 +83,12 @@ public:
 
 	virtual void DemoRecorder_HandleAutoStart() = 0;
 	virtual bool DemoRecorder_IsRecording() = 0;
+
+	// starts loading the map in the background, a following change to it only swaps it in
+	virtual void PreloadMap(const char *pMapName) = 0;
+
+	// per phase tick timings, see perf_dump
+	virtual class CTickProfiler *TickProfiler() = 0;
 };
 
 class IGameServer : public IInterface
@@ -90,6 +112,8 @@ public:
 	virtual void OnClientDrop(int ClientID, const char *pReason) = 0;
 	virtual void OnClientDirectInput(int ClientID, void *pInput) = 0;
 	virtual void OnClientPredictedInput(int ClientID, void *pInput) = 0;
+	// fills the input of a scripted pseudo client of the benchmark (sv_bench_ticks)
+	virtual void OnBenchmarkClient(int ClientID, int Tick, void *pInput) = 0;
 
 	virtual bool IsClientReady(int ClientID) const = 0;
 	virtual bool IsClientPlayer(int ClientID) const = 0;
@@ -97,6 +121,7 @@ public:
 	virtual const char *GameType() const = 0;
 	virtual const char *Version() const = 0;
 	virtual const char *NetVersion() const = 0;
+	virtual const char *GetItemName(int Type) const = 0;
 };
 
 extern IGameServer *CreateGameServer();
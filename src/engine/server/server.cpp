@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <stdlib.h> // srand
+
 #include <base/math.h>
 #include <base/system.h>
 
@@ -18,10 +20,12 @@
 #include <engine/shared/demo.h>
 #include <engine/shared/econ.h>
 #include <engine/shared/filecollection.h>
+#include <engine/shared/inputrecord.h>
 #include <engine/shared/mapchecker.h>
 #include <engine/shared/netban.h>
 #include <engine/shared/network.h>
 #include <engine/shared/packer.h>
+#include <engine/shared/profiler.h>
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
 
@@ -269,6 +273,9 @@ void CServer::CClient::Reset()
 	m_SnapRate = CClient::SNAPRATE_INIT;
 	m_Score = 0;
 	m_MapChunk = 0;
+	m_MapChunkRequests = 0;
+	m_MapChunkWindow = 0;
+	m_MapResentChunks = 0;
 }
 
 CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
@@ -276,6 +283,9 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_TickSpeed = SERVER_TICK_SPEED;
 
 	m_pGameServer = 0;
+	m_pJobPool = 0;
+	m_pPreloadMap = CreateEngineMap();
+	m_aPreloadMap[0] = 0;
 
 	m_CurrentGameTick = 0;
 	m_RunServer = 1;
@@ -291,14 +301,43 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 	m_RconPasswordSet = 0;
 	m_GeneratedRconPassword = 0;
 
+	mem_zero(m_aSnapItemBits, sizeof(m_aSnapItemBits));
+	mem_zero(m_aSnapItemUpdates, sizeof(m_aSnapItemUpdates));
+	m_StatsFile = 0;
+
+	m_ProfilePhaseTick = m_TickProfiler.RegisterPhase("tick");
+	m_ProfilePhaseSnapshot = m_TickProfiler.RegisterPhase("snapshot");
+	m_ProfilePhaseNetwork = m_TickProfiler.RegisterPhase("network");
+
+	m_NumTickOverruns = 0;
+	m_NumSkippedTicks = 0;
+	m_MaxTicksBehind = 0;
+	m_aLastOverrun[0] = 0;
+	m_NextStatsDump = 0;
+
+	m_Headless = false;
+	m_HeadlessSentChunks = 0;
+	m_HeadlessSentBytes = 0;
+	m_GameSeed = 0;
+	m_pInputPlayer = 0;
+
+	m_ServerInfoValid = false;
+
 	Init();
 }
 
+CServer::~CServer()
+{
+	delete m_pPreloadMap;
+}
+
 void CServer::SetClientName(int ClientID, const char *pName)
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY || !pName)
 		return;
 
+	if(str_comp(m_aClients[ClientID].m_aName, pName) != 0)
+		ExpireServerInfo();
 	str_copy(m_aClients[ClientID].m_aName, pName, MAX_NAME_LENGTH);
 }
 
@@ -307,6 +346,8 @@ void CServer::SetClientClan(int ClientID, const char *pClan)
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY || !pClan)
 		return;
 
+	if(str_comp(m_aClients[ClientID].m_aClan, pClan) != 0)
+		ExpireServerInfo();
 	str_copy(m_aClients[ClientID].m_aClan, pClan, MAX_CLAN_LENGTH);
 }
 
@@ -315,6 +356,8 @@ void CServer::SetClientCountry(int ClientID, int Country)
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return;
 
+	if(m_aClients[ClientID].m_Country != Country)
+		ExpireServerInfo();
 	m_aClients[ClientID].m_Country = Country;
 }
 
@@ -322,9 +365,16 @@ void CServer::SetClientScore(int ClientID, int Score)
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return;
+	if(m_aClients[ClientID].m_Score != Score)
+		ExpireServerInfo();
 	m_aClients[ClientID].m_Score = Score;
 }
 
+void CServer::ExpireServerInfo()
+{
+	m_ServerInfoValid = false;
+}
+
 void CServer::Kick(int ClientID, const char *pReason)
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State == CClient::STATE_EMPTY)
@@ -412,6 +462,23 @@ void CServer::GetClientAddr(int ClientID, char *pAddrStr, int Size) const
 		net_addr_str(m_NetServer.ClientAddr(ClientID), pAddrStr, Size, false);
 }
 
+int64 CServer::ClientAddrKey(int ClientID) const
+{
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State == CClient::STATE_EMPTY)
+		return 0;
+	return m_aClients[ClientID].m_AddrKey;
+}
+
+static int64 HashAddrWithoutPort(const NETADDR *pAddr)
+{
+	// fnv-1a over the type and ip bytes
+	unsigned long long Hash = 14695981039346656037ULL;
+	Hash = (Hash^(unsigned)pAddr->type)*1099511628211ULL;
+	for(unsigned i = 0; i < sizeof(pAddr->ip); i++)
+		Hash = (Hash^pAddr->ip[i])*1099511628211ULL;
+	return Hash ? (int64)Hash : 1;
+}
+
 const char *CServer::ClientName(int ClientID) const
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State == CServer::CClient::STATE_EMPTY)
@@ -512,33 +579,68 @@ int CServer::SendMsg(CMsgPacker *pMsg, int Flags, int ClientID)
 				if(m_aClients[i].m_State == CClient::STATE_INGAME && !m_aClients[i].m_Quitting)
 				{
 					Packet.m_ClientID = i;
-					m_NetServer.Send(&Packet);
+					SendChunk(&Packet);
 				}
 		}
 		else
-			m_NetServer.Send(&Packet);
+			SendChunk(&Packet);
 	}
 	return 0;
 }
 
+int CServer::SendMsgMask(CMsgPacker *pMsg, int Flags, int64 ClientMask)
+{
+	CNetChunk Packet;
+	if(!pMsg)
+		return -1;
+
+	mem_zero(&Packet, sizeof(CNetChunk));
+	Packet.m_pData = pMsg->Data();
+	Packet.m_DataSize = pMsg->Size();
+
+	if(Flags&MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags&MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+
+	if(!(Flags&MSGFLAG_NORECORD))
+		m_DemoRecorder.RecordMessage(pMsg->Data(), pMsg->Size());
+
+	if(!(Flags&MSGFLAG_NOSEND))
+	{
+		for(int i = 0; i < MAX_CLIENTS; i++)
+		{
+			if(!(ClientMask&((int64)1<<i)) || m_aClients[i].m_State == CClient::STATE_EMPTY)
+				continue;
+			Packet.m_ClientID = i;
+			SendChunk(&Packet);
+		}
+	}
+	return 0;
+}
+
+void CServer::SendChunk(CNetChunk *pChunk)
+{
+	if(m_Headless)
+	{
+		m_HeadlessSentChunks++;
+		m_HeadlessSentBytes += pChunk->m_DataSize;
+		return;
+	}
+	m_NetServer.Send(pChunk);
+}
+
 void CServer::DoSnapshot()
 {
+	m_InputRecorder.RecordSnapshot();
 	GameServer()->OnPreSnap();
 
+	// counting every delta per item type costs, only do it when the stats are on
+	m_SnapshotDelta.SetCreateDataRate(g_Config.m_SvStatsInterval != 0);
+
 	// create snapshot for demo recording
 	if(m_DemoRecorder.IsRecording())
-	{
-		char aData[CSnapshot::MAX_SIZE];
-		int SnapshotSize;
-
-		// build snap and possibly add some messages
-		m_SnapshotBuilder.Init();
-		GameServer()->OnSnap(-1);
-		SnapshotSize = m_SnapshotBuilder.Finish(aData);
-
-		// write snapshot
-		m_DemoRecorder.RecordSnapshot(Tick(), aData, SnapshotSize);
-	}
+		DoDemoSnapshot();
 
 	// create snapshots for all clients
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -575,6 +677,9 @@ void CServer::DoSnapshot()
 			// finish snapshot
 			SnapshotSize = m_SnapshotBuilder.Finish(pData);
 			Crc = pData->Crc();
+			m_InputRecorder.RecordSnapshotCrc(i, Crc);
+			if(m_pInputPlayer)
+				m_aReplaySnapshotCrc[i] = Crc;
 
 			// remove old snapshos
 			// keep 3 seconds worth of snapshots
@@ -611,6 +716,11 @@ void CServer::DoSnapshot()
 				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData, sizeof(aCompData));
 				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
 
+				m_aClients[i].m_NumSnaps++;
+				m_aClients[i].m_NumSnapParts += NumPackets;
+				m_aClients[i].m_SnapDeltaBytes += DeltaSize;
+				m_aClients[i].m_SnapBytes += SnapshotSize;
+
 				for(int n = 0, Left = SnapshotSize; Left > 0; n++)
 				{
 					int Chunk = Left < MaxSize ? Left : MaxSize;
@@ -624,7 +734,7 @@ void CServer::DoSnapshot()
 						Msg.AddInt(Crc);
 						Msg.AddInt(Chunk);
 						Msg.AddRaw(&aCompData[n*MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
+						SendMsg(&Msg, MSGFLAG_FLUSH|MSGFLAG_NORECORD, i);
 					}
 					else
 					{
@@ -636,7 +746,7 @@ void CServer::DoSnapshot()
 						Msg.AddInt(Crc);
 						Msg.AddInt(Chunk);
 						Msg.AddRaw(&aCompData[n*MaxSize], Chunk);
-						SendMsg(&Msg, MSGFLAG_FLUSH, i);
+						SendMsg(&Msg, MSGFLAG_FLUSH|MSGFLAG_NORECORD, i);
 					}
 				}
 			}
@@ -645,14 +755,52 @@ void CServer::DoSnapshot()
 				CMsgPacker Msg(NETMSG_SNAPEMPTY, true);
 				Msg.AddInt(m_CurrentGameTick);
 				Msg.AddInt(m_CurrentGameTick-DeltaTick);
-				SendMsg(&Msg, MSGFLAG_FLUSH, i);
+				SendMsg(&Msg, MSGFLAG_FLUSH|MSGFLAG_NORECORD, i);
+
+				m_aClients[i].m_NumEmptySnaps++;
 			}
 		}
 	}
 
+	CollectSnapItemStats(false);
+
 	GameServer()->OnPostSnap();
 }
 
+void CServer::DoDemoSnapshot()
+{
+	char aData[CSnapshot::MAX_SIZE];
+	int SnapshotSize;
+
+	// build snap and possibly add some messages
+	m_SnapshotBuilder.Init();
+	GameServer()->OnSnap(-1);
+	SnapshotSize = m_SnapshotBuilder.Finish(aData);
+
+	// write snapshot
+	m_DemoRecorder.RecordSnapshot(Tick(), aData, SnapshotSize);
+
+	// the demo delta never goes over the wire
+	CollectSnapItemStats(true);
+}
+
+void CServer::CollectSnapItemStats(bool Discard)
+{
+	// move the per item type counters of the delta creation over,
+	// they are kept in ints and would overflow on a long running server
+	if(!g_Config.m_SvStatsInterval)
+		return;
+	for(int t = 0; t < MAX_SNAP_ITEMTYPES; t++)
+	{
+		if(!Discard)
+		{
+			m_aSnapItemBits[t] += m_SnapshotDelta.GetDataRate(t);
+			m_aSnapItemUpdates[t] += m_SnapshotDelta.GetDataUpdates(t);
+		}
+		m_SnapshotDelta.ClearDataRate(t);
+	}
+}
+
 
 int CServer::NewClientCallback(int ClientID, void *pUser)
 {
@@ -661,12 +809,19 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_aName[0] = 0;
 	pThis->m_aClients[ClientID].m_aClan[0] = 0;
 	pThis->m_aClients[ClientID].m_Country = -1;
+	pThis->m_aClients[ClientID].m_AddrKey = HashAddrWithoutPort(pThis->m_NetServer.ClientAddr(ClientID));
 	pThis->m_aClients[ClientID].m_Authed = AUTHED_NO;
 	pThis->m_aClients[ClientID].m_AuthTries = 0;
 	pThis->m_aClients[ClientID].m_pRconCmdToSend = 0;
 	pThis->m_aClients[ClientID].m_NoRconNote = false;
 	pThis->m_aClients[ClientID].m_Quitting = false;
+	pThis->m_aClients[ClientID].m_NumSnaps = 0;
+	pThis->m_aClients[ClientID].m_NumEmptySnaps = 0;
+	pThis->m_aClients[ClientID].m_NumSnapParts = 0;
+	pThis->m_aClients[ClientID].m_SnapDeltaBytes = 0;
+	pThis->m_aClients[ClientID].m_SnapBytes = 0;
 	pThis->m_aClients[ClientID].Reset();
+	pThis->ExpireServerInfo();
 	return 0;
 }
 
@@ -686,11 +841,13 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 	// notify the mod about the drop
 	if(pThis->m_aClients[ClientID].m_State >= CClient::STATE_READY)
 	{
+		pThis->m_InputRecorder.RecordDrop(ClientID, pReason);
 		pThis->m_aClients[ClientID].m_Quitting = true;
 		pThis->GameServer()->OnClientDrop(ClientID, pReason);
 	}
 
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_EMPTY;
+	pThis->ExpireServerInfo();
 	pThis->m_aClients[ClientID].m_aName[0] = 0;
 	pThis->m_aClients[ClientID].m_aClan[0] = 0;
 	pThis->m_aClients[ClientID].m_Country = -1;
@@ -714,6 +871,59 @@ void CServer::SendMap(int ClientID)
 	SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, ClientID);
 }
 
+void CServer::SendMapData(int ClientID)
+{
+	CClient *pClient = &m_aClients[ClientID];
+
+	// the client asks for more after every m_MapChunksPerRequest chunks,
+	// so each request after the first confirms that many chunks
+	int Confirmed = pClient->m_MapChunkRequests++ * m_MapChunksPerRequest;
+
+	// grow the window while the transfer runs clean, halve it when chunks had to be resent
+	int MaxWindow = max(g_Config.m_SvMapWindow, m_MapChunksPerRequest);
+	int64 Resent = m_NetServer.ClientStats(ClientID)->m_ResentChunks;
+	if(!pClient->m_MapChunkWindow)
+		pClient->m_MapChunkWindow = m_MapChunksPerRequest;
+	else if(Resent != pClient->m_MapResentChunks)
+		pClient->m_MapChunkWindow = max(pClient->m_MapChunkWindow/2, m_MapChunksPerRequest);
+	else
+		pClient->m_MapChunkWindow = min(pClient->m_MapChunkWindow+m_MapChunksPerRequest, MaxWindow);
+	pClient->m_MapResentChunks = Resent;
+
+	// send map chunks
+	while(pClient->m_MapChunk >= 0 && pClient->m_MapChunk < Confirmed+pClient->m_MapChunkWindow)
+	{
+		int Chunk = pClient->m_MapChunk;
+		int Offset = Chunk * MAP_CHUNK_SIZE;
+		int ChunkSize = MAP_CHUNK_SIZE;
+
+		// check for last part
+		if(Offset+ChunkSize >= m_CurrentMapSize)
+		{
+			ChunkSize = m_CurrentMapSize-Offset;
+			pClient->m_MapChunk = -1;
+		}
+		else
+			pClient->m_MapChunk++;
+
+		// full chunks fill a packet on their own, only the last one needs a flush
+		int Flags = MSGFLAG_VITAL;
+		if(pClient->m_MapChunk < 0 || pClient->m_MapChunk >= Confirmed+pClient->m_MapChunkWindow)
+			Flags |= MSGFLAG_FLUSH;
+
+		CMsgPacker Msg(NETMSG_MAP_DATA, true);
+		Msg.AddRaw(&m_pCurrentMapData[Offset], ChunkSize);
+		SendMsg(&Msg, Flags, ClientID);
+
+		if(g_Config.m_Debug)
+		{
+			char aBuf[64];
+			str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, ChunkSize);
+			Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
+		}
+	}
+}
+
 void CServer::SendConnectionReady(int ClientID)
 {
 	CMsgPacker Msg(NETMSG_CON_READY, true);
@@ -824,36 +1034,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 		else if(Msg == NETMSG_REQUEST_MAP_DATA)
 		{
 			if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) == 0 || m_aClients[ClientID].m_State == CClient::STATE_CONNECTING)
-			{
-				int ChunkSize = MAP_CHUNK_SIZE;
-
-				// send map chunks
-				for(int i = 0; i < m_MapChunksPerRequest && m_aClients[ClientID].m_MapChunk >= 0; ++i)
-				{
-					int Chunk = m_aClients[ClientID].m_MapChunk;
-					int Offset = Chunk * ChunkSize;
-
-					// check for last part
-					if(Offset+ChunkSize >= m_CurrentMapSize)
-					{
-						ChunkSize = m_CurrentMapSize-Offset;
-						m_aClients[ClientID].m_MapChunk = -1;
-					}
-					else
-						m_aClients[ClientID].m_MapChunk++;
-
-					CMsgPacker Msg(NETMSG_MAP_DATA, true);
-					Msg.AddRaw(&m_pCurrentMapData[Offset], ChunkSize);
-					SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, ClientID);
-
-					if(g_Config.m_Debug)
-					{
-						char aBuf[64];
-						str_format(aBuf, sizeof(aBuf), "sending chunk %d with size %d", Chunk, ChunkSize);
-						Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
-					}
-				}
-			}
+				SendMapData(ClientID);
 		}
 		else if(Msg == NETMSG_READY)
 		{
@@ -866,7 +1047,9 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				str_format(aBuf, sizeof(aBuf), "player is ready. ClientID=%x addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_READY;
+				m_InputRecorder.RecordConnect(ClientID);
 				GameServer()->OnClientConnected(ClientID);
+				ExpireServerInfo();
 				SendConnectionReady(ClientID);
 			}
 		}
@@ -882,6 +1065,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
 				SendServerInfo(ClientID);
+				m_InputRecorder.RecordEnter(ClientID);
 				GameServer()->OnClientEnter(ClientID);
 			}
 		}
@@ -929,8 +1113,11 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 			int PingCorrection = clamp(Unpacker.GetInt(), 0, 50);
 			if(m_aClients[ClientID].m_Snapshots.Get(m_aClients[ClientID].m_LastAckedSnapshot, &TagTime, 0, 0) >= 0)
 			{
-				m_aClients[ClientID].m_Latency = (int)(((Now-TagTime)*1000)/time_freq());
-				m_aClients[ClientID].m_Latency = max(0, m_aClients[ClientID].m_Latency - PingCorrection);
+				int Latency = (int)(((Now-TagTime)*1000)/time_freq());
+				Latency = max(0, Latency - PingCorrection);
+				if(Latency != m_aClients[ClientID].m_Latency)
+					m_InputRecorder.RecordLatency(ClientID, Latency);
+				m_aClients[ClientID].m_Latency = Latency;
 			}
 
 			mem_copy(m_aClients[ClientID].m_LatestInput.m_aData, pInput->m_aData, MAX_INPUT_SIZE*sizeof(int));
@@ -940,7 +1127,10 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 			// call the mod with the fresh input data
 			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+			{
+				m_InputRecorder.RecordInput(CInputRecorder::EVENT_DIRECT_INPUT, ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
 				GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+			}
 		}
 		else if(Msg == NETMSG_RCON_CMD)
 		{
@@ -1063,7 +1253,10 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 	{
 		// game message
 		if((pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0 && m_aClients[ClientID].m_State >= CClient::STATE_READY)
+		{
+			m_InputRecorder.RecordMessage(ClientID, pPacket->m_pData, pPacket->m_DataSize);
 			GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+		}
 	}
 }
 
@@ -1123,6 +1316,20 @@ void CServer::GenerateServerInfo(CPacker *pPacker, int Token)
 	}
 }
 
+void CServer::UpdateServerInfoConnless()
+{
+	// the info only changes with the clients or the config, so pack it once and only add the token per request
+	m_NetServer.SetInfoRateLimit(g_Config.m_SvInfoRateLimit);
+	if(m_ServerInfoValid)
+		return;
+
+	CPacker Packer;
+	GenerateServerInfo(&Packer, 0);
+	int HeaderSize = sizeof(SERVERBROWSE_INFO) + 1; // token 0 packs into a single byte
+	m_NetServer.SetServerInfo(Packer.Data()+HeaderSize, Packer.Size()-HeaderSize);
+	m_ServerInfoValid = true;
+}
+
 void CServer::SendServerInfo(int ClientID)
 {
 	CMsgPacker Msg(NETMSG_SERVERINFO, true);
@@ -1146,40 +1353,19 @@ void CServer::PumpNetwork()
 	TOKEN ResponseToken;
 
 	m_NetServer.Update();
+	UpdateServerInfoConnless();
 
-	// process packets
+	// process packets, browser info requests are answered by the net server
 	while(m_NetServer.Recv(&Packet, &ResponseToken))
 	{
 		if(Packet.m_Flags&NETSENDFLAG_CONNLESS)
-		{
-			if(m_Register.RegisterProcessPacket(&Packet, ResponseToken))
-				continue;
-			if(Packet.m_DataSize >= int(sizeof(SERVERBROWSE_GETINFO)) &&
-				mem_comp(Packet.m_pData, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)) == 0)
-			{
-				CUnpacker Unpacker;
-				Unpacker.Reset((unsigned char*)Packet.m_pData+sizeof(SERVERBROWSE_GETINFO), Packet.m_DataSize-sizeof(SERVERBROWSE_GETINFO));
-				int SrvBrwsToken = Unpacker.GetInt();
-				if(Unpacker.Error())
-					continue;
-
-				CPacker Packer;
-				CNetChunk Response;
-				
-				GenerateServerInfo(&Packer, SrvBrwsToken);
-
-				Response.m_ClientID = -1;
-				Response.m_Address = Packet.m_Address;
-				Response.m_Flags = NETSENDFLAG_CONNLESS;
-				Response.m_pData = Packer.Data();
-				Response.m_DataSize = Packer.Size();
-				m_NetServer.Send(&Response, ResponseToken);
-			}
-		}
+			m_Register.RegisterProcessPacket(&Packet, ResponseToken);
 		else
 			ProcessClientPacket(&Packet);
 	}
 
+	m_NetServer.FlushSendBatch();
+
 	m_ServerBan.Update();
 	m_Econ.Update();
 }
@@ -1196,20 +1382,63 @@ const char *CServer::GetMapName() const
 	return pMapShortName;
 }
 
+int CServer::PreloadMapJob(void *pUser)
+{
+	CServer *pThis = (CServer *)pUser;
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf), "maps/%s.map", pThis->m_aPreloadMap);
+	if(pThis->m_pPreloadMap->Load(aBuf, pThis->Storage()))
+		return 1;
+	pThis->m_pPreloadMap->Unload();
+	return 0;
+}
+
+void CServer::PreloadMap(const char *pMapName)
+{
+	// one at a time
+	if(m_PreloadJob.Status() != CJob::STATE_DONE || str_comp(pMapName, m_aCurrentMap) == 0 || str_comp(pMapName, m_aPreloadMap) == 0)
+		return;
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "preloading map '%s'", pMapName);
+	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
+
+	m_pPreloadMap->Unload();
+	str_copy(m_aPreloadMap, pMapName, sizeof(m_aPreloadMap));
+	m_pJobPool->Add(&m_PreloadJob, PreloadMapJob, this, CJobPool::PRIORITY_LOW);
+}
+
 int CServer::LoadMap(const char *pMapName)
 {
 	char aBuf[512];
 	str_format(aBuf, sizeof(aBuf), "maps/%s.map", pMapName);
 
-	// check for valid standard map
-	if(!m_MapChecker.ReadAndValidateMap(Storage(), aBuf, IStorage::TYPE_ALL))
+	// the current map waits in the preload slot until the new one checked out. a preload
+	// of this map is taken as it is, so wait for the preload job in any case
+	m_pJobPool->WaitFor(&m_PreloadJob);
+	bool Preloaded = m_aPreloadMap[0] && str_comp(pMapName, m_aPreloadMap) == 0 && m_PreloadJob.Result();
+	if(!Preloaded)
+		m_pPreloadMap->Unload();
+	m_aPreloadMap[0] = 0;
+	m_pMap->Swap(m_pPreloadMap);
+	if(Preloaded)
+		Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", "using the preloaded map");
+	else if(!m_pMap->Load(aBuf))
 	{
-		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "mapchecker", "invalid standard map");
+		m_pMap->Unload();
+		m_pMap->Swap(m_pPreloadMap);
 		return 0;
 	}
 
-	if(!m_pMap->Load(aBuf))
+	// check for valid standard map, with the crc and size of what was read
+	if(!m_MapChecker.IsMapValid(pMapName, m_pMap->Crc(), m_pMap->FileSize()))
+	{
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "mapchecker", "invalid standard map");
+		m_pMap->Unload();
+		m_pMap->Swap(m_pPreloadMap);
 		return 0;
+	}
+	m_pPreloadMap->Unload();
 
 	// stop recording when we change map
 	m_DemoRecorder.Stop();
@@ -1224,18 +1453,419 @@ int CServer::LoadMap(const char *pMapName)
 	Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBufMsg);
 
 	str_copy(m_aCurrentMap, pMapName, sizeof(m_aCurrentMap));
+	ExpireServerInfo();
+
+	// downloads get the bytes of the reader the crc came from, also for a preloaded map
+	// whose file changed on disk meanwhile
+	m_pCurrentMapData = m_pMap->FileData();
+	m_CurrentMapSize = m_pMap->FileSize();
+	return 1;
+}
 
-	// load complete map into memory for download
+static void JsonEscape(char *pDst, int DstSize, const char *pSrc)
+{
+	int i = 0;
+	for(; *pSrc && i < DstSize-2; pSrc++)
 	{
-		IOHANDLE File = Storage()->OpenFile(aBuf, IOFLAG_READ, IStorage::TYPE_ALL);
-		m_CurrentMapSize = (int)io_length(File);
-		if(m_pCurrentMapData)
-			mem_free(m_pCurrentMapData);
-		m_pCurrentMapData = (unsigned char *)mem_alloc(m_CurrentMapSize, 1);
-		io_read(File, m_pCurrentMapData, m_CurrentMapSize);
-		io_close(File);
+		if(*pSrc == '"' || *pSrc == '\\')
+			pDst[i++] = '\\';
+		else if((unsigned char)*pSrc < 32)
+			continue;
+		pDst[i++] = *pSrc;
 	}
-	return 1;
+	pDst[i] = 0;
+}
+
+void CServer::WriteBandwidthStats(IOHANDLE File)
+{
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf), "{\"type\":\"bandwidth\",\"time\":%d,\"tick\":%d,\"clients\":[", time_timestamp(), Tick());
+	io_write(File, aBuf, str_length(aBuf));
+
+	bool First = true;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(m_aClients[i].m_State == CClient::STATE_EMPTY)
+			continue;
+
+		const CClient *pClient = &m_aClients[i];
+		const CNetConnectionStats *pNetStats = m_NetServer.ClientStats(i);
+		char aName[MAX_NAME_LENGTH*2];
+		JsonEscape(aName, sizeof(aName), pClient->m_aName);
+		str_format(aBuf, sizeof(aBuf), "%s{\"id\":%d,\"name\":\"%s\",\"snaps\":%d,\"empty_snaps\":%d,\"snap_parts\":%d,\"snap_delta_bytes\":%lld,\"snap_bytes\":%lld,"
+			"\"sent_packets\":%lld,\"sent_bytes\":%lld,\"sent_uncompressed_bytes\":%lld,\"recv_packets\":%lld,\"recv_bytes\":%lld,\"resent_chunks\":%lld}",
+			First ? "" : ",", i, aName, pClient->m_NumSnaps, pClient->m_NumEmptySnaps, pClient->m_NumSnapParts,
+			(long long)pClient->m_SnapDeltaBytes, (long long)pClient->m_SnapBytes,
+			(long long)pNetStats->m_SentPackets, (long long)pNetStats->m_SentBytes, (long long)pNetStats->m_SentUncompressedBytes,
+			(long long)pNetStats->m_RecvPackets, (long long)pNetStats->m_RecvBytes, (long long)pNetStats->m_ResentChunks);
+		io_write(File, aBuf, str_length(aBuf));
+		First = false;
+	}
+
+	io_write(File, "],\"items\":[", 11);
+
+	First = true;
+	for(int t = 0; t < MAX_SNAP_ITEMTYPES; t++)
+	{
+		if(!m_aSnapItemUpdates[t])
+			continue;
+
+		str_format(aBuf, sizeof(aBuf), "%s{\"type\":%d,\"name\":\"%s\",\"bytes\":%lld,\"updates\":%lld}",
+			First ? "" : ",", t, GameServer()->GetItemName(t), (long long)(m_aSnapItemBits[t]/8), (long long)m_aSnapItemUpdates[t]);
+		io_write(File, aBuf, str_length(aBuf));
+		First = false;
+	}
+
+	io_write(File, "]}", 2);
+	io_write_newline(File);
+}
+
+void CServer::CheckTickOverrun(int64 Now)
+{
+	if(Now <= TickStartTime(m_CurrentGameTick+2))
+		return;
+
+	int TicksBehind = (int)((Now-TickStartTime(m_CurrentGameTick+1))*SERVER_TICK_SPEED/time_freq()) + 1;
+	int SkippedTicks = 0;
+	if(g_Config.m_SvMaxCatchupTicks && TicksBehind > g_Config.m_SvMaxCatchupTicks)
+	{
+		// move the time line instead of running all the missed ticks at once
+		SkippedTicks = TicksBehind - g_Config.m_SvMaxCatchupTicks;
+		m_GameStartTime += time_freq()*SkippedTicks/SERVER_TICK_SPEED;
+	}
+
+	m_NumTickOverruns++;
+	m_NumSkippedTicks += SkippedTicks;
+	m_MaxTicksBehind = max(m_MaxTicksBehind, TicksBehind);
+
+	// the stall happened during the previous loop iteration
+	int64 WorstTime;
+	int WorstPhase = m_TickProfiler.Enabled() ? m_TickProfiler.WorstFramePhase(&WorstTime) : -1;
+	if(WorstPhase >= 0 && WorstTime >= time_freq()/SERVER_TICK_SPEED)
+		str_format(m_aLastOverrun, sizeof(m_aLastOverrun), "tick=%d behind=%d skipped=%d worst_phase=%s (%dms)",
+			m_CurrentGameTick, TicksBehind, SkippedTicks, m_TickProfiler.PhaseName(WorstPhase), (int)(WorstTime*1000/time_freq()));
+	else
+		str_format(m_aLastOverrun, sizeof(m_aLastOverrun), "tick=%d behind=%d skipped=%d worst_phase=%s",
+			m_CurrentGameTick, TicksBehind, SkippedTicks, m_TickProfiler.Enabled() ? "none (stalled outside the timed phases)" : "unknown (sv_profile 0)");
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "tick overrun: %s", m_aLastOverrun);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+}
+
+void CServer::ConnectHeadlessClient(int ClientID, const char *pName)
+{
+	CClient *pClient = &m_aClients[ClientID];
+	str_copy(pClient->m_aName, pName, sizeof(pClient->m_aName));
+	pClient->m_aClan[0] = 0;
+	pClient->m_Country = -1;
+	pClient->m_AddrKey = ClientID+1;
+	pClient->m_Authed = AUTHED_NO;
+	pClient->m_AuthTries = 0;
+	pClient->m_pRconCmdToSend = 0;
+	pClient->m_NoRconNote = false;
+	pClient->m_Quitting = false;
+	pClient->m_NumSnaps = 0;
+	pClient->m_NumEmptySnaps = 0;
+	pClient->m_NumSnapParts = 0;
+	pClient->m_SnapDeltaBytes = 0;
+	pClient->m_SnapBytes = 0;
+	pClient->Reset();
+	pClient->m_SnapRate = CClient::SNAPRATE_FULL;
+
+	pClient->m_State = CClient::STATE_READY;
+	GameServer()->OnClientConnected(ClientID);
+}
+
+void CServer::RunBenchmark()
+{
+	// pseudo clients take the lowest slots like players joining an empty server, the dummies fill up from the top
+	int NumClients = min(g_Config.m_SvBenchClients, MaxClients());
+	m_Headless = true;
+	for(int c = 0; c < NumClients; c++)
+	{
+		char aName[MAX_NAME_LENGTH];
+		str_format(aName, sizeof(aName), "bench%d", c);
+		ConnectHeadlessClient(c, aName);
+		m_aClients[c].m_State = CClient::STATE_INGAME;
+		GameServer()->OnClientEnter(c);
+	}
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "map=%s ticks=%d clients=%d dummies=%d seed=%d",
+		m_aCurrentMap, g_Config.m_SvBenchTicks, NumClients, g_Config.m_SvBenchDummies, g_Config.m_SvBenchSeed);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "benchmark", aBuf);
+
+	m_TickProfiler.SetEnabled(true);
+	m_TickProfiler.Reset();
+	int StartAllocations = mem_stats()->total_allocations;
+	int StartActiveAllocations = mem_stats()->active_allocations;
+	int64 StartTime = time_get();
+
+	for(int t = 0; t < g_Config.m_SvBenchTicks; t++)
+	{
+		m_CurrentGameTick++;
+
+		for(int c = 0; c < NumClients; c++)
+		{
+			if(m_aClients[c].m_State != CClient::STATE_INGAME)
+				continue;
+			CClient::CInput *pInput = &m_aClients[c].m_LatestInput;
+			mem_zero(pInput->m_aData, sizeof(pInput->m_aData));
+			pInput->m_GameTick = Tick();
+			GameServer()->OnBenchmarkClient(c, Tick(), pInput->m_aData);
+			GameServer()->OnClientDirectInput(c, pInput->m_aData);
+			GameServer()->OnClientPredictedInput(c, pInput->m_aData);
+		}
+
+		{
+			CProfileScope ProfileTick(&m_TickProfiler, m_ProfilePhaseTick);
+			GameServer()->OnTick();
+		}
+
+		if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
+		{
+			{
+				CProfileScope ProfileSnapshot(&m_TickProfiler, m_ProfilePhaseSnapshot);
+				DoSnapshot();
+			}
+
+			// the pseudo clients ack every snapshot right away
+			for(int c = 0; c < NumClients; c++)
+			{
+				m_aClients[c].m_LastAckedSnapshot = Tick();
+				m_aClients[c].m_SnapRate = CClient::SNAPRATE_FULL;
+			}
+		}
+	}
+
+	int64 Duration = time_get()-StartTime;
+	int Allocations = mem_stats()->total_allocations-StartAllocations;
+	int ActiveAllocations = mem_stats()->active_allocations-StartActiveAllocations;
+	double Ms = Duration*1000.0/time_freq();
+
+	str_format(aBuf, sizeof(aBuf), "%.2f ms total, %.3f ms/tick, %.1f ticks/s",
+		Ms, Ms/max(g_Config.m_SvBenchTicks, 1), Duration ? g_Config.m_SvBenchTicks*(double)time_freq()/Duration : 0.0);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "benchmark", aBuf);
+	str_format(aBuf, sizeof(aBuf), "%d allocations (%d still alive), %lld chunks with %lld bytes not sent",
+		Allocations, ActiveAllocations, m_HeadlessSentChunks, m_HeadlessSentBytes);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "benchmark", aBuf);
+	PrintTickProfile("benchmark");
+
+	DropHeadlessClients("benchmark done");
+	m_TickProfiler.SetEnabled(g_Config.m_SvProfile);
+	m_Headless = false;
+}
+
+int CServer::RunInputReplay(CInputPlayer *pPlayer)
+{
+	m_Headless = true;
+	m_pInputPlayer = pPlayer;
+	mem_zero(m_aReplaySnapshotCrc, sizeof(m_aReplaySnapshotCrc));
+	m_TickProfiler.SetEnabled(true);
+	m_TickProfiler.Reset();
+
+	char aBuf[256];
+	int NumTicks = 0;
+	int NumChecked = 0;
+	int NumMismatches = 0;
+	bool TickPending = false;
+	int64 StartTime = time_get();
+
+	CInputPlayer::CEvent Event;
+	while(pPlayer->NextEvent(&Event))
+	{
+		// the inputs of a tick come right after it, anything else happened after the tick ran
+		if(TickPending && Event.m_Type != CInputRecorder::EVENT_PREDICTED_INPUT)
+		{
+			CProfileScope ProfileTick(&m_TickProfiler, m_ProfilePhaseTick);
+			GameServer()->OnTick();
+			TickPending = false;
+		}
+
+		int ClientID = Event.m_ClientID;
+		switch(Event.m_Type)
+		{
+		case CInputRecorder::EVENT_TICK:
+			m_CurrentGameTick = Event.m_Value;
+			TickPending = true;
+			NumTicks++;
+			break;
+		case CInputRecorder::EVENT_CONNECT:
+			if(m_aClients[ClientID].m_State == CClient::STATE_EMPTY)
+				ConnectHeadlessClient(ClientID, "");
+			break;
+		case CInputRecorder::EVENT_ENTER:
+			if(m_aClients[ClientID].m_State == CClient::STATE_READY)
+			{
+				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+				GameServer()->OnClientEnter(ClientID);
+			}
+			break;
+		case CInputRecorder::EVENT_DROP:
+			// the game might have kicked the client already
+			if(m_aClients[ClientID].m_State != CClient::STATE_EMPTY)
+				m_NetServer.Drop(ClientID, Event.m_pString);
+			break;
+		case CInputRecorder::EVENT_DIRECT_INPUT:
+			mem_copy(m_aClients[ClientID].m_LatestInput.m_aData, Event.m_pInput, MAX_INPUT_SIZE*sizeof(int));
+			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+				GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+			break;
+		case CInputRecorder::EVENT_PREDICTED_INPUT:
+			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+			{
+				CClient::CInput *pInput = &m_aClients[ClientID].m_aInputs[0];
+				mem_copy(pInput->m_aData, Event.m_pInput, MAX_INPUT_SIZE*sizeof(int));
+				pInput->m_GameTick = Tick();
+				GameServer()->OnClientPredictedInput(ClientID, pInput->m_aData);
+			}
+			break;
+		case CInputRecorder::EVENT_MESSAGE:
+			if(m_aClients[ClientID].m_State >= CClient::STATE_READY)
+			{
+				CUnpacker Unpacker;
+				Unpacker.Reset(Event.m_pData, Event.m_DataSize);
+				int Msg = Unpacker.GetInt()>>1;
+				GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+			}
+			break;
+		case CInputRecorder::EVENT_LATENCY:
+			m_aClients[ClientID].m_Latency = Event.m_Value;
+			break;
+		case CInputRecorder::EVENT_SNAPSHOT:
+			{
+				CProfileScope ProfileSnapshot(&m_TickProfiler, m_ProfilePhaseSnapshot);
+				DoSnapshot();
+			}
+			for(int c = 0; c < MAX_CLIENTS; c++)
+			{
+				m_aClients[c].m_LastAckedSnapshot = Tick();
+				m_aClients[c].m_SnapRate = CClient::SNAPRATE_FULL;
+			}
+			break;
+		case CInputRecorder::EVENT_SNAPSHOT_CRC:
+			NumChecked++;
+			if(m_aClients[ClientID].m_State != CClient::STATE_INGAME || m_aReplaySnapshotCrc[ClientID] != (unsigned)Event.m_Value)
+			{
+				// the first one matters, everything after it is likely a consequence
+				if(++NumMismatches <= 10)
+				{
+					str_format(aBuf, sizeof(aBuf), "snapshot differs. tick=%d cid=%d crc=%08x recorded=%08x", Tick(), ClientID,
+						m_aClients[ClientID].m_State == CClient::STATE_INGAME ? m_aReplaySnapshotCrc[ClientID] : 0, Event.m_Value);
+					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+				}
+			}
+			break;
+		}
+	}
+	if(TickPending)
+	{
+		CProfileScope ProfileTick(&m_TickProfiler, m_ProfilePhaseTick);
+		GameServer()->OnTick();
+	}
+
+	int64 Duration = time_get()-StartTime;
+	if(pPlayer->Error())
+	{
+		str_format(aBuf, sizeof(aBuf), "the recording is broken after tick %d", Tick());
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	}
+	str_format(aBuf, sizeof(aBuf), "%d ticks in %.2f ms, %.1f ticks/s", NumTicks, Duration*1000.0/time_freq(),
+		Duration ? NumTicks*(double)time_freq()/Duration : 0.0);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	str_format(aBuf, sizeof(aBuf), "%d of %d snapshots differ from the recording", NumMismatches, NumChecked);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	PrintTickProfile("replay");
+
+	DropHeadlessClients("replay done");
+	m_TickProfiler.SetEnabled(g_Config.m_SvProfile);
+	m_pInputPlayer = 0;
+	m_Headless = false;
+	return NumMismatches;
+}
+
+void CServer::PrintTickProfile(const char *pFrom)
+{
+	// p50, p99 and max are over the last NUM_SAMPLES samples of each phase only
+	for(int i = 0; i < m_TickProfiler.NumPhases(); i++)
+	{
+		CTickProfiler::CSummary Summary;
+		m_TickProfiler.GetSummary(i, &Summary);
+		if(!Summary.m_NumSamples)
+			continue;
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%-20s n=%-7d total=%.2fms mean=%dus p50=%dus p99=%dus max=%dus",
+			Summary.m_pName, Summary.m_NumSamples, Summary.m_Total/1000.0, (int)(Summary.m_Total/Summary.m_NumSamples),
+			Summary.m_P50, Summary.m_P99, Summary.m_Max);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, pFrom, aBuf);
+	}
+}
+
+void CServer::DropHeadlessClients(const char *pReason)
+{
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		if(m_aClients[c].m_State != CClient::STATE_EMPTY)
+			m_NetServer.Drop(c, pReason);
+	}
+}
+
+void CServer::InputRecorder_HandleAutoStart()
+{
+	m_InputRecorder.Stop();
+	if(!g_Config.m_SvInputRecord || g_Config.m_SvBenchTicks || g_Config.m_SvInputReplay[0])
+		return;
+
+	char aDate[20];
+	char aFilename[128];
+	str_timestamp(aDate, sizeof(aDate));
+	str_format(aFilename, sizeof(aFilename), "inputs/%s_%s.rec", m_aCurrentMap, aDate);
+	Storage()->CreateFolder("inputs", IStorage::TYPE_SAVE);
+	m_InputRecorder.Start(Storage(), Console(), aFilename, GameServer()->NetVersion(), m_aCurrentMap, m_CurrentMapCrc, m_GameSeed);
+}
+
+void CServer::WriteProfileStats(IOHANDLE File)
+{
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "{\"type\":\"perf\",\"time\":%d,\"tick\":%d,\"overruns\":%d,\"skipped_ticks\":%d,\"max_ticks_behind\":%d,\"phases\":[",
+		time_timestamp(), Tick(), m_NumTickOverruns, m_NumSkippedTicks, m_MaxTicksBehind);
+	io_write(File, aBuf, str_length(aBuf));
+
+	for(int i = 0; i < m_TickProfiler.NumPhases(); i++)
+	{
+		CTickProfiler::CSummary Summary;
+		m_TickProfiler.GetSummary(i, &Summary);
+		char aName[CTickProfiler::MAX_PHASE_NAME*2];
+		JsonEscape(aName, sizeof(aName), Summary.m_pName);
+		str_format(aBuf, sizeof(aBuf), "%s{\"name\":\"%s\",\"samples\":%d,\"p50_us\":%d,\"p99_us\":%d,\"max_us\":%d}",
+			i ? "," : "", aName, Summary.m_NumSamples, Summary.m_P50, Summary.m_P99, Summary.m_Max);
+		io_write(File, aBuf, str_length(aBuf));
+	}
+
+	io_write(File, "]}", 2);
+	io_write_newline(File);
+}
+
+void CServer::DumpStats()
+{
+	if(!m_StatsFile)
+	{
+		m_StatsFile = Storage()->OpenFile(g_Config.m_SvStatsFile, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!m_StatsFile)
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "failed to open '%s' for writing, statistics dump disabled", g_Config.m_SvStatsFile);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+			g_Config.m_SvStatsInterval = 0;
+			return;
+		}
+	}
+
+	WriteBandwidthStats(m_StatsFile);
+	if(m_TickProfiler.Enabled())
+		WriteProfileStats(m_StatsFile);
+	io_flush(m_StatsFile);
 }
 
 void CServer::InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole)
@@ -1248,12 +1878,23 @@ int CServer::Run()
 	//
 	m_PrintCBIndex = Console()->RegisterPrintCallback(g_Config.m_ConsoleOutputLevel, SendRconLineAuthed, this);
 
+	// a replay runs on the map it was recorded on
+	CInputPlayer InputPlayer;
+	if(g_Config.m_SvInputReplay[0])
+	{
+		if(InputPlayer.Load(Storage(), Console(), g_Config.m_SvInputReplay) != 0)
+			return -1;
+		str_copy(g_Config.m_SvMap, InputPlayer.Header()->m_aMap, sizeof(g_Config.m_SvMap));
+	}
+
 	// load map
 	if(!LoadMap(g_Config.m_SvMap))
 	{
 		dbg_msg("server", "failed to load map. mapname='%s'", g_Config.m_SvMap);
 		return -1;
 	}
+	if(g_Config.m_SvInputReplay[0] && m_CurrentMapCrc != InputPlayer.Header()->m_MapCrc)
+		dbg_msg("server", "map crc %08x differs from the recording %08x", m_CurrentMapCrc, InputPlayer.Header()->m_MapCrc);
 	m_MapChunksPerRequest = g_Config.m_SvMapDownloadSpeed;
 
 	// start server
@@ -1285,7 +1926,17 @@ int CServer::Run()
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", g_Config.m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
+	// the same dummies and events on every benchmark run, a replay uses the recorded seed
+	if(g_Config.m_SvInputReplay[0])
+		m_GameSeed = InputPlayer.Header()->m_Seed;
+	else if(g_Config.m_SvBenchTicks)
+		m_GameSeed = g_Config.m_SvBenchSeed;
+	else
+		m_GameSeed = random_int();
+	srand(m_GameSeed);
+
 	GameServer()->OnInit();
+	InputRecorder_HandleAutoStart();
 	str_format(aBuf, sizeof(aBuf), "version %s", GameServer()->NetVersion());
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
@@ -1299,11 +1950,23 @@ int CServer::Run()
 		dbg_msg("server", "+-------------------------+");
 	}
 
-	// start game
+	int Result = 0;
+	if(g_Config.m_SvInputReplay[0])
+	{
+		Result = RunInputReplay(&InputPlayer) ? 1 : 0;
+		m_RunServer = false;
+	}
+	else if(g_Config.m_SvBenchTicks)
 	{
-		int64 ReportTime = time_get();
-		int ReportInterval = 3;
+		RunBenchmark();
+		m_RunServer = false;
+	}
+
+	if(g_Config.m_SvNetThread)
+		m_NetServer.StartThread();
 
+	// start game
+	{
 		m_Lastheartbeat = 0;
 		m_GameStartTime = time_get();
 
@@ -1312,6 +1975,8 @@ int CServer::Run()
 			int64 t = time_get();
 			int NewTicks = 0;
 
+			m_TickProfiler.SetEnabled(g_Config.m_SvProfile);
+
 			// load new map TODO: don't poll this
 			if(str_comp(g_Config.m_SvMap, m_aCurrentMap) != 0 || m_MapReload || m_CurrentGameTick >= 0x6FFFFFFF) //	force reload to make sure the ticks stay within a valid range
 			{
@@ -1321,6 +1986,7 @@ int CServer::Run()
 				if(LoadMap(g_Config.m_SvMap))
 				{
 					// new map loaded
+					m_InputRecorder.Stop();
 					GameServer()->OnShutdown();
 
 					for(int c = 0; c < MAX_CLIENTS; c++)
@@ -1336,7 +2002,10 @@ int CServer::Run()
 					m_GameStartTime = time_get();
 					m_CurrentGameTick = 0;
 					Kernel()->ReregisterInterface(GameServer());
+					m_GameSeed = random_int();
+					srand(m_GameSeed);
 					GameServer()->OnInit();
+					InputRecorder_HandleAutoStart();
 				}
 				else
 				{
@@ -1346,10 +2015,14 @@ int CServer::Run()
 				}
 			}
 
+			CheckTickOverrun(t);
+			m_TickProfiler.BeginFrame();
+
 			while(t > TickStartTime(m_CurrentGameTick+1))
 			{
 				m_CurrentGameTick++;
 				NewTicks++;
+				m_InputRecorder.RecordTick(m_CurrentGameTick);
 
 				// apply new input
 				for(int c = 0; c < MAX_CLIENTS; c++)
@@ -1361,12 +2034,16 @@ int CServer::Run()
 						if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
 						{
 							if(m_aClients[c].m_State == CClient::STATE_INGAME)
+							{
+								m_InputRecorder.RecordInput(CInputRecorder::EVENT_PREDICTED_INPUT, c, m_aClients[c].m_aInputs[i].m_aData);
 								GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
+							}
 							break;
 						}
 					}
 				}
 
+				CProfileScope ProfileTick(&m_TickProfiler, m_ProfilePhaseTick);
 				GameServer()->OnTick();
 			}
 
@@ -1374,43 +2051,33 @@ int CServer::Run()
 			if(NewTicks)
 			{
 				if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
+				{
+					CProfileScope ProfileSnapshot(&m_TickProfiler, m_ProfilePhaseSnapshot);
 					DoSnapshot();
+				}
 
 				UpdateClientRconCommands();
+
+				// send all packets of this tick in one go
+				m_NetServer.FlushSendBatch();
 			}
 
 			// master server stuff
 			m_Register.RegisterUpdate(m_NetServer.NetType());
 
-			PumpNetwork();
-
-			if(ReportTime < time_get())
 			{
-				if(g_Config.m_Debug)
-				{
-					/*
-					static NETSTATS prev_stats;
-					NETSTATS stats;
-					netserver_stats(net, &stats);
-
-					perf_next();
-
-					if(config.dbg_pref)
-						perf_dump(&rootscope);
-
-					dbg_msg("server", "send=%8d recv=%8d",
-						(stats.send_bytes - prev_stats.send_bytes)/reportinterval,
-						(stats.recv_bytes - prev_stats.recv_bytes)/reportinterval);
-
-					prev_stats = stats;
-					*/
-				}
+				CProfileScope ProfileNetwork(&m_TickProfiler, m_ProfilePhaseNetwork);
+				PumpNetwork();
+			}
 
-				ReportTime += time_freq()*ReportInterval;
+			if(g_Config.m_SvStatsInterval && m_NextStatsDump < time_get())
+			{
+				DumpStats();
+				m_NextStatsDump = time_get() + time_freq()*g_Config.m_SvStatsInterval;
 			}
 
 			// wait for incomming data
-			net_socket_read_wait(m_NetServer.Socket(), 5);
+			m_NetServer.Wait(5);
 		}
 	}
 	// disconnect all clients on shutdown
@@ -1421,13 +2088,19 @@ int CServer::Run()
 
 		m_Econ.Shutdown();
 	}
+	m_NetServer.Close();
 
+	m_InputRecorder.Stop();
+	m_DemoRecorder.Stop();
 	GameServer()->OnShutdown();
 	m_pMap->Unload();
+	m_pJobPool->WaitFor(&m_PreloadJob);
+	m_pPreloadMap->Unload();
 
-	if(m_pCurrentMapData)
-		mem_free(m_pCurrentMapData);
-	return 0;
+	m_pCurrentMapData = 0;
+	if(m_StatsFile)
+		io_close(m_StatsFile);
+	return Result;
 }
 
 void CServer::ConKick(IConsole::IResult *pResult, void *pUser)
@@ -1481,7 +2154,7 @@ void CServer::DemoRecorder_HandleAutoStart()
 		char aDate[20];
 		str_timestamp(aDate, sizeof(aDate));
 		str_format(aFilename, sizeof(aFilename), "demos/%s_%s.demo", "auto/autorecord", aDate);
-		m_DemoRecorder.Start(Storage(), m_pConsole, aFilename, GameServer()->NetVersion(), m_aCurrentMap, m_CurrentMapCrc, "server");
+		m_DemoRecorder.Start(Storage(), m_pConsole, aFilename, GameServer()->NetVersion(), m_aCurrentMap, m_CurrentMapCrc, "server", g_Config.m_SvDemoThread);
 		if(g_Config.m_SvAutoDemoMax)
 		{
 			// clean up auto recorded demos
@@ -1508,7 +2181,7 @@ void CServer::ConRecord(IConsole::IResult *pResult, void *pUser)
 		str_timestamp(aDate, sizeof(aDate));
 		str_format(aFilename, sizeof(aFilename), "demos/demo_%s.demo", aDate);
 	}
-	pServer->m_DemoRecorder.Start(pServer->Storage(), pServer->Console(), aFilename, pServer->GameServer()->NetVersion(), pServer->m_aCurrentMap, pServer->m_CurrentMapCrc, "server");
+	pServer->m_DemoRecorder.Start(pServer->Storage(), pServer->Console(), aFilename, pServer->GameServer()->NetVersion(), pServer->m_aCurrentMap, pServer->m_CurrentMapCrc, "server", g_Config.m_SvDemoThread);
 }
 
 void CServer::ConStopRecord(IConsole::IResult *pResult, void *pUser)
@@ -1521,6 +2194,76 @@ void CServer::ConMapReload(IConsole::IResult *pResult, void *pUser)
 	((CServer *)pUser)->m_MapReload = 1;
 }
 
+void CServer::ConBandwidthDump(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	char aBuf[512];
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pThis->m_aClients[i].m_State == CClient::STATE_EMPTY)
+			continue;
+
+		const CClient *pClient = &pThis->m_aClients[i];
+		const CNetConnectionStats *pNetStats = pThis->m_NetServer.ClientStats(i);
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' snaps=%d empty=%d parts=%d snap=%lldkb snap_ratio=%.2f sent=%lldkb/%lld packets net_ratio=%.2f resent=%lld recv=%lldkb/%lld packets",
+			i, pClient->m_aName, pClient->m_NumSnaps, pClient->m_NumEmptySnaps, pClient->m_NumSnapParts,
+			(long long)(pClient->m_SnapBytes/1024), pClient->m_SnapDeltaBytes ? pClient->m_SnapBytes/(float)pClient->m_SnapDeltaBytes : 1.0f,
+			(long long)(pNetStats->m_SentBytes/1024), (long long)pNetStats->m_SentPackets,
+			pNetStats->m_SentUncompressedBytes ? pNetStats->m_SentBytes/(float)pNetStats->m_SentUncompressedBytes : 1.0f,
+			(long long)pNetStats->m_ResentChunks, (long long)(pNetStats->m_RecvBytes/1024), (long long)pNetStats->m_RecvPackets);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bandwidth", aBuf);
+	}
+
+	if(!g_Config.m_SvStatsInterval)
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bandwidth", "the item types are only counted while sv_stats_interval is set");
+	for(int t = 0; t < MAX_SNAP_ITEMTYPES; t++)
+	{
+		if(!pThis->m_aSnapItemUpdates[t])
+			continue;
+
+		str_format(aBuf, sizeof(aBuf), "type=%d name=%s delta=%lldkb updates=%lld avg=%lldb", t, pThis->GameServer()->GetItemName(t),
+			(long long)(pThis->m_aSnapItemBits[t]/8/1024), (long long)pThis->m_aSnapItemUpdates[t],
+			(long long)(pThis->m_aSnapItemBits[t]/8/pThis->m_aSnapItemUpdates[t]));
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bandwidth", aBuf);
+	}
+}
+
+void CServer::ConPerfDump(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	if(!pThis->m_TickProfiler.Enabled())
+	{
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "profiling is off, enable it with sv_profile 1");
+		return;
+	}
+
+	char aBuf[256];
+	for(int i = 0; i < pThis->m_TickProfiler.NumPhases(); i++)
+	{
+		CTickProfiler::CSummary Summary;
+		pThis->m_TickProfiler.GetSummary(i, &Summary);
+		if(!Summary.m_NumSamples)
+			continue;
+		str_format(aBuf, sizeof(aBuf), "%-20s samples=%d p50=%dus p99=%dus max=%dus", Summary.m_pName, Summary.m_NumSamples, Summary.m_P50, Summary.m_P99, Summary.m_Max);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", aBuf);
+	}
+}
+
+void CServer::ConTickStats(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "overruns=%d skipped_ticks=%d max_ticks_behind=%d max_catchup=%d",
+		pThis->m_NumTickOverruns, pThis->m_NumSkippedTicks, pThis->m_MaxTicksBehind, g_Config.m_SvMaxCatchupTicks);
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	if(pThis->m_aLastOverrun[0])
+	{
+		str_format(aBuf, sizeof(aBuf), "last overrun: %s", pThis->m_aLastOverrun);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+}
+
 void CServer::ConLogout(IConsole::IResult *pResult, void *pUser)
 {
 	CServer *pServer = (CServer *)pUser;
@@ -1547,6 +2290,7 @@ void CServer::ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserD
 	if(pResult->NumArguments())
 	{
 		str_clean_whitespaces(g_Config.m_SvName);
+		((CServer *)pUserData)->ExpireServerInfo();
 		((CServer *)pUserData)->SendServerInfo(-1);
 	}
 }
@@ -1612,6 +2356,7 @@ void CServer::RegisterCommands()
 	m_pGameServer = Kernel()->RequestInterface<IGameServer>();
 	m_pMap = Kernel()->RequestInterface<IEngineMap>();
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
+	m_pJobPool = Kernel()->RequestInterface<IEngine>()->JobPool();
 
 	// register console commands
 	Console()->Register("kick", "i?r", CFGFLAG_SERVER, ConKick, this, "Kick player with specified id for any reason");
@@ -1623,9 +2368,15 @@ void CServer::RegisterCommands()
 	Console()->Register("stoprecord", "", CFGFLAG_SERVER, ConStopRecord, this, "Stop recording");
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
+	Console()->Register("bandwidth_dump", "", CFGFLAG_SERVER, ConBandwidthDump, this, "Show snapshot and network bandwidth per client and snapshot item type");
+	Console()->Register("perf_dump", "", CFGFLAG_SERVER, ConPerfDump, this, "Show tick phase timings (needs sv_profile 1)");
+	Console()->Register("tick_stats", "", CFGFLAG_SERVER, ConTickStats, this, "Show tick overrun counters and the last overrun");
 
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
+	Console()->Chain("sv_hostname", ConchainSpecialInfoupdate, this);
+	Console()->Chain("sv_skill_level", ConchainSpecialInfoupdate, this);
+	Console()->Chain("sv_player_slots", ConchainSpecialInfoupdate, this);
 
 	Console()->Chain("sv_max_clients_per_ip", ConchainMaxclientsperipUpdate, this);
 	Console()->Chain("mod_command", ConchainModCommandUpdate, this);
@@ -1754,7 +2505,7 @@ int main(int argc, const char **argv) // ignore_convention
 
 	// run the server
 	dbg_msg("server", "starting...");
-	pServer->Run();
+	int Result = pServer->Run();
 
 	// free
 	delete pServer;
@@ -1767,6 +2518,6 @@ int main(int argc, const char **argv) // ignore_convention
 	delete pStorage;
 	delete pConfig;
 
-	return 0;
+	return Result;
 }
 
@@ -76,6 +76,8 @@ public:
 		AUTHED_ADMIN,
 
 		MAX_RCONCMD_SEND=16,
+
+		MAX_SNAP_ITEMTYPES=64,
 	};
 
 	class CClient
@@ -120,14 +122,25 @@ public:
 		int m_Version;
 		int m_Country;
 		int m_Score;
+		int64 m_AddrKey;
 		int m_Authed;
 		int m_AuthTries;
 
 		int m_MapChunk;
+		int m_MapChunkRequests;
+		int m_MapChunkWindow; // chunks allowed in flight
+		int64 m_MapResentChunks;
 		bool m_NoRconNote;
 		bool m_Quitting;
 		const IConsole::CCommandInfo *m_pRconCmdToSend;
 
+		// snapshot bandwidth accounting, reset on connect
+		int m_NumSnaps;
+		int m_NumEmptySnaps;
+		int m_NumSnapParts;
+		int64 m_SnapDeltaBytes; // before variable int compression
+		int64 m_SnapBytes;
+
 		void Reset();
 	};
 
@@ -141,6 +154,12 @@ public:
 	CServerBan m_ServerBan;
 
 	IEngineMap *m_pMap;
+	class CJobPool *m_pJobPool;
+
+	// the next map, loaded in the background while the match ends
+	IEngineMap *m_pPreloadMap;
+	CJob m_PreloadJob;
+	char m_aPreloadMap[64];
 
 	int64 m_GameStartTime;
 	int m_RunServer;
@@ -158,24 +177,59 @@ public:
 	};
 	char m_aCurrentMap[64];
 	unsigned m_CurrentMapCrc;
-	unsigned char *m_pCurrentMapData;
+	const unsigned char *m_pCurrentMapData;
 	int m_CurrentMapSize;
 	int m_MapChunksPerRequest;
 
 	int m_RconPasswordSet;
 	int m_GeneratedRconPassword;
 
+	// bandwidth accounting per snapshot item type
+	int64 m_aSnapItemBits[MAX_SNAP_ITEMTYPES];
+	int64 m_aSnapItemUpdates[MAX_SNAP_ITEMTYPES];
+
+	IOHANDLE m_StatsFile;
+	int64 m_NextStatsDump;
+
+	CTickProfiler m_TickProfiler;
+	int m_ProfilePhaseTick;
+	int m_ProfilePhaseSnapshot;
+	int m_ProfilePhaseNetwork;
+
+	// loop iterations that found more than one tick due
+	int m_NumTickOverruns;
+	int m_NumSkippedTicks;
+	int m_MaxTicksBehind;
+	char m_aLastOverrun[128];
+
+	// benchmark and input replay: clients without connections, sent messages are only counted
+	bool m_Headless;
+	int64 m_HeadlessSentChunks;
+	int64 m_HeadlessSentBytes;
+
+	// rand() gets seeded with it before each map, so a recording can be replayed
+	int m_GameSeed;
+	class CInputPlayer *m_pInputPlayer;
+	unsigned m_aReplaySnapshotCrc[MAX_CLIENTS];
+
+	// the net server answers browser info requests, it gets repacked info after each change
+	bool m_ServerInfoValid;
+
 	CDemoRecorder m_DemoRecorder;
+	CInputRecorder m_InputRecorder;
 	CRegister m_Register;
 	CMapChecker m_MapChecker;
 
 	CServer();
+	~CServer();
 
 	virtual void SetClientName(int ClientID, const char *pName);
 	virtual void SetClientClan(int ClientID, char const *pClan);
 	virtual void SetClientCountry(int ClientID, int Country);
 	virtual void SetClientScore(int ClientID, int Score);
 
+	virtual void ExpireServerInfo();
+
 	void Kick(int ClientID, const char *pReason);
 
 	void DemoRecorder_HandleAutoStart();
@@ -192,6 +246,7 @@ public:
 	bool IsBanned(int ClientID) const;
 	int GetClientInfo(int ClientID, CClientInfo *pInfo) const;
 	void GetClientAddr(int ClientID, char *pAddrStr, int Size) const;
+	int64 ClientAddrKey(int ClientID) const;
 	const char *ClientName(int ClientID) const;
 	const char *ClientClan(int ClientID) const;
 	int ClientCountry(int ClientID) const;
@@ -199,13 +254,32 @@ public:
 	int MaxClients() const;
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID);
+	virtual int SendMsgMask(CMsgPacker *pMsg, int Flags, int64 ClientMask);
+	void SendChunk(CNetChunk *pChunk);
 
 	void DoSnapshot();
+	void DoDemoSnapshot();
+	void CollectSnapItemStats(bool Discard);
+
+	void CheckTickOverrun(int64 Now);
+	void ConnectHeadlessClient(int ClientID, const char *pName);
+	void DropHeadlessClients(const char *pReason);
+	void PrintTickProfile(const char *pFrom);
+	void RunBenchmark();
+	int RunInputReplay(class CInputPlayer *pPlayer);
+	void InputRecorder_HandleAutoStart();
+
+	void DumpStats();
+	void WriteBandwidthStats(IOHANDLE File);
+	void WriteProfileStats(IOHANDLE File);
+
+	virtual CTickProfiler *TickProfiler() { return &m_TickProfiler; }
 
 	static int NewClientCallback(int ClientID, void *pUser);
 	static int DelClientCallback(int ClientID, const char *pReason, void *pUser);
 
 	void SendMap(int ClientID);
+	void SendMapData(int ClientID);
 	void SendConnectionReady(int ClientID);
 	void SendRconLine(int ClientID, const char *pLine);
 	static void SendRconLineAuthed(const char *pLine, void *pUser, bool Highlighted);
@@ -218,10 +292,13 @@ public:
 
 	void SendServerInfo(int ClientID);
 	void GenerateServerInfo(CPacker *pPacker, int Token);
+	void UpdateServerInfoConnless();
 
 	void PumpNetwork();
 
 	const char *GetMapName() const;
+	static int PreloadMapJob(void *pUser);
+	void PreloadMap(const char *pMapName);
 	int LoadMap(const char *pMapName);
 
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole);
@@ -233,6 +310,9 @@ public:
 	static void ConRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConStopRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
+	static void ConBandwidthDump(IConsole::IResult *pResult, void *pUser);
+	static void ConPerfDump(IConsole::IResult *pResult, void *pUser);
+	static void ConTickStats(IConsole::IResult *pResult, void *pUser);
 	static void ConSaveConfig(IConsole::IResult *pResult, void *pUser);
 	static void ConLogout(IConsole::IResult *pResult, void *pUser);
 	static void ConchainSpecialInfoupdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
@@ -76,7 +76,10 @@ MACRO_CONFIG_STR(SvSkipEvents, sv_skip_events, 128, "5", CFGFLAG_SAVE | CFGFLAG_
 MACRO_CONFIG_INT(SvMaxClients, sv_max_clients, 8, 1, MAX_CLIENTS, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of clients that are allowed on a server")
 MACRO_CONFIG_INT(SvMaxClientsPerIP, sv_max_clients_per_ip, 4, 1, MAX_CLIENTS, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of clients with the same IP that can connect to the server")
 MACRO_CONFIG_INT(SvMapDownloadSpeed, sv_map_download_speed, 2, 1, 16, CFGFLAG_SAVE|CFGFLAG_SERVER, "Number of map data packages a client gets on each request")
+MACRO_CONFIG_INT(SvNetThread, sv_net_thread, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Do socket I/O and packet decoding on a separate thread")
+MACRO_CONFIG_INT(SvMapWindow, sv_map_window, 16, 1, 16, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of map data packages a client can have in flight")
 MACRO_CONFIG_INT(SvHighBandwidth, sv_high_bandwidth, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Use high bandwidth mode. Doubles the bandwidth required for the server. LAN use only")
+MACRO_CONFIG_INT(SvInfoRateLimit, sv_info_rate_limit, 10, 0, 1000, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of server info requests per second from one address (0 = unlimited)")
 MACRO_CONFIG_INT(SvRegister, sv_register, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Register server with master server for public listing")
 MACRO_CONFIG_STR(SvRconPassword, sv_rcon_password, 32, "", CFGFLAG_SAVE|CFGFLAG_SERVER, "Remote console password (full access)")
 MACRO_CONFIG_STR(SvRconModPassword, sv_rcon_mod_password, 32, "", CFGFLAG_SAVE|CFGFLAG_SERVER, "Remote console password for moderators (limited access)")
@@ -84,6 +87,17 @@ MACRO_CONFIG_INT(SvRconMaxTries, sv_rcon_max_tries, 3, 0, 100, CFGFLAG_SAVE|CFGF
 MACRO_CONFIG_INT(SvRconBantime, sv_rcon_bantime, 5, 0, 1440, CFGFLAG_SAVE|CFGFLAG_SERVER, "The time a client gets banned if remote console authentication fails. 0 makes it just use kick")
 MACRO_CONFIG_INT(SvAutoDemoRecord, sv_auto_demo_record, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Automatically record demos")
 MACRO_CONFIG_INT(SvAutoDemoMax, sv_auto_demo_max, 10, 0, 1000, CFGFLAG_SAVE|CFGFLAG_SERVER, "Maximum number of automatically recorded demos (0 = no limit)")
+MACRO_CONFIG_INT(SvDemoThread, sv_demo_thread, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Do delta, compression and writing of demos on a separate thread")
+MACRO_CONFIG_STR(SvStatsFile, sv_stats_file, 128, "stats.jsonl", CFGFLAG_SAVE|CFGFLAG_SERVER, "File to write periodic server statistics to (one json object per line)")
+MACRO_CONFIG_INT(SvStatsInterval, sv_stats_interval, 0, 0, 3600, CFGFLAG_SAVE|CFGFLAG_SERVER, "Seconds between server statistics dumps (0 = off)")
+MACRO_CONFIG_INT(SvMaxCatchupTicks, sv_max_catchup_ticks, 10, 0, 1000, CFGFLAG_SAVE|CFGFLAG_SERVER, "Ticks the server runs at most to catch up after a stall, the rest is skipped (0 = no limit)")
+MACRO_CONFIG_INT(SvProfile, sv_profile, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Time the phases of each server tick (see perf_dump and sv_stats_interval)")
+MACRO_CONFIG_INT(SvBenchTicks, sv_bench_ticks, 0, 0, 1000000, CFGFLAG_SERVER, "Run this many ticks as fast as possible without network, print the timings and quit (0 = normal server)")
+MACRO_CONFIG_INT(SvBenchClients, sv_bench_clients, 8, 0, MAX_PLAYERS, CFGFLAG_SERVER, "Number of scripted pseudo clients in the benchmark")
+MACRO_CONFIG_INT(SvBenchDummies, sv_bench_dummies, 8, 0, MAX_PLAYERS, CFGFLAG_SERVER, "Number of dummies in the benchmark")
+MACRO_CONFIG_INT(SvBenchSeed, sv_bench_seed, 1, 0, 0x7fffffff, CFGFLAG_SERVER, "Random seed of the benchmark")
+MACRO_CONFIG_INT(SvInputRecord, sv_input_record, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_SERVER, "Record the client inputs of every map to inputs/ for sv_input_replay")
+MACRO_CONFIG_STR(SvInputReplay, sv_input_replay, 128, "", CFGFLAG_SERVER, "Replay an input recording without network, compare the snapshots and quit")
 
 MACRO_CONFIG_STR(EcBindaddr, ec_bindaddr, 128, "localhost", CFGFLAG_SAVE|CFGFLAG_ECON, "Address to bind the external console to. Anything but 'localhost' is dangerous")
 MACRO_CONFIG_INT(EcPort, ec_port, 0, 0, 0, CFGFLAG_SAVE|CFGFLAG_ECON, "Port to use for the external console")
@@ -12,6 +12,7 @@ class CConsole : public IConsole
 	{
 	public:
 		CCommand *m_pNext;
+		CCommand *m_pNextHash;
 		int m_Flags;
 		bool m_Temp;
 		FCommandCallback m_pfnCallback;
@@ -37,6 +38,13 @@ class CConsole : public IConsole
 	const char *m_paStrokeStr[2];
 	CCommand *m_pFirstCommand;
 
+	// case insensitive name index, the list above stays the sorted view
+	enum
+	{
+		COMMAND_HASH_SIZE=512,
+	};
+	CCommand *m_apCommandHash[COMMAND_HASH_SIZE];
+
 	class CExecFile
 	{
 	public:
@@ -152,6 +160,9 @@ class CConsole : public IConsole
 	} m_ExecutionQueue;
 
 	void AddCommandSorted(CCommand *pCommand);
+	static unsigned HashCommandName(const char *pName);
+	void AddCommandHash(CCommand *pCommand);
+	void RemoveCommandHash(CCommand *pCommand);
 	CCommand *FindCommand(const char *pName, int FlagMask);
 
 public:
@@ -4,6 +4,7 @@
 #include <base/system.h>
 #include <engine/storage.h>
 #include "datafile.h"
+#include "jobs.h"
 #include <zlib.h>
 
 static const int DEBUG=0;
@@ -57,7 +58,9 @@ struct CDatafileInfo
 
 struct CDatafile
 {
-	IOHANDLE m_File;
+	// the whole file, the data gets decompressed from there when it is needed
+	unsigned char *m_pFileData;
+	unsigned m_FileSize;
 	unsigned m_Crc;
 	CDatafileInfo m_Info;
 	CDatafileHeader m_Header;
@@ -77,38 +80,37 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 		return false;
 	}
 
-
-	// take the CRC of the file and store it
-	unsigned Crc = crc32(0L, 0x0, 0);
+	// read the whole file in one go
+	unsigned FileSize = (unsigned)io_length(File);
+	unsigned char *pFileData = (unsigned char *)mem_alloc(max(FileSize, 1u), 1);
+	if(io_read(File, pFileData, FileSize) != FileSize)
 	{
-		enum
-		{
-			BUFFER_SIZE = 64*1024
-		};
-
-		unsigned char aBuffer[BUFFER_SIZE];
-
-		while(1)
-		{
-			unsigned Bytes = io_read(File, aBuffer, BUFFER_SIZE);
-			if(Bytes <= 0)
-				break;
-			Crc = crc32(Crc, aBuffer, Bytes); // ignore_convention
-		}
-
-		io_seek(File, 0, IOSEEK_START);
+		dbg_msg("datafile", "could not read '%s'", pFilename);
+		mem_free(pFileData);
+		io_close(File);
+		return false;
 	}
+	io_close(File);
 
+	// take the CRC of the file and store it, the only pass over the whole file
+	unsigned Crc = crc32(0L, 0x0, 0);
+	Crc = crc32(Crc, pFileData, FileSize); // ignore_convention
 
 	// TODO: change this header
 	CDatafileHeader Header;
-	io_read(File, &Header, sizeof(Header));
+	if(FileSize < sizeof(Header))
+	{
+		dbg_msg("datafile", "file too small. size=%d", FileSize);
+		mem_free(pFileData);
+		return false;
+	}
+	mem_copy(&Header, pFileData, sizeof(Header));
 	if(Header.m_aID[0] != 'A' || Header.m_aID[1] != 'T' || Header.m_aID[2] != 'A' || Header.m_aID[3] != 'D')
 	{
 		if(Header.m_aID[0] != 'D' || Header.m_aID[1] != 'A' || Header.m_aID[2] != 'T' || Header.m_aID[3] != 'A')
 		{
 			dbg_msg("datafile", "wrong signature. %x %x %x %x", Header.m_aID[0], Header.m_aID[1], Header.m_aID[2], Header.m_aID[3]);
-			io_close(File);
+			mem_free(pFileData);
 			return 0;
 		}
 	}
@@ -119,7 +121,7 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	if(Header.m_Version != 3 && Header.m_Version != 4)
 	{
 		dbg_msg("datafile", "wrong version. version=%x", Header.m_Version);
-		io_close(File);
+		mem_free(pFileData);
 		return 0;
 	}
 
@@ -140,22 +142,24 @@ bool CDataFileReader::Open(class IStorage *pStorage, const char *pFilename, int
 	pTmpDataFile->m_DataStartOffset = sizeof(CDatafileHeader) + Size;
 	pTmpDataFile->m_ppDataPtrs = (char**)(pTmpDataFile+1);
 	pTmpDataFile->m_pData = (char *)(pTmpDataFile+1)+Header.m_NumRawData*sizeof(char *);
-	pTmpDataFile->m_File = File;
+	pTmpDataFile->m_pFileData = pFileData;
+	pTmpDataFile->m_FileSize = FileSize;
 	pTmpDataFile->m_Crc = Crc;
 
 	// clear the data pointers
 	mem_zero(pTmpDataFile->m_ppDataPtrs, Header.m_NumRawData*sizeof(void*));
 
-	// read types, offsets, sizes and item data
-	unsigned ReadSize = io_read(File, pTmpDataFile->m_pData, Size);
-	if(ReadSize != Size)
+	// copy types, offsets, sizes and item data
+	unsigned ReadSize = min(Size, FileSize-(unsigned)sizeof(CDatafileHeader));
+	if(ReadSize != Size || (unsigned)pTmpDataFile->m_DataStartOffset+Header.m_DataSize > FileSize)
 	{
-		io_close(pTmpDataFile->m_File);
+		mem_free(pFileData);
 		mem_free(pTmpDataFile);
 		pTmpDataFile = 0;
 		dbg_msg("datafile", "couldn't load the whole thing, wanted=%d got=%d", Size, ReadSize);
 		return false;
 	}
+	mem_copy(pTmpDataFile->m_pData, pFileData+sizeof(CDatafileHeader), Size);
 
 	Close();
 	m_pDataFile = pTmpDataFile;
@@ -240,6 +244,42 @@ int CDataFileReader::GetDataSize(int Index) const
 	return m_pDataFile->m_Info.m_pDataOffsets[Index+1]-m_pDataFile->m_Info.m_pDataOffsets[Index];
 }
 
+// returns the size of the loaded data
+int CDataFileReader::LoadDataImpl(int Index)
+{
+	int DataSize = GetDataSize(Index);
+	int Offset = m_pDataFile->m_Info.m_pDataOffsets[Index];
+	if(Offset < 0 || DataSize < 0 || Offset+DataSize > m_pDataFile->m_Header.m_DataSize)
+	{
+		dbg_msg("datafile", "broken data index=%d offset=%d size=%d", Index, Offset, DataSize);
+		return -1;
+	}
+	const unsigned char *pSrc = m_pDataFile->m_pFileData+m_pDataFile->m_DataStartOffset+Offset;
+
+	if(m_pDataFile->m_Header.m_Version == 4)
+	{
+		// v4 has compressed data
+		unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
+		unsigned long s;
+
+		if(DEBUG)
+			dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%d", Index, DataSize, (int)UncompressedSize);
+		m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(UncompressedSize, 1);
+
+		// decompress the data, TODO: check for errors
+		s = UncompressedSize;
+		uncompress((Bytef*)m_pDataFile->m_ppDataPtrs[Index], &s, (const Bytef*)pSrc, DataSize); // ignore_convention
+		return (int)s;
+	}
+
+	// load the data
+	if(DEBUG)
+		dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
+	m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(DataSize, 1);
+	mem_copy(m_pDataFile->m_ppDataPtrs[Index], pSrc, DataSize);
+	return DataSize;
+}
+
 void *CDataFileReader::GetDataImpl(int Index, int Swap)
 {
 	if(!m_pDataFile) { return 0; }
@@ -247,52 +287,59 @@ void *CDataFileReader::GetDataImpl(int Index, int Swap)
 	// load it if needed
 	if(!m_pDataFile->m_ppDataPtrs[Index])
 	{
-		// fetch the data size
-		int DataSize = GetDataSize(Index);
 #if defined(CONF_ARCH_ENDIAN_BIG)
-		int SwapSize = DataSize;
+		int Size = LoadDataImpl(Index);
+		if(Swap && Size > 0)
+			swap_endian(m_pDataFile->m_ppDataPtrs[Index], sizeof(int), Size/sizeof(int));
+#else
+		LoadDataImpl(Index);
 #endif
+	}
 
-		if(m_pDataFile->m_Header.m_Version == 4)
-		{
-			// v4 has compressed data
-			void *pTemp = (char *)mem_alloc(DataSize, 1);
-			unsigned long UncompressedSize = m_pDataFile->m_Info.m_pDataSizes[Index];
-			unsigned long s;
-
-			dbg_msg("datafile", "loading data index=%d size=%d uncompressed=%d", Index, DataSize, UncompressedSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(UncompressedSize, 1);
+	return m_pDataFile->m_ppDataPtrs[Index];
+}
 
-			// read the compressed data
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, pTemp, DataSize);
+struct CLoadDataBatch
+{
+	CDataFileReader *m_pReader;
+	const int *m_pIndices;
+};
 
-			// decompress the data, TODO: check for errors
-			s = UncompressedSize;
-			uncompress((Bytef*)m_pDataFile->m_ppDataPtrs[Index], &s, (Bytef*)pTemp, DataSize); // ignore_convention
-#if defined(CONF_ARCH_ENDIAN_BIG)
-			SwapSize = s;
-#endif
+void CDataFileReader::LoadDataBatch(void *pUser, int Start, int End)
+{
+	CLoadDataBatch *pBatch = (CLoadDataBatch *)pUser;
+	for(int i = Start; i < End; i++)
+		pBatch->m_pReader->LoadDataImpl(pBatch->m_pIndices[i]);
+}
 
-			// clean up the temporary buffers
-			mem_free(pTemp);
-		}
-		else
-		{
-			// load the data
-			dbg_msg("datafile", "loading data index=%d size=%d", Index, DataSize);
-			m_pDataFile->m_ppDataPtrs[Index] = (char *)mem_alloc(DataSize, 1);
-			io_seek(m_pDataFile->m_File, m_pDataFile->m_DataStartOffset+m_pDataFile->m_Info.m_pDataOffsets[Index], IOSEEK_START);
-			io_read(m_pDataFile->m_File, m_pDataFile->m_ppDataPtrs[Index], DataSize);
-		}
+void CDataFileReader::LoadData(const int *pIndices, int Num, CJobPool *pJobPool)
+{
+	if(!m_pDataFile)
+		return;
 
-#if defined(CONF_ARCH_ENDIAN_BIG)
-		if(Swap && SwapSize)
-			swap_endian(m_pDataFile->m_ppDataPtrs[Index], sizeof(int), SwapSize/sizeof(int));
-#endif
+	// every index only once and only if it isn't loaded yet
+	int *pNeeded = (int *)mem_alloc(max(Num, 1)*sizeof(int), 1);
+	int NumNeeded = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		int Index = pIndices[i];
+		if(Index < 0 || Index >= m_pDataFile->m_Header.m_NumRawData || m_pDataFile->m_ppDataPtrs[Index])
+			continue;
+		bool Dup = false;
+		for(int k = 0; k < NumNeeded && !Dup; k++)
+			Dup = pNeeded[k] == Index;
+		if(!Dup)
+			pNeeded[NumNeeded++] = Index;
 	}
 
-	return m_pDataFile->m_ppDataPtrs[Index];
+	CLoadDataBatch Batch;
+	Batch.m_pReader = this;
+	Batch.m_pIndices = pNeeded;
+	if(pJobPool)
+		pJobPool->ParallelFor(NumNeeded, 1, LoadDataBatch, &Batch);
+	else
+		LoadDataBatch(&Batch, 0, NumNeeded);
+	mem_free(pNeeded);
 }
 
 void *CDataFileReader::GetData(int Index)
@@ -395,7 +442,7 @@ bool CDataFileReader::Close()
 	for(i = 0; i < m_pDataFile->m_Header.m_NumRawData; i++)
 		mem_free(m_pDataFile->m_ppDataPtrs[i]);
 
-	io_close(m_pDataFile->m_File);
+	mem_free(m_pDataFile->m_pFileData);
 	mem_free(m_pDataFile);
 	m_pDataFile = 0;
 	return true;
@@ -407,6 +454,18 @@ unsigned CDataFileReader::Crc() const
 	return m_pDataFile->m_Crc;
 }
 
+const unsigned char *CDataFileReader::FileData() const
+{
+	if(!m_pDataFile) return 0;
+	return m_pDataFile->m_pFileData;
+}
+
+unsigned CDataFileReader::FileSize() const
+{
+	if(!m_pDataFile) return 0;
+	return m_pDataFile->m_FileSize;
+}
+
 
 CDataFileWriter::CDataFileWriter()
 {
@@ -7,18 +7,23 @@
 class CDataFileReader
 {
 	struct CDatafile *m_pDataFile;
+	int LoadDataImpl(int Index);
 	void *GetDataImpl(int Index, int Swap);
+	static void LoadDataBatch(void *pUser, int Start, int End);
 public:
 	CDataFileReader() : m_pDataFile(0) {}
 	~CDataFileReader() { Close(); }
 
 	bool IsOpen() const { return m_pDataFile != 0; }
+	void Swap(CDataFileReader *pOther) { struct CDatafile *pTemp = m_pDataFile; m_pDataFile = pOther->m_pDataFile; pOther->m_pDataFile = pTemp; }
 
 	bool Open(class IStorage *pStorage, const char *pFilename, int StorageType);
 	bool Close();
 
 	void *GetData(int Index);
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
+	// loads the data like GetData, spread over the job pool if there is one
+	void LoadData(const int *pIndices, int Num, class CJobPool *pJobPool);
 	int GetDataSize(int Index) const;
 	void ReplaceData(int Index, char *pData);
 	void UnloadData(int Index);
@@ -31,6 +36,9 @@ public:
 	void Unload();
 
 	unsigned Crc() const;
+	// the whole file as it was read
+	const unsigned char *FileData() const;
+	unsigned FileSize() const;
 };
 
 // write access
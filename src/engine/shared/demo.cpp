@@ -16,6 +16,8 @@ static const unsigned char gs_aHeaderMarker[7] = {'T', 'W', 'D', 'E', 'M', 'O',
 static const unsigned char gs_ActVersion = 4;
 static const int gs_LengthOffset = 152;
 static const int gs_NumMarkersOffset = 176;
+static const int gs_IndexMarker = 0x54574b49; // "TWKI"
+static const int gs_IndexVersion = 1;
 
 
 CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta)
@@ -23,10 +25,25 @@ CDemoRecorder::CDemoRecorder(class CSnapshotDelta *pSnapshotDelta)
 	m_File = 0;
 	m_LastTickMarker = -1;
 	m_pSnapshotDelta = pSnapshotDelta;
+	m_pKeyFrames = 0;
+	m_NumKeyFrames = 0;
+	m_MaxKeyFrames = 0;
+	m_pThread = 0;
+	m_ThreadShutdown = false;
+	m_pQueue = 0;
+	m_QueueRead = 0;
+	m_QueueWrite = 0;
+	m_pThreadSnapshotDelta = 0;
+	semaphore_init(&m_QueueSemaphore);
+}
+
+CDemoRecorder::~CDemoRecorder()
+{
+	semaphore_destroy(&m_QueueSemaphore);
 }
 
 // Record
-int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, unsigned Crc, const char *pType)
+int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, unsigned Crc, const char *pType, bool Threaded)
 {
 	CDemoHeader Header;
 	if(m_File)
@@ -105,16 +122,30 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 	}
 	io_close(MapFile);
 
+	m_FilePos = io_tell(DemoFile);
+	m_WriteBufferSize = 0;
 	m_LastKeyFrame = -1;
 	m_LastTickMarker = -1;
 	m_FirstTick = -1;
 	m_NumTimelineMarkers = 0;
+	m_NumKeyFrames = 0;
 
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
 	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "demo_recorder", aBuf);
 	m_File = DemoFile;
 
+	if(Threaded)
+	{
+		m_pQueue = (unsigned char *)mem_alloc(QUEUE_SIZE, sizeof(int));
+		m_QueueRead = 0;
+		m_QueueWrite = 0;
+		m_NumQueueStalls = 0;
+		m_pThreadSnapshotDelta = new CSnapshotDelta(*m_pSnapshotDelta);
+		m_ThreadShutdown = false;
+		m_pThread = thread_init(RecordThread, this);
+	}
+
 	return 0;
 }
 
@@ -128,6 +159,12 @@ int CDemoRecorder::Start(class IStorage *pStorage, class IConsole *pConsole, con
 		7 = Not set
 		5-6	= Type
 		0-4	= Size
+
+	Keyframe index, behind the last tick
+		chunks of type 0 with the tick and file position of every keyframe as
+		difference to the one before, then a footer chunk of type 0 with
+		marker, version, index position, number of keyframes, first and last tick.
+		players without index support ignore chunks of type 0
 */
 
 enum
@@ -139,13 +176,136 @@ enum
 	CHUNKMASK_TYPE = 0x60,
 	CHUNKMASK_SIZE = 0x1f,
 
+	CHUNKTYPE_INDEX = 0,
 	CHUNKTYPE_SNAPSHOT = 1,
 	CHUNKTYPE_MESSAGE = 2,
 	CHUNKTYPE_DELTA = 3,
 
-	CHUNKFLAG_BIGSIZE = 0x10
+	CHUNKFLAG_BIGSIZE = 0x10,
+
+	INDEX_CHUNK_KEYFRAMES = 1024,
+	INDEX_FOOTER_SIZE = 6,
+	INDEX_FOOTER_MAXCHUNK = 64,
 };
 
+void CDemoRecorder::RecordThread(void *pUser)
+{
+	CDemoRecorder *pThis = (CDemoRecorder *)pUser;
+
+	while(1)
+	{
+		semaphore_wait(&pThis->m_QueueSemaphore);
+
+		// everything queued before the shutdown still gets written
+		bool Shutdown = pThis->m_ThreadShutdown;
+		sync_barrier();
+		pThis->ProcessQueue();
+		if(Shutdown)
+			break;
+	}
+}
+
+void CDemoRecorder::Queue(int Type, int Tick, const void *pData, int Size)
+{
+	// items are 4 byte aligned, a wrap item at the end sends the reader back to the start.
+	// there is always room left for one at the write position
+	int ItemSize = sizeof(CQueueItem) + ((Size+3)&~3);
+	int Pos;
+	bool Stalled = false;
+	while(1)
+	{
+		int Read = m_QueueRead;
+		int Write = m_QueueWrite;
+		if(Write >= Read)
+		{
+			if(QUEUE_SIZE-Write >= ItemSize+(int)sizeof(CQueueItem))
+			{
+				Pos = Write;
+				break;
+			}
+			if(Read > ItemSize)
+			{
+				((CQueueItem *)(m_pQueue+Write))->m_Type = QUEUEITEM_WRAP;
+				sync_barrier();
+				m_QueueWrite = 0;
+				Pos = 0;
+				break;
+			}
+		}
+		else if(Read-Write > ItemSize)
+		{
+			Pos = Write;
+			break;
+		}
+
+		// full, the recording thread has to catch up
+		if(!Stalled)
+		{
+			Stalled = true;
+			m_NumQueueStalls++;
+			semaphore_signal(&m_QueueSemaphore);
+		}
+		thread_yield();
+	}
+
+	CQueueItem *pItem = (CQueueItem *)(m_pQueue+Pos);
+	pItem->m_Type = Type;
+	pItem->m_Tick = Tick;
+	pItem->m_Size = Size;
+	mem_copy(pItem+1, pData, Size);
+	sync_barrier();
+	m_QueueWrite = Pos+ItemSize;
+
+	// messages wait for the snapshot of their tick
+	if(Type == QUEUEITEM_SNAPSHOT)
+		semaphore_signal(&m_QueueSemaphore);
+}
+
+void CDemoRecorder::ProcessQueue()
+{
+	int Read = m_QueueRead;
+	while(Read != m_QueueWrite)
+	{
+		sync_barrier();
+		CQueueItem *pItem = (CQueueItem *)(m_pQueue+Read);
+		if(pItem->m_Type == QUEUEITEM_WRAP)
+		{
+			Read = 0;
+			m_QueueRead = Read;
+			continue;
+		}
+
+		if(pItem->m_Type == QUEUEITEM_SNAPSHOT)
+			DoRecordSnapshot(pItem->m_Tick, pItem+1, pItem->m_Size);
+		else
+			Write(CHUNKTYPE_MESSAGE, pItem+1, pItem->m_Size);
+
+		Read += sizeof(CQueueItem) + ((pItem->m_Size+3)&~3);
+		sync_barrier();
+		m_QueueRead = Read;
+	}
+}
+
+void CDemoRecorder::WriteData(const void *pData, int Size)
+{
+	if(m_WriteBufferSize+Size > (int)sizeof(m_aWriteBuffer))
+		FlushWriteBuffer();
+	if(Size > (int)sizeof(m_aWriteBuffer))
+		io_write(m_File, pData, Size);
+	else
+	{
+		mem_copy(m_aWriteBuffer+m_WriteBufferSize, pData, Size);
+		m_WriteBufferSize += Size;
+	}
+	m_FilePos += Size;
+}
+
+void CDemoRecorder::FlushWriteBuffer()
+{
+	io_write(m_File, m_aWriteBuffer, m_WriteBufferSize);
+	m_WriteBufferSize = 0;
+}
+
 void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 {
 	if(m_LastTickMarker == -1 || Tick-m_LastTickMarker > 63 || Keyframe)
@@ -158,15 +318,32 @@ void CDemoRecorder::WriteTickMarker(int Tick, int Keyframe)
 		aChunk[4] = (Tick)&0xff;
 
 		if(Keyframe)
+		{
 			aChunk[0] |= CHUNKTICKFLAG_KEYFRAME;
 
-		io_write(m_File, aChunk, sizeof(aChunk));
+			if(m_NumKeyFrames == m_MaxKeyFrames)
+			{
+				m_MaxKeyFrames = max(m_MaxKeyFrames*2, 256);
+				CDemoKeyFrame *pKeyFrames = (CDemoKeyFrame *)mem_alloc(m_MaxKeyFrames*sizeof(CDemoKeyFrame), 1);
+				if(m_pKeyFrames)
+				{
+					mem_copy(pKeyFrames, m_pKeyFrames, m_NumKeyFrames*sizeof(CDemoKeyFrame));
+					mem_free(m_pKeyFrames);
+				}
+				m_pKeyFrames = pKeyFrames;
+			}
+			m_pKeyFrames[m_NumKeyFrames].m_Filepos = m_FilePos;
+			m_pKeyFrames[m_NumKeyFrames].m_Tick = Tick;
+			m_NumKeyFrames++;
+		}
+
+		WriteData(aChunk, sizeof(aChunk));
 	}
 	else
 	{
 		unsigned char aChunk[1];
 		aChunk[0] = CHUNKTYPEFLAG_TICKMARKER | (Tick-m_LastTickMarker);
-		io_write(m_File, aChunk, sizeof(aChunk));
+		WriteData(aChunk, sizeof(aChunk));
 	}
 
 	m_LastTickMarker = Tick;
@@ -205,7 +382,7 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 	if(Size < 30)
 	{
 		aChunk[0] |= Size;
-		io_write(m_File, aChunk, 1);
+		WriteData(aChunk, 1);
 	}
 	else
 	{
@@ -213,21 +390,29 @@ void CDemoRecorder::Write(int Type, const void *pData, int Size)
 		{
 			aChunk[0] |= 30;
 			aChunk[1] = Size&0xff;
-			io_write(m_File, aChunk, 2);
+			WriteData(aChunk, 2);
 		}
 		else
 		{
 			aChunk[0] |= 31;
 			aChunk[1] = Size&0xff;
 			aChunk[2] = Size>>8;
-			io_write(m_File, aChunk, 3);
+			WriteData(aChunk, 3);
 		}
 	}
 
-	io_write(m_File, aBuffer2, Size);
+	WriteData(aBuffer2, Size);
 }
 
 void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
+{
+	if(m_pThread)
+		Queue(QUEUEITEM_SNAPSHOT, Tick, pData, Size);
+	else
+		DoRecordSnapshot(Tick, pData, Size);
+}
+
+void CDemoRecorder::DoRecordSnapshot(int Tick, const void *pData, int Size)
 {
 	if(m_LastKeyFrame == -1 || (Tick-m_LastKeyFrame) > SERVER_TICK_SPEED*5)
 	{
@@ -249,7 +434,8 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 		// write tickmarker
 		WriteTickMarker(Tick, 0);
 
-		DeltaSize = m_pSnapshotDelta->CreateDelta((CSnapshot*)m_aLastSnapshotData, (CSnapshot*)pData, &aDeltaData);
+		CSnapshotDelta *pSnapshotDelta = m_pThreadSnapshotDelta ? m_pThreadSnapshotDelta : m_pSnapshotDelta;
+		DeltaSize = pSnapshotDelta->CreateDelta((CSnapshot*)m_aLastSnapshotData, (CSnapshot*)pData, &aDeltaData);
 		if(DeltaSize)
 		{
 			// record delta
@@ -261,7 +447,40 @@ void CDemoRecorder::RecordSnapshot(int Tick, const void *pData, int Size)
 
 void CDemoRecorder::RecordMessage(const void *pData, int Size)
 {
-	Write(CHUNKTYPE_MESSAGE, pData, Size);
+	if(m_pThread)
+	{
+		if(m_File)
+			Queue(QUEUEITEM_MESSAGE, 0, pData, Size);
+	}
+	else
+		Write(CHUNKTYPE_MESSAGE, pData, Size);
+}
+
+void CDemoRecorder::WriteKeyFrameIndex()
+{
+	if(!m_NumKeyFrames)
+		return;
+
+	int IndexPos = m_FilePos;
+	int aData[INDEX_CHUNK_KEYFRAMES*2];
+	int LastTick = 0;
+	long LastFilepos = 0;
+	for(int i = 0; i < m_NumKeyFrames; i += INDEX_CHUNK_KEYFRAMES)
+	{
+		int Num = min(m_NumKeyFrames-i, (int)INDEX_CHUNK_KEYFRAMES);
+		for(int k = 0; k < Num; k++)
+		{
+			const CDemoKeyFrame *pKeyFrame = &m_pKeyFrames[i+k];
+			aData[k*2] = pKeyFrame->m_Tick-LastTick;
+			aData[k*2+1] = (int)(pKeyFrame->m_Filepos-LastFilepos);
+			LastTick = pKeyFrame->m_Tick;
+			LastFilepos = pKeyFrame->m_Filepos;
+		}
+		Write(CHUNKTYPE_INDEX, aData, Num*2*sizeof(int));
+	}
+
+	int aFooter[INDEX_FOOTER_SIZE] = {gs_IndexMarker, gs_IndexVersion, IndexPos, m_NumKeyFrames, m_FirstTick, m_LastTickMarker};
+	Write(CHUNKTYPE_INDEX, aFooter, sizeof(aFooter));
 }
 
 int CDemoRecorder::Stop()
@@ -269,6 +488,32 @@ int CDemoRecorder::Stop()
 	if(!m_File)
 		return -1;
 
+	if(m_pThread)
+	{
+		m_ThreadShutdown = true;
+		semaphore_signal(&m_QueueSemaphore);
+		thread_wait(m_pThread);
+		m_pThread = 0;
+		mem_free(m_pQueue);
+		m_pQueue = 0;
+		delete m_pThreadSnapshotDelta;
+		m_pThreadSnapshotDelta = 0;
+
+		if(m_NumQueueStalls)
+		{
+			char aBuf[128];
+			str_format(aBuf, sizeof(aBuf), "the game had to wait for the recording %d times", m_NumQueueStalls);
+			m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_recorder", aBuf);
+		}
+	}
+
+	WriteKeyFrameIndex();
+	FlushWriteBuffer();
+	mem_free(m_pKeyFrames);
+	m_pKeyFrames = 0;
+	m_NumKeyFrames = 0;
+	m_MaxKeyFrames = 0;
+
 	// add the demo length to the header
 	io_seek(m_File, gs_LengthOffset, IOSEEK_START);
 	int DemoLength = Length();
@@ -396,6 +641,105 @@ int CDemoPlayer::ReadChunkHeader(int *pType, int *pSize, int *pTick)
 	return 0;
 }
 
+static int DecompressChunk(const void *pData, int Size, void *pOutput, int OutputSize, char *pBuffer, int BufferSize)
+{
+	int DataSize = CNetBase::Decompress(pData, Size, pBuffer, BufferSize);
+	if(DataSize < 0)
+		return -1;
+	return CVariableInt::Decompress(pBuffer, DataSize, pOutput, OutputSize);
+}
+
+bool CDemoPlayer::ReadKeyFrameIndex()
+{
+	long StartPos = io_tell(m_File);
+	io_seek(m_File, 0, IOSEEK_END);
+	long EndPos = io_tell(m_File);
+
+	// the footer is the last chunk, try every position that could be its header
+	unsigned char aTail[INDEX_FOOTER_MAXCHUNK];
+	int TailSize = (int)min(EndPos-StartPos, (long)sizeof(aTail));
+	int aFooter[INDEX_FOOTER_SIZE];
+	bool Found = false;
+	io_seek(m_File, EndPos-TailSize, IOSEEK_START);
+	if(io_read(m_File, aTail, TailSize) == (unsigned)TailSize)
+	{
+		for(int p = TailSize-2; p >= 0 && !Found; p--)
+		{
+			int HeaderSize;
+			if(aTail[p] < 30 && aTail[p] == TailSize-p-1)
+				HeaderSize = 1;
+			else if(aTail[p] == 30 && aTail[p+1] == TailSize-p-2)
+				HeaderSize = 2;
+			else
+				continue;
+			Found = DecompressChunk(aTail+p+HeaderSize, TailSize-p-HeaderSize, aFooter, sizeof(aFooter), m_aDecompressedData, sizeof(m_aDecompressedData)) == (int)sizeof(aFooter) &&
+				aFooter[0] == gs_IndexMarker && aFooter[1] == gs_IndexVersion;
+		}
+	}
+
+	int IndexPos = Found ? aFooter[2] : 0;
+	int Num = Found ? aFooter[3] : 0;
+	if(!Found || IndexPos < StartPos || IndexPos >= EndPos || Num <= 0 || Num > (EndPos-StartPos)/5)
+	{
+		io_seek(m_File, StartPos, IOSEEK_START);
+		return false;
+	}
+
+	// read the keyframes
+	int aData[INDEX_CHUNK_KEYFRAMES*2];
+	CDemoKeyFrame *pKeyFrames = (CDemoKeyFrame *)mem_alloc(Num*sizeof(CDemoKeyFrame), 1);
+	int Count = 0;
+	int Tick = 0;
+	long Filepos = 0;
+	bool Error = false;
+	io_seek(m_File, IndexPos, IOSEEK_START);
+	while(Count < Num && !Error)
+	{
+		int ChunkType, ChunkSize, ChunkTick = 0;
+		if(ReadChunkHeader(&ChunkType, &ChunkSize, &ChunkTick) || ChunkType != CHUNKTYPE_INDEX || ChunkSize <= 0 ||
+			io_read(m_File, m_aCompressedData, ChunkSize) != (unsigned)ChunkSize)
+		{
+			Error = true;
+			break;
+		}
+
+		int DataSize = DecompressChunk(m_aCompressedData, ChunkSize, aData, sizeof(aData), m_aDecompressedData, sizeof(m_aDecompressedData));
+		if(DataSize <= 0 || DataSize%(2*sizeof(int)))
+		{
+			Error = true;
+			break;
+		}
+
+		int NumFrames = min(DataSize/(int)(2*sizeof(int)), Num-Count);
+		for(int i = 0; i < NumFrames; i++)
+		{
+			Tick += aData[i*2];
+			Filepos += aData[i*2+1];
+			if(Filepos < StartPos || Filepos >= IndexPos || (Count && Tick <= pKeyFrames[Count-1].m_Tick))
+			{
+				Error = true;
+				break;
+			}
+			pKeyFrames[Count].m_Filepos = Filepos;
+			pKeyFrames[Count].m_Tick = Tick;
+			Count++;
+		}
+	}
+
+	io_seek(m_File, StartPos, IOSEEK_START);
+	if(Error)
+	{
+		mem_free(pKeyFrames);
+		return false;
+	}
+
+	m_pKeyFrames = pKeyFrames;
+	m_Info.m_SeekablePoints = Num;
+	m_Info.m_Info.m_FirstTick = aFooter[4];
+	m_Info.m_Info.m_LastTick = aFooter[5];
+	return true;
+}
+
 void CDemoPlayer::ScanFile()
 {
 	long StartPos;
@@ -446,7 +790,7 @@ void CDemoPlayer::ScanFile()
 	}
 
 	// copy all the frames to an array instead for fast access
-	m_pKeyFrames = (CKeyFrame*)mem_alloc(m_Info.m_SeekablePoints*sizeof(CKeyFrame), 1);
+	m_pKeyFrames = (CDemoKeyFrame*)mem_alloc(m_Info.m_SeekablePoints*sizeof(CDemoKeyFrame), 1);
 	for(pCurrentKey = pFirstKey, i = 0; pCurrentKey; pCurrentKey = pCurrentKey->m_pNext, i++)
 		m_pKeyFrames[i] = pCurrentKey->m_Frame;
 
@@ -456,9 +800,6 @@ void CDemoPlayer::ScanFile()
 
 void CDemoPlayer::DoTick()
 {
-	static char aCompresseddata[CSnapshot::MAX_SIZE];
-	static char aDecompressed[CSnapshot::MAX_SIZE];
-	static char aData[CSnapshot::MAX_SIZE];
 	int ChunkType, ChunkTick, ChunkSize;
 	int DataSize = 0;
 	int GotSnapshot = 0;
@@ -487,7 +828,7 @@ void CDemoPlayer::DoTick()
 		// read the chunk
 		if(ChunkSize)
 		{
-			if(io_read(m_File, aCompresseddata, ChunkSize) != (unsigned)ChunkSize)
+			if(io_read(m_File, m_aCompressedData, ChunkSize) != (unsigned)ChunkSize)
 			{
 				// stop on error or eof
 				m_pConsole->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "demo_player", "error reading chunk");
@@ -495,7 +836,7 @@ void CDemoPlayer::DoTick()
 				break;
 			}
 
-			DataSize = CNetBase::Decompress(aCompresseddata, ChunkSize, aDecompressed, sizeof(aDecompressed));
+			DataSize = CNetBase::Decompress(m_aCompressedData, ChunkSize, m_aDecompressedData, sizeof(m_aDecompressedData));
 			if(DataSize < 0)
 			{
 				// stop on error or eof
@@ -504,7 +845,7 @@ void CDemoPlayer::DoTick()
 				break;
 			}
 
-			DataSize = CVariableInt::Decompress(aDecompressed, DataSize, aData, sizeof(aData));
+			DataSize = CVariableInt::Decompress(m_aDecompressedData, DataSize, m_aData, sizeof(m_aData));
 
 			if(DataSize < 0)
 			{
@@ -517,19 +858,17 @@ void CDemoPlayer::DoTick()
 		if(ChunkType == CHUNKTYPE_DELTA)
 		{
 			// process delta snapshot
-			static char aNewsnap[CSnapshot::MAX_SIZE];
-
 			GotSnapshot = 1;
 
-			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot*)m_aLastSnapshotData, (CSnapshot*)aNewsnap, aData, DataSize);
+			DataSize = m_pSnapshotDelta->UnpackDelta((CSnapshot*)m_aLastSnapshotData, (CSnapshot*)m_aNewSnapshotData, m_aData, DataSize);
 
 			if(DataSize >= 0)
 			{
 				if(m_pListner)
-					m_pListner->OnDemoPlayerSnapshot(aNewsnap, DataSize);
+					m_pListner->OnDemoPlayerSnapshot(m_aNewSnapshotData, DataSize);
 
 				m_LastSnapshotDataSize = DataSize;
-				mem_copy(m_aLastSnapshotData, aNewsnap, DataSize);
+				mem_copy(m_aLastSnapshotData, m_aNewSnapshotData, DataSize);
 			}
 			else
 			{
@@ -544,9 +883,9 @@ void CDemoPlayer::DoTick()
 			GotSnapshot = 1;
 
 			m_LastSnapshotDataSize = DataSize;
-			mem_copy(m_aLastSnapshotData, aData, DataSize);
+			mem_copy(m_aLastSnapshotData, m_aData, DataSize);
 			if(m_pListner)
-				m_pListner->OnDemoPlayerSnapshot(aData, DataSize);
+				m_pListner->OnDemoPlayerSnapshot(m_aData, DataSize);
 		}
 		else
 		{
@@ -566,7 +905,7 @@ void CDemoPlayer::DoTick()
 			else if(ChunkType == CHUNKTYPE_MESSAGE)
 			{
 				if(m_pListner)
-					m_pListner->OnDemoPlayerMessage(aData, DataSize);
+					m_pListner->OnDemoPlayerMessage(m_aData, DataSize);
 			}
 		}
 	}
@@ -673,8 +1012,11 @@ const char *CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole
 
 		// save map
 		MapFile = pStorage->OpenFile(aMapFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
-		io_write(MapFile, pMapData, MapSize);
-		io_close(MapFile);
+		if(MapFile)
+		{
+			io_write(MapFile, pMapData, MapSize);
+			io_close(MapFile);
+		}
 
 		// free data
 		mem_free(pMapData);
@@ -691,8 +1033,9 @@ const char *CDemoPlayer::Load(class IStorage *pStorage, class IConsole *pConsole
 												((pTimelineMarker[2]<<8)&0xFF00) | (pTimelineMarker[3]&0xFF);
 	}
 
-	// scan the file for interessting points
-	ScanFile();
+	// take the keyframes from the index, scan the file for them if there is none
+	if(!ReadKeyFrameIndex())
+		ScanFile();
 
 	// ready for playback
 	return 0;
@@ -733,13 +1076,18 @@ int CDemoPlayer::SetPos(float Percent)
 	if(Keyframe < 0 || Keyframe >= m_Info.m_SeekablePoints)
 		return -1;
 
-	// get correct key frame
-	if(m_pKeyFrames[Keyframe].m_Tick < WantedTick)
-		while(Keyframe < m_Info.m_SeekablePoints-1 && m_pKeyFrames[Keyframe].m_Tick < WantedTick)
-			Keyframe++;
-
-	while(Keyframe && m_pKeyFrames[Keyframe].m_Tick > WantedTick)
-		Keyframe--;
+	// get the last key frame before the wanted tick
+	int Low = 0;
+	int High = m_Info.m_SeekablePoints-1;
+	while(Low < High)
+	{
+		int Mid = (Low+High+1)/2;
+		if(m_pKeyFrames[Mid].m_Tick <= WantedTick)
+			Low = Mid;
+		else
+			High = Mid-1;
+	}
+	Keyframe = Low;
 
 	// seek to the correct keyframe
 	io_seek(m_File, m_pKeyFrames[Keyframe].m_Filepos, IOSEEK_START);
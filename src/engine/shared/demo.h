@@ -8,10 +8,36 @@
 
 #include "snapshot.h"
 
+struct CDemoKeyFrame
+{
+	long m_Filepos;
+	int m_Tick;
+};
+
 class CDemoRecorder : public IDemoRecorder
 {
+	enum
+	{
+		QUEUE_SIZE=1024*1024,
+		WRITE_BUFFER_SIZE=64*1024,
+
+		QUEUEITEM_SNAPSHOT=0,
+		QUEUEITEM_MESSAGE,
+		QUEUEITEM_WRAP,
+	};
+
+	struct CQueueItem
+	{
+		int m_Type;
+		int m_Tick;
+		int m_Size;
+	};
+
 	class IConsole *m_pConsole;
 	IOHANDLE m_File;
+	long m_FilePos; // write buffer included
+	unsigned char m_aWriteBuffer[WRITE_BUFFER_SIZE];
+	int m_WriteBufferSize;
 	int m_LastTickMarker;
 	int m_LastKeyFrame;
 	int m_FirstTick;
@@ -20,12 +46,37 @@ class CDemoRecorder : public IDemoRecorder
 	int m_NumTimelineMarkers;
 	int m_aTimelineMarkers[MAX_TIMELINE_MARKERS];
 
+	// written behind the last tick on stop, so players don't have to scan the file
+	CDemoKeyFrame *m_pKeyFrames;
+	int m_NumKeyFrames;
+	int m_MaxKeyFrames;
+
+	// the recording thread does delta, compression and writing. the game thread only copies
+	// snapshots and messages into a ring buffer between exactly these two threads
+	void *m_pThread;
+	volatile bool m_ThreadShutdown;
+	SEMAPHORE m_QueueSemaphore;
+	unsigned char *m_pQueue;
+	volatile int m_QueueRead;
+	volatile int m_QueueWrite;
+	int m_NumQueueStalls;
+	class CSnapshotDelta *m_pThreadSnapshotDelta; // the one passed in belongs to the game thread
+
+	static void RecordThread(void *pUser);
+	void Queue(int Type, int Tick, const void *pData, int Size);
+	void ProcessQueue();
+
+	void DoRecordSnapshot(int Tick, const void *pData, int Size);
+	void WriteData(const void *pData, int Size);
+	void FlushWriteBuffer();
 	void WriteTickMarker(int Tick, int Keyframe);
+	void WriteKeyFrameIndex();
 	void Write(int Type, const void *pData, int Size);
 public:
 	CDemoRecorder(class CSnapshotDelta *pSnapshotDelta);
+	~CDemoRecorder();
 
-	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, unsigned MapCrc, const char *pType);
+	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetversion, const char *pMap, unsigned MapCrc, const char *pType, bool Threaded = false);
 	int Stop();
 	void AddDemoMarker();
 
@@ -71,15 +122,9 @@ private:
 
 
 	// Playback
-	struct CKeyFrame
-	{
-		long m_Filepos;
-		int m_Tick;
-	};
-
 	struct CKeyFrameSearch
 	{
-		CKeyFrame m_Frame;
+		CDemoKeyFrame m_Frame;
 		CKeyFrameSearch *m_pNext;
 	};
 
@@ -87,7 +132,7 @@ private:
 	IOHANDLE m_File;
 	char m_aFilename[256];
 	char m_aErrorMsg[256];
-	CKeyFrame *m_pKeyFrames;
+	CDemoKeyFrame *m_pKeyFrames;
 
 	CPlaybackInfo m_Info;
 	int m_DemoType;
@@ -95,10 +140,16 @@ private:
 	int m_LastSnapshotDataSize;
 	class CSnapshotDelta *m_pSnapshotDelta;
 
+	// per player, so several players can run on different threads
+	char m_aCompressedData[CSnapshot::MAX_SIZE];
+	char m_aDecompressedData[CSnapshot::MAX_SIZE];
+	char m_aData[CSnapshot::MAX_SIZE];
+	char m_aNewSnapshotData[CSnapshot::MAX_SIZE];
+
 	int ReadChunkHeader(int *pType, int *pSize, int *pTick);
 	void DoTick();
+	bool ReadKeyFrameIndex();
 	void ScanFile();
-	int NextFrame();
 
 public:
 
@@ -119,6 +170,8 @@ public:
 	int GetDemoType() const;
 
 	int Update();
+	// plays the next tick right away, the player pauses at the end of the demo
+	int NextFrame();
 
 	const CPlaybackInfo *Info() const { return &m_Info; }
 	int IsPlaying() const { return m_File != 0; }
@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <stdlib.h> // srand
 
+#include <base/math.h>
 #include <base/system.h>
 
 #include <engine/console.h>
@@ -66,7 +67,8 @@ public:
 		net_init();
 		CNetBase::Init();
 
-		m_JobPool.Init(1);
+		// at least two, so a blocking host lookup doesn't hold up everything else
+		m_JobPool.Init(max(2, thread_num_cpus()));
 
 		m_Logging = false;
 	}
@@ -93,7 +95,9 @@ public:
 	{
 		str_copy(pLookup->m_aHostname, pHostname, sizeof(pLookup->m_aHostname));
 		pLookup->m_Nettype = Nettype;
-		AddJob(&pLookup->m_Job, HostLookupThread, pLookup);
+		if(g_Config.m_Debug)
+			dbg_msg("engine", "job added");
+		m_JobPool.Add(&pLookup->m_Job, HostLookupThread, pLookup, CJobPool::PRIORITY_LOW);
 	}
 
 	void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData)
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 #include "huffman.h"
 
@@ -129,73 +130,110 @@ void CHuffman::Init(const unsigned *pFrequencies)
 			m_apDecodeLut[i] = pNode;
 	}
 
+	// build the decode table
+	BuildDecodeTable();
 }
 
-//***************************************************************
-int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
+void CHuffman::BuildDecodeTable()
 {
-	// this macro loads a symbol for a byte into bits and bitcount
-#define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
-	Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
-	Bitcount += m_aNodes[Sym].m_NumBits;
-
-	// this macro writes the symbol stored in bits and bitcount to the dst pointer
-#define HUFFMAN_MACRO_WRITE() \
-	while(Bitcount >= 8) \
-	{ \
-		*pDst++ = (unsigned char)(Bits&0xff); \
-		if(pDst == pDstEnd) \
-			return -1; \
-		Bits >>= 8; \
-		Bitcount -= 8; \
+	unsigned MaxBits = 0;
+	for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+		MaxBits = max(MaxBits, m_aNodes[i].m_NumBits);
+	m_TableMinBits = 0;
+	if(MaxBits > HUFFMAN_MAX_TABLE_CODEBITS)
+		return;
+	m_TableMinBits = max(MaxBits, (unsigned)HUFFMAN_TABLEBITS);
+
+	for(int i = 0; i < HUFFMAN_TABLESIZE; i++)
+	{
+		CTableEntry *pEntry = &m_aDecodeTable[i];
+		pEntry->m_NumSymbols = 0;
+		pEntry->m_NumBits = 0;
+		pEntry->m_Node = HUFFMAN_NO_NODE;
+
+		// take whole codes as long as they fit into the bits of the entry
+		unsigned Bits = i;
+		while(pEntry->m_NumSymbols < HUFFMAN_TABLESYMBOLS)
+		{
+			CNode *pNode = m_pStartNode;
+			unsigned Depth = 0;
+			while(!pNode->m_NumBits && pEntry->m_NumBits+Depth < HUFFMAN_TABLEBITS)
+				pNode = &m_aNodes[pNode->m_aLeafs[(Bits>>Depth++)&1]];
+
+			if(!pNode->m_NumBits)
+			{
+				// a code longer than the table, the decoder walks the tree from here
+				if(pEntry->m_NumSymbols == 0)
+				{
+					pEntry->m_NumBits = HUFFMAN_TABLEBITS;
+					pEntry->m_Node = pNode-m_aNodes;
+				}
+				break;
+			}
+
+			Bits >>= Depth;
+			pEntry->m_NumBits += Depth;
+			if(pNode == &m_aNodes[HUFFMAN_EOF_SYMBOL])
+			{
+				pEntry->m_Node = HUFFMAN_EOF_SYMBOL;
+				break;
+			}
+			pEntry->m_aSymbols[pEntry->m_NumSymbols++] = pNode->m_Symbol;
+		}
 	}
+}
 
+//***************************************************************
+int CHuffman::Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
+{
 	// setup buffer pointers
 	const unsigned char *pSrc = (const unsigned char *)pInput;
 	const unsigned char *pSrcEnd = pSrc + InputSize;
 	unsigned char *pDst = (unsigned char *)pOutput;
 	unsigned char *pDstEnd = pDst + OutputSize;
 
-	// symbol variables
-	unsigned Bits = 0;
+	// symbol variables, a code has at most 32 bits so there is always room for one more
+	unsigned long long Bits = 0;
 	unsigned Bitcount = 0;
 
-	// make sure that we have data that we want to compress
-	if(InputSize)
+	while(pSrc != pSrcEnd)
 	{
-		// {A} load the first symbol
-		int Symbol = *pSrc++;
+		const CNode *pNode = &m_aNodes[*pSrc++];
+		Bits |= (unsigned long long)pNode->m_Bits << Bitcount;
+		Bitcount += pNode->m_NumBits;
 
-		while(pSrc != pSrcEnd)
+		// write 4 bytes at once, the output has to keep a byte for the last bits
+		if(Bitcount >= 32)
 		{
-			// {B} load the symbol
-			HUFFMAN_MACRO_LOADSYMBOL(Symbol)
-
-			// {C} fetch next symbol, this is done here because it will reduce dependency in the code
-			Symbol = *pSrc++;
-
-			// {B} write the symbol loaded at
-			HUFFMAN_MACRO_WRITE()
+			if(pDstEnd - pDst <= 4)
+				return -1;
+			pDst[0] = (unsigned char)Bits;
+			pDst[1] = (unsigned char)(Bits>>8);
+			pDst[2] = (unsigned char)(Bits>>16);
+			pDst[3] = (unsigned char)(Bits>>24);
+			pDst += 4;
+			Bits >>= 32;
+			Bitcount -= 32;
 		}
-
-		// write the last symbol loaded from {C} or {A} in the case of only 1 byte input buffer
-		HUFFMAN_MACRO_LOADSYMBOL(Symbol)
-		HUFFMAN_MACRO_WRITE()
 	}
 
-	// write EOF symbol
-	HUFFMAN_MACRO_LOADSYMBOL(HUFFMAN_EOF_SYMBOL)
-	HUFFMAN_MACRO_WRITE()
+	// add the EOF symbol and write the remaining whole bytes
+	Bits |= (unsigned long long)m_aNodes[HUFFMAN_EOF_SYMBOL].m_Bits << Bitcount;
+	Bitcount += m_aNodes[HUFFMAN_EOF_SYMBOL].m_NumBits;
+	while(Bitcount >= 8)
+	{
+		*pDst++ = (unsigned char)Bits;
+		if(pDst == pDstEnd)
+			return -1;
+		Bits >>= 8;
+		Bitcount -= 8;
+	}
 
 	// write out the last bits
-	*pDst++ = Bits;
+	*pDst++ = (unsigned char)Bits;
 
 	// return the size of the output
 	return (int)(pDst - (const unsigned char *)pOutput);
-
-	// remove macros
-#undef HUFFMAN_MACRO_LOADSYMBOL
-#undef HUFFMAN_MACRO_WRITE
 }
 
 //***************************************************************
@@ -207,12 +245,76 @@ int CHuffman::Decompress(const void *pInput, int InputSize, void *pOutput, int O
 	unsigned char *pDstEnd = pDst + OutputSize;
 	unsigned char *pSrcEnd = pSrc + InputSize;
 
-	unsigned Bits = 0;
+	unsigned long long Bits = 0;
 	unsigned Bitcount = 0;
 
 	CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
 	CNode *pNode = 0;
 
+	// use the table as long as the longest code fits into the bits that are left, the
+	// end of the input goes through the loop below so broken input fails the same way
+	if(m_TableMinBits)
+	{
+		while(1)
+		{
+			// fill with new bits
+			while(Bitcount <= 56 && pSrc != pSrcEnd)
+			{
+				Bits |= (unsigned long long)(*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
+
+			if(Bitcount < m_TableMinBits)
+				break;
+
+			do
+			{
+				const CTableEntry *pEntry = &m_aDecodeTable[Bits&HUFFMAN_TABLEMASK];
+
+				// output the characters, all of the entry if there is room as that is faster
+				if(pDstEnd - pDst >= HUFFMAN_TABLESYMBOLS)
+				{
+					for(int i = 0; i < HUFFMAN_TABLESYMBOLS; i++)
+						pDst[i] = pEntry->m_aSymbols[i];
+				}
+				else if(pDstEnd - pDst >= pEntry->m_NumSymbols)
+				{
+					for(int i = 0; i < pEntry->m_NumSymbols; i++)
+						pDst[i] = pEntry->m_aSymbols[i];
+				}
+				else
+					return -1;
+				pDst += pEntry->m_NumSymbols;
+
+				// remove the bits for them
+				Bits >>= pEntry->m_NumBits;
+				Bitcount -= pEntry->m_NumBits;
+
+				if(pEntry->m_Node != HUFFMAN_NO_NODE)
+				{
+					// walk the tree bit by bit for a long code, the eof is a leaf already
+					pNode = &m_aNodes[pEntry->m_Node];
+					while(!pNode->m_NumBits)
+					{
+						pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+						Bits >>= 1;
+						Bitcount--;
+					}
+
+					// check for eof
+					if(pNode == pEof)
+						return (int)(pDst - (const unsigned char *)pOutput);
+
+					// output character
+					if(pDst == pDstEnd)
+						return -1;
+					*pDst++ = pNode->m_Symbol;
+				}
+			}
+			while(Bitcount >= m_TableMinBits);
+		}
+	}
+
 	while(1)
 	{
 		// {A} try to load a node now, this will reduce dependency at location {D}
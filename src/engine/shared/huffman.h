@@ -16,7 +16,17 @@ class CHuffman
 
 		HUFFMAN_LUTBITS = 10,
 		HUFFMAN_LUTSIZE = (1<<HUFFMAN_LUTBITS),
-		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1)
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1),
+
+		// the table decodes this many bits at once, up to HUFFMAN_TABLESYMBOLS symbols
+		HUFFMAN_TABLEBITS = 12,
+		HUFFMAN_TABLESIZE = (1<<HUFFMAN_TABLEBITS),
+		HUFFMAN_TABLEMASK = (HUFFMAN_TABLESIZE-1),
+		HUFFMAN_TABLESYMBOLS = 4,
+
+		// the tree walk only has 24 bits at hand, the table is not used for longer codes
+		HUFFMAN_MAX_TABLE_CODEBITS = 24,
+		HUFFMAN_NO_NODE = 0xffff,
 	};
 
 	struct CNode
@@ -32,13 +42,27 @@ class CHuffman
 		unsigned char m_Symbol;
 	};
 
+	struct CTableEntry
+	{
+		unsigned char m_aSymbols[HUFFMAN_TABLESYMBOLS];
+		unsigned char m_NumSymbols;
+		unsigned char m_NumBits; // the bits of the symbols and of the eof
+		// HUFFMAN_EOF_SYMBOL if the eof follows the symbols, the node to walk on from
+		// for codes longer than the table or HUFFMAN_NO_NODE
+		unsigned short m_Node;
+	};
+
 	CNode m_aNodes[HUFFMAN_MAX_NODES];
 	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
 	CNode *m_pStartNode;
 	int m_NumNodes;
 
+	CTableEntry m_aDecodeTable[HUFFMAN_TABLESIZE];
+	unsigned m_TableMinBits; // the decode table is safe as long as this many bits are left, 0 if it's not used
+
 	void Setbits_r(CNode *pNode, int Bits, unsigned Depth);
 	void ConstructTree(const unsigned *pFrequencies);
+	void BuildDecodeTable();
 
 public:
 	/*
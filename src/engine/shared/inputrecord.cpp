@@ -0,0 +1,381 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/storage.h>
+
+#include "compression.h"
+#include "inputrecord.h"
+
+static const unsigned char gs_aHeaderMarker[8] = {'T', 'W', 'I', 'N', 'P', 'U', 'T', 0};
+static const int gs_ActVersion = 1;
+
+CInputRecorder::CInputRecorder()
+{
+	m_pConsole = 0;
+	m_File = 0;
+	m_BufferSize = 0;
+}
+
+void CInputRecorder::Flush()
+{
+	io_write(m_File, m_aBuffer, m_BufferSize);
+	m_BufferSize = 0;
+}
+
+void CInputRecorder::AddInt(int i)
+{
+	if(m_BufferSize+5 > (int)sizeof(m_aBuffer))
+		Flush();
+	m_BufferSize = CVariableInt::Pack(m_aBuffer+m_BufferSize, i) - m_aBuffer;
+}
+
+void CInputRecorder::AddRaw(const void *pData, int Size)
+{
+	if(m_BufferSize+Size > (int)sizeof(m_aBuffer))
+		Flush();
+	if(Size > (int)sizeof(m_aBuffer))
+	{
+		io_write(m_File, pData, Size);
+		return;
+	}
+	mem_copy(m_aBuffer+m_BufferSize, pData, Size);
+	m_BufferSize += Size;
+}
+
+void CInputRecorder::AddString(const char *pStr)
+{
+	AddRaw(pStr, str_length(pStr)+1);
+}
+
+int CInputRecorder::Start(IStorage *pStorage, IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, unsigned MapCrc, int Seed)
+{
+	if(m_File)
+		return -1;
+
+	m_pConsole = pConsole;
+	m_File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!m_File)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "Unable to open '%s' for recording", pFilename);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input_recorder", aBuf);
+		return -1;
+	}
+
+	m_BufferSize = 0;
+	mem_zero(m_aaLastInput, sizeof(m_aaLastInput));
+
+	AddRaw(gs_aHeaderMarker, sizeof(gs_aHeaderMarker));
+	AddInt(gs_ActVersion);
+	AddInt(MapCrc);
+	AddInt(Seed);
+	AddString(pMap);
+	AddString(pNetVersion);
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "Recording to '%s'", pFilename);
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input_recorder", aBuf);
+	return 0;
+}
+
+int CInputRecorder::Stop()
+{
+	if(!m_File)
+		return -1;
+
+	Flush();
+	io_close(m_File);
+	m_File = 0;
+	m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input_recorder", "Stopped recording");
+	return 0;
+}
+
+void CInputRecorder::RecordTick(int Tick)
+{
+	if(!m_File)
+		return;
+
+	// write out once a second, a killed server still leaves a usable recording
+	if(Tick%SERVER_TICK_SPEED == 0)
+	{
+		Flush();
+		io_flush(m_File);
+	}
+
+	AddInt(EVENT_TICK);
+	AddInt(Tick);
+}
+
+void CInputRecorder::RecordConnect(int ClientID)
+{
+	if(!m_File)
+		return;
+
+	AddInt(EVENT_CONNECT);
+	AddInt(ClientID);
+	mem_zero(m_aaLastInput[ClientID], sizeof(m_aaLastInput[ClientID]));
+}
+
+void CInputRecorder::RecordEnter(int ClientID)
+{
+	if(!m_File)
+		return;
+
+	AddInt(EVENT_ENTER);
+	AddInt(ClientID);
+}
+
+void CInputRecorder::RecordDrop(int ClientID, const char *pReason)
+{
+	if(!m_File)
+		return;
+
+	AddInt(EVENT_DROP);
+	AddInt(ClientID);
+	AddString(pReason);
+}
+
+void CInputRecorder::RecordInput(int Type, int ClientID, const int *pData)
+{
+	if(!m_File)
+		return;
+
+	// only up to the last value that changed
+	int *pLast = m_aaLastInput[ClientID];
+	int Size = MAX_INPUT_SIZE;
+	while(Size > 0 && pData[Size-1] == pLast[Size-1])
+		Size--;
+
+	AddInt(Type);
+	AddInt(ClientID);
+	AddInt(Size);
+	for(int i = 0; i < Size; i++)
+	{
+		AddInt(pData[i]-pLast[i]);
+		pLast[i] = pData[i];
+	}
+}
+
+void CInputRecorder::RecordMessage(int ClientID, const void *pData, int Size)
+{
+	if(!m_File)
+		return;
+
+	AddInt(EVENT_MESSAGE);
+	AddInt(ClientID);
+	AddInt(Size);
+	AddRaw(pData, Size);
+}
+
+void CInputRecorder::RecordLatency(int ClientID, int Latency)
+{
+	if(!m_File)
+		return;
+
+	AddInt(EVENT_LATENCY);
+	AddInt(ClientID);
+	AddInt(Latency);
+}
+
+void CInputRecorder::RecordSnapshot()
+{
+	if(!m_File)
+		return;
+
+	AddInt(EVENT_SNAPSHOT);
+}
+
+void CInputRecorder::RecordSnapshotCrc(int ClientID, unsigned Crc)
+{
+	if(!m_File)
+		return;
+
+	AddInt(EVENT_SNAPSHOT_CRC);
+	AddInt(ClientID);
+	AddInt(Crc);
+}
+
+
+CInputPlayer::CInputPlayer()
+{
+	m_pConsole = 0;
+	m_pData = 0;
+	m_Size = 0;
+	m_Pos = 0;
+	m_Error = false;
+	mem_zero(&m_Header, sizeof(m_Header));
+}
+
+CInputPlayer::~CInputPlayer()
+{
+	Unload();
+}
+
+int CInputPlayer::GetInt()
+{
+	if(m_Pos >= m_Size)
+	{
+		m_Error = true;
+		return 0;
+	}
+
+	// the buffer is padded, a truncated int can't read past it
+	int i;
+	m_Pos = CVariableInt::Unpack(m_pData+m_Pos, &i) - m_pData;
+	if(m_Pos > m_Size)
+		m_Error = true;
+	return i;
+}
+
+const char *CInputPlayer::GetString()
+{
+	const char *pStr = (const char *)m_pData+m_Pos;
+	while(m_Pos < m_Size && m_pData[m_Pos])
+		m_Pos++;
+	if(m_Pos >= m_Size)
+	{
+		m_Error = true;
+		return "";
+	}
+	m_Pos++;
+	return pStr;
+}
+
+const void *CInputPlayer::GetRaw(int Size)
+{
+	if(Size < 0 || Size > m_Size-m_Pos)
+	{
+		m_Error = true;
+		return 0;
+	}
+	const void *pData = m_pData+m_Pos;
+	m_Pos += Size;
+	return pData;
+}
+
+int CInputPlayer::Load(IStorage *pStorage, IConsole *pConsole, const char *pFilename)
+{
+	Unload();
+	m_pConsole = pConsole;
+
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!File)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "could not open '%s'", pFilename);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input_player", aBuf);
+		return -1;
+	}
+
+	m_Size = (int)io_length(File);
+	m_pData = (unsigned char *)mem_alloc(m_Size+8, 1);
+	mem_zero(m_pData+m_Size, 8);
+	int Read = io_read(File, m_pData, m_Size);
+	io_close(File);
+
+	if(Read != m_Size || m_Size < (int)sizeof(gs_aHeaderMarker) || mem_comp(m_pData, gs_aHeaderMarker, sizeof(gs_aHeaderMarker)) != 0)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "'%s' is not an input recording", pFilename);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input_player", aBuf);
+		Unload();
+		return -1;
+	}
+
+	m_Pos = sizeof(gs_aHeaderMarker);
+	m_Header.m_Version = GetInt();
+	m_Header.m_MapCrc = GetInt();
+	m_Header.m_Seed = GetInt();
+	str_copy(m_Header.m_aMap, GetString(), sizeof(m_Header.m_aMap));
+	str_copy(m_Header.m_aNetVersion, GetString(), sizeof(m_Header.m_aNetVersion));
+
+	if(m_Error || m_Header.m_Version != gs_ActVersion)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "'%s' has an unsupported version %d", pFilename, m_Header.m_Version);
+		m_pConsole->Print(IConsole::OUTPUT_LEVEL_STANDARD, "input_player", aBuf);
+		Unload();
+		return -1;
+	}
+
+	mem_zero(m_aaLastInput, sizeof(m_aaLastInput));
+	return 0;
+}
+
+void CInputPlayer::Unload()
+{
+	if(m_pData)
+		mem_free(m_pData);
+	m_pData = 0;
+	m_Size = 0;
+	m_Pos = 0;
+	m_Error = false;
+}
+
+bool CInputPlayer::NextEvent(CEvent *pEvent)
+{
+	if(m_Error || m_Pos >= m_Size)
+		return false;
+
+	mem_zero(pEvent, sizeof(*pEvent));
+	pEvent->m_Type = GetInt();
+	pEvent->m_ClientID = -1;
+
+	switch(pEvent->m_Type)
+	{
+	case CInputRecorder::EVENT_TICK:
+		pEvent->m_Value = GetInt();
+		break;
+	case CInputRecorder::EVENT_SNAPSHOT:
+		break;
+	default:
+		pEvent->m_ClientID = GetInt();
+		if(pEvent->m_ClientID < 0 || pEvent->m_ClientID >= MAX_CLIENTS)
+			m_Error = true;
+	}
+	if(m_Error)
+		return false;
+
+	switch(pEvent->m_Type)
+	{
+	case CInputRecorder::EVENT_TICK:
+	case CInputRecorder::EVENT_SNAPSHOT:
+	case CInputRecorder::EVENT_ENTER:
+		break;
+	case CInputRecorder::EVENT_CONNECT:
+		mem_zero(m_aaLastInput[pEvent->m_ClientID], sizeof(m_aaLastInput[pEvent->m_ClientID]));
+		break;
+	case CInputRecorder::EVENT_DROP:
+		pEvent->m_pString = GetString();
+		break;
+	case CInputRecorder::EVENT_DIRECT_INPUT:
+	case CInputRecorder::EVENT_PREDICTED_INPUT:
+		{
+			int *pInput = m_aaLastInput[pEvent->m_ClientID];
+			int Size = GetInt();
+			if(Size < 0 || Size > MAX_INPUT_SIZE)
+			{
+				m_Error = true;
+				break;
+			}
+			for(int i = 0; i < Size; i++)
+				pInput[i] += GetInt();
+			pEvent->m_pInput = pInput;
+		}
+		break;
+	case CInputRecorder::EVENT_MESSAGE:
+		pEvent->m_DataSize = GetInt();
+		pEvent->m_pData = GetRaw(pEvent->m_DataSize);
+		break;
+	case CInputRecorder::EVENT_LATENCY:
+	case CInputRecorder::EVENT_SNAPSHOT_CRC:
+		pEvent->m_Value = GetInt();
+		break;
+	default:
+		m_Error = true;
+	}
+
+	return !m_Error;
+}
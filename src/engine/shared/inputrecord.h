@@ -0,0 +1,109 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_INPUTRECORD_H
+#define ENGINE_SHARED_INPUTRECORD_H
+
+#include <base/system.h>
+
+#include "protocol.h"
+
+// everything the clients fed into the game server, tick by tick, so a session can be replayed.
+// all numbers are variable ints, inputs are stored as difference to the last input of the client
+class CInputRecorder
+{
+public:
+	enum
+	{
+		EVENT_TICK=0,
+		EVENT_CONNECT,
+		EVENT_ENTER,
+		EVENT_DROP,
+		EVENT_DIRECT_INPUT,
+		EVENT_PREDICTED_INPUT,
+		EVENT_MESSAGE,
+		EVENT_LATENCY,
+		EVENT_SNAPSHOT,
+		EVENT_SNAPSHOT_CRC,
+	};
+
+private:
+	class IConsole *m_pConsole;
+	IOHANDLE m_File;
+	unsigned char m_aBuffer[16*1024];
+	int m_BufferSize;
+	int m_aaLastInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+
+	void AddInt(int i);
+	void AddString(const char *pStr);
+	void AddRaw(const void *pData, int Size);
+	void Flush();
+
+public:
+	CInputRecorder();
+
+	int Start(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename, const char *pNetVersion, const char *pMap, unsigned MapCrc, int Seed);
+	int Stop();
+	bool IsRecording() const { return m_File != 0; }
+
+	void RecordTick(int Tick);
+	void RecordConnect(int ClientID);
+	void RecordEnter(int ClientID);
+	void RecordDrop(int ClientID, const char *pReason);
+	void RecordInput(int Type, int ClientID, const int *pData);
+	// the whole chunk as received, message id included
+	void RecordMessage(int ClientID, const void *pData, int Size);
+	void RecordLatency(int ClientID, int Latency);
+	void RecordSnapshot();
+	void RecordSnapshotCrc(int ClientID, unsigned Crc);
+};
+
+class CInputPlayer
+{
+public:
+	struct CHeader
+	{
+		int m_Version;
+		unsigned m_MapCrc;
+		int m_Seed;
+		char m_aMap[64];
+		char m_aNetVersion[64];
+	};
+
+	struct CEvent
+	{
+		int m_Type;
+		int m_ClientID;
+		int m_Value; // tick, latency or snapshot crc
+		const char *m_pString; // drop reason
+		const void *m_pData; // message
+		int m_DataSize;
+		int *m_pInput; // full input after the difference got applied
+	};
+
+private:
+	class IConsole *m_pConsole;
+	unsigned char *m_pData;
+	int m_Size;
+	int m_Pos;
+	bool m_Error;
+	CHeader m_Header;
+	int m_aaLastInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+
+	int GetInt();
+	const char *GetString();
+	const void *GetRaw(int Size);
+
+public:
+	CInputPlayer();
+	~CInputPlayer();
+
+	int Load(class IStorage *pStorage, class IConsole *pConsole, const char *pFilename);
+	void Unload();
+	const CHeader *Header() const { return &m_Header; }
+
+	// returns false at the end of the recording or if it is broken, see Error()
+	bool NextEvent(CEvent *pEvent);
+	bool Error() const { return m_Error; }
+};
+
+#endif
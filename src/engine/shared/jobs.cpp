@@ -1,61 +1,67 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
+#include <base/tl/threading.h>
 #include "jobs.h"
 
+struct CJobWaiter
+{
+	SEMAPHORE m_Semaphore;
+	CJobWaiter *m_pNext;
+};
+
 CJobPool::CJobPool()
 {
 	// empty the pool
 	m_NumThreads = 0;
 	m_Shutdown = false;
-	m_Lock = lock_create();
-	m_pFirstJob = 0;
-	m_pLastJob = 0;
+	m_NextQueue = 0;
+	semaphore_init(&m_Semaphore);
+	m_DependencyLock = lock_create();
+	for(int i = 0; i < MAX_THREADS; i++)
+	{
+		m_aQueues[i].m_Lock = lock_create();
+		for(int p = 0; p < NUM_PRIORITIES; p++)
+		{
+			m_aQueues[i].m_apFirst[p] = 0;
+			m_aQueues[i].m_apLast[p] = 0;
+		}
+	}
 }
 
 CJobPool::~CJobPool()
 {
 	m_Shutdown = true;
+	for(int i = 0; i < m_NumThreads; i++)
+		semaphore_signal(&m_Semaphore);
 	for(int i = 0; i < m_NumThreads; i++)
 	{
 		thread_wait(m_apThreads[i]);
 		thread_destroy(m_apThreads[i]);
 	}
-	lock_destroy(m_Lock);
+	for(int i = 0; i < MAX_THREADS; i++)
+		lock_destroy(m_aQueues[i].m_Lock);
+	lock_destroy(m_DependencyLock);
+	semaphore_destroy(&m_Semaphore);
 }
 
 void CJobPool::WorkerThread(void *pUser)
 {
-	CJobPool *pPool = (CJobPool *)pUser;
+	CWorker *pWorker = (CWorker *)pUser;
+	CJobPool *pPool = pWorker->m_pPool;
 
-	while(!pPool->m_Shutdown)
+	while(1)
 	{
-		CJob *pJob = 0;
-
-		// fetch job from queue
-		lock_wait(pPool->m_Lock);
-		if(pPool->m_pFirstJob)
-		{
-			pJob = pPool->m_pFirstJob;
-			pPool->m_pFirstJob = pPool->m_pFirstJob->m_pNext;
-			if(pPool->m_pFirstJob)
-				pPool->m_pFirstJob->m_pPrev = 0;
-			else
-				pPool->m_pLastJob = 0;
-		}
-		lock_unlock(pPool->m_Lock);
+		// every queued job signals once, the job might have been taken by someone else meanwhile
+		semaphore_wait(&pPool->m_Semaphore);
+		if(pPool->m_Shutdown)
+			break;
 
-		// do the job if we have one
+		CJob *pJob = pPool->Fetch(pWorker->m_Index, NUM_PRIORITIES-1);
 		if(pJob)
-		{
-			pJob->m_Status = CJob::STATE_RUNNING;
-			pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
-			pJob->m_Status = CJob::STATE_DONE;
-		}
-		else
-			thread_sleep(10);
+			pPool->Run(pJob, pWorker->m_Index);
 	}
-
 }
 
 int CJobPool::Init(int NumThreads)
@@ -63,27 +69,291 @@ int CJobPool::Init(int NumThreads)
 	// start threads
 	m_NumThreads = NumThreads > MAX_THREADS ? MAX_THREADS : NumThreads;
 	for(int i = 0; i < m_NumThreads; i++)
-		m_apThreads[i] = thread_init(WorkerThread, this);
+	{
+		m_aWorkers[i].m_pPool = this;
+		m_aWorkers[i].m_Index = i;
+		m_apThreads[i] = thread_init(WorkerThread, &m_aWorkers[i]);
+	}
 	return 0;
 }
 
-int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData)
+void CJobPool::Prepare(CJob *pJob, JOBFUNC pfnFunc, void *pData, int Priority, CJob *pParent)
 {
 	mem_zero(pJob, sizeof(CJob));
+	pJob->m_Status = CJob::STATE_PENDING;
 	pJob->m_pfnFunc = pfnFunc;
 	pJob->m_pFuncData = pData;
+	pJob->m_Priority = clamp(Priority, (int)PRIORITY_HIGH, (int)PRIORITY_LOW);
+	pJob->m_Queue = -1;
+	pJob->m_Worker = -1;
+	pJob->m_NumUnfinished = 1;
+	pJob->m_pParent = pParent;
+	if(pParent)
+		atomic_inc(&pParent->m_NumUnfinished);
+}
+
+void CJobPool::Queue(CJob *pJob)
+{
+	// without threads the caller does the work
+	if(!m_NumThreads)
+	{
+		Run(pJob, -1);
+		return;
+	}
+
+	// children stay with the worker of their parent, everything else is spread
+	int Index;
+	if(pJob->m_pParent && pJob->m_pParent->m_Worker >= 0)
+		Index = pJob->m_pParent->m_Worker;
+	else
+		Index = atomic_inc(&m_NextQueue)%m_NumThreads;
+
+	CQueue *pQueue = &m_aQueues[Index];
+	int Priority = pJob->m_Priority;
+	lock_wait(pQueue->m_Lock);
+	pJob->m_Queue = Index;
+	pJob->m_pNext = 0;
+	pJob->m_pPrev = pQueue->m_apLast[Priority];
+	if(pQueue->m_apLast[Priority])
+		pQueue->m_apLast[Priority]->m_pNext = pJob;
+	else
+		pQueue->m_apFirst[Priority] = pJob;
+	pQueue->m_apLast[Priority] = pJob;
+	lock_unlock(pQueue->m_Lock);
+
+	semaphore_signal(&m_Semaphore);
+}
+
+CJob *CJobPool::Fetch(int Worker, int MaxPriority)
+{
+	for(int p = 0; p <= MaxPriority; p++)
+	{
+		// the newest job of the own queue
+		if(Worker >= 0 && m_aQueues[Worker].m_apFirst[p])
+		{
+			CQueue *pQueue = &m_aQueues[Worker];
+			CJob *pJob = 0;
+			lock_wait(pQueue->m_Lock);
+			if(pQueue->m_apLast[p])
+			{
+				pJob = pQueue->m_apLast[p];
+				pJob->m_Queue = -1;
+				pQueue->m_apLast[p] = pJob->m_pPrev;
+				if(pJob->m_pPrev)
+					pJob->m_pPrev->m_pNext = 0;
+				else
+					pQueue->m_apFirst[p] = 0;
+			}
+			lock_unlock(pQueue->m_Lock);
+			if(pJob)
+				return pJob;
+		}
+
+		// steal the oldest job of another queue
+		int Start = Worker >= 0 ? Worker+1 : 0;
+		for(int i = 0; i < m_NumThreads; i++)
+		{
+			int Index = (Start+i)%m_NumThreads;
+			if(Index == Worker || !m_aQueues[Index].m_apFirst[p])
+				continue;
+
+			CQueue *pQueue = &m_aQueues[Index];
+			CJob *pJob = 0;
+			lock_wait(pQueue->m_Lock);
+			if(pQueue->m_apFirst[p])
+			{
+				pJob = pQueue->m_apFirst[p];
+				pJob->m_Queue = -1;
+				pQueue->m_apFirst[p] = pJob->m_pNext;
+				if(pJob->m_pNext)
+					pJob->m_pNext->m_pPrev = 0;
+				else
+					pQueue->m_apLast[p] = 0;
+			}
+			lock_unlock(pQueue->m_Lock);
+			if(pJob)
+				return pJob;
+		}
+	}
+	return 0;
+}
+
+bool CJobPool::Take(CJob *pJob)
+{
+	int Index = pJob->m_Queue;
+	if(Index < 0)
+		return false;
+
+	CQueue *pQueue = &m_aQueues[Index];
+	int Priority = pJob->m_Priority;
+	bool Taken = false;
+	lock_wait(pQueue->m_Lock);
+	if(pJob->m_Queue == Index)
+	{
+		if(pJob->m_pPrev)
+			pJob->m_pPrev->m_pNext = pJob->m_pNext;
+		else
+			pQueue->m_apFirst[Priority] = pJob->m_pNext;
+		if(pJob->m_pNext)
+			pJob->m_pNext->m_pPrev = pJob->m_pPrev;
+		else
+			pQueue->m_apLast[Priority] = pJob->m_pPrev;
+		pJob->m_Queue = -1;
+		Taken = true;
+	}
+	lock_unlock(pQueue->m_Lock);
+	return Taken;
+}
+
+void CJobPool::Run(CJob *pJob, int Worker)
+{
+	pJob->m_Worker = Worker;
+	pJob->m_Status = CJob::STATE_RUNNING;
+	pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
+	Finish(pJob);
+}
 
-	lock_wait(m_Lock);
+void CJobPool::Finish(CJob *pJob)
+{
+	if(atomic_dec(&pJob->m_NumUnfinished) != 0)
+		return;
+
+	// the job may be gone as soon as it is marked done
+	CJob *pParent = pJob->m_pParent;
+	lock_wait(m_DependencyLock);
+	CJob *pDependent = pJob->m_pFirstDependent;
+	pJob->m_pFirstDependent = 0;
+	CJobWaiter *pWaiter = pJob->m_pFirstWaiter;
+	pJob->m_pFirstWaiter = 0;
+	sync_barrier();
+	pJob->m_Status = CJob::STATE_DONE;
+	lock_unlock(m_DependencyLock);
+
+	// the waiter is gone as soon as it got its signal
+	while(pWaiter)
+	{
+		CJobWaiter *pNext = pWaiter->m_pNext;
+		semaphore_signal(&pWaiter->m_Semaphore);
+		pWaiter = pNext;
+	}
+
+	while(pDependent)
+	{
+		CJob *pNext = pDependent->m_pNextDependent;
+		Queue(pDependent);
+		pDependent = pNext;
+	}
+
+	if(pParent)
+		Finish(pParent);
+}
+
+int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData, int Priority, CJob *pParent)
+{
+	Prepare(pJob, pfnFunc, pData, Priority, pParent);
+	Queue(pJob);
+	return 0;
+}
+
+int CJobPool::AddAfter(CJob *pDependency, CJob *pJob, JOBFUNC pfnFunc, void *pData, int Priority, CJob *pParent)
+{
+	Prepare(pJob, pfnFunc, pData, Priority, pParent);
+
+	lock_wait(m_DependencyLock);
+	if(pDependency->m_Status != CJob::STATE_DONE)
+	{
+		pJob->m_pNextDependent = pDependency->m_pFirstDependent;
+		pDependency->m_pFirstDependent = pJob;
+		lock_unlock(m_DependencyLock);
+		return 0;
+	}
+	lock_unlock(m_DependencyLock);
+
+	Queue(pJob);
+	return 0;
+}
+
+void CJobPool::WaitFor(CJob *pJob)
+{
+	// nothing to do for jobs that are done or were never added
+	if(pJob->m_Status == CJob::STATE_DONE)
+	{
+		sync_barrier();
+		return;
+	}
+
+	// rather run the job here than wait for a worker
+	if(Take(pJob))
+		Run(pJob, -1);
+
+	// help with short jobs for a bit, blocking ones are left to the workers
+	int MaxPriority = min(pJob->m_Priority, (int)PRIORITY_NORMAL);
+	for(int Spins = 0; pJob->m_Status != CJob::STATE_DONE && Spins < WAIT_SPINS; )
+	{
+		CJob *pOther = Fetch(-1, MaxPriority);
+		if(pOther)
+			Run(pOther, -1);
+		else
+		{
+			thread_yield();
+			Spins++;
+		}
+	}
 
-	// add job to queue
-	pJob->m_pPrev = m_pLastJob;
-	if(m_pLastJob)
-		m_pLastJob->m_pNext = pJob;
-	m_pLastJob = pJob;
-	if(!m_pFirstJob)
-		m_pFirstJob = pJob;
+	// then sleep until Finish signals
+	if(pJob->m_Status != CJob::STATE_DONE)
+	{
+		CJobWaiter Waiter;
+		semaphore_init(&Waiter.m_Semaphore);
+		lock_wait(m_DependencyLock);
+		bool Done = pJob->m_Status == CJob::STATE_DONE;
+		if(!Done)
+		{
+			Waiter.m_pNext = pJob->m_pFirstWaiter;
+			pJob->m_pFirstWaiter = &Waiter;
+		}
+		lock_unlock(m_DependencyLock);
+		if(!Done)
+			semaphore_wait(&Waiter.m_Semaphore);
+		semaphore_destroy(&Waiter.m_Semaphore);
+	}
+	sync_barrier();
+}
 
-	lock_unlock(m_Lock);
+int CJobPool::BatchJob(void *pData)
+{
+	CBatch *pBatch = (CBatch *)pData;
+	pBatch->m_pfnFunc(pBatch->m_pUser, pBatch->m_Start, pBatch->m_End);
 	return 0;
 }
 
+void CJobPool::ParallelFor(int Num, int MinBatch, PARALLELFUNC pfnFunc, void *pUser)
+{
+	if(Num <= 0)
+		return;
+
+	// a few batches per thread so the stealing evens out uneven batches
+	int NumBatches = clamp(Num/max(MinBatch, 1), 1, min((int)MAX_BATCHES, (m_NumThreads+1)*4));
+	if(NumBatches == 1)
+	{
+		pfnFunc(pUser, 0, Num);
+		return;
+	}
+
+	CJob aJobs[MAX_BATCHES];
+	CBatch aBatches[MAX_BATCHES];
+	for(int i = 0; i < NumBatches; i++)
+	{
+		aBatches[i].m_pfnFunc = pfnFunc;
+		aBatches[i].m_pUser = pUser;
+		aBatches[i].m_Start = (int)((int64)Num*i/NumBatches);
+		aBatches[i].m_End = (int)((int64)Num*(i+1)/NumBatches);
+	}
+
+	// the first batch runs right here
+	for(int i = 1; i < NumBatches; i++)
+		Add(&aJobs[i], BatchJob, &aBatches[i], PRIORITY_HIGH);
+	BatchJob(&aBatches[0]);
+	for(int i = 1; i < NumBatches; i++)
+		WaitFor(&aJobs[i]);
+}
@@ -2,9 +2,13 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef ENGINE_SHARED_JOBS_H
 #define ENGINE_SHARED_JOBS_H
+#include <base/system.h>
+
 typedef int (*JOBFUNC)(void *pData);
+typedef void (*PARALLELFUNC)(void *pUser, int Start, int End);
 
 class CJobPool;
+struct CJobWaiter;
 
 class CJob
 {
@@ -18,11 +22,26 @@ class CJob
 
 	JOBFUNC m_pfnFunc;
 	void *m_pFuncData;
+	int m_Priority;
+	int m_Queue; // the queue the job waits in, -1 when it is in none
+	int m_Worker; // the worker that ran the function, -1 for other threads
+
+	// the job itself and its children, done when it drops to 0
+	volatile unsigned m_NumUnfinished;
+	CJob *m_pParent;
+
+	// jobs queued once this one is done
+	CJob *m_pFirstDependent;
+	CJob *m_pNextDependent;
+
+	// threads sleeping in WaitFor
+	CJobWaiter *m_pFirstWaiter;
 public:
 	CJob()
 	{
 		m_Status = STATE_DONE;
 		m_pFuncData = 0;
+		m_Queue = -1;
 	}
 
 	enum
@@ -36,27 +55,85 @@ public:
 	int Result() const {return m_Result; }
 };
 
+// every worker has its own deque per priority. a worker takes the newest job from its own,
+// then steals the oldest from the others. idle workers sleep on a semaphore that gets a
+// signal for every queued job
 class CJobPool
 {
+public:
+	enum
+	{
+		PRIORITY_HIGH=0, // short jobs somebody waits for, like the batches of ParallelFor
+		PRIORITY_NORMAL,
+		PRIORITY_LOW, // jobs that block, like host lookups
+		NUM_PRIORITIES,
+	};
+
+private:
 	enum
 	{
-		MAX_THREADS=32
+		MAX_THREADS=32,
+		MAX_BATCHES=64,
+		WAIT_SPINS=64, // yields without anything to help with before WaitFor sleeps
+	};
+
+	struct CQueue
+	{
+		LOCK m_Lock;
+		CJob *volatile m_apFirst[NUM_PRIORITIES];
+		CJob *m_apLast[NUM_PRIORITIES];
 	};
+
+	struct CWorker
+	{
+		CJobPool *m_pPool;
+		int m_Index;
+	};
+
+	struct CBatch
+	{
+		PARALLELFUNC m_pfnFunc;
+		void *m_pUser;
+		int m_Start;
+		int m_End;
+	};
+
 	int m_NumThreads;
 	void *m_apThreads[MAX_THREADS];
+	CWorker m_aWorkers[MAX_THREADS];
+	CQueue m_aQueues[MAX_THREADS];
 	volatile bool m_Shutdown;
-
-	LOCK m_Lock;
-	CJob *m_pFirstJob;
-	CJob *m_pLastJob;
+	volatile unsigned m_NextQueue;
+	SEMAPHORE m_Semaphore;
+	LOCK m_DependencyLock;
 
 	static void WorkerThread(void *pUser);
+	static int BatchJob(void *pData);
+
+	void Prepare(CJob *pJob, JOBFUNC pfnFunc, void *pData, int Priority, CJob *pParent);
+	void Queue(CJob *pJob);
+	// Worker is the queue to pop from first, -1 to only steal
+	CJob *Fetch(int Worker, int MaxPriority);
+	// removes the job from its queue if nobody took it yet
+	bool Take(CJob *pJob);
+	void Run(CJob *pJob, int Worker);
+	void Finish(CJob *pJob);
 
 public:
 	CJobPool();
 	~CJobPool();
 
 	int Init(int NumThreads);
-	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData);
+	int NumThreads() const { return m_NumThreads; }
+
+	// pParent is not done before pJob is, add children from the function of the parent
+	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData, int Priority = PRIORITY_NORMAL, CJob *pParent = 0);
+	// pJob gets queued once pDependency is done
+	int AddAfter(CJob *pDependency, CJob *pJob, JOBFUNC pfnFunc, void *pData, int Priority = PRIORITY_NORMAL, CJob *pParent = 0);
+
+	// runs the job itself or other short jobs while waiting, then sleeps until the job is done
+	void WaitFor(CJob *pJob);
+	// calls pfnFunc for batches of at least MinBatch of [0, Num) on the workers and the calling thread
+	void ParallelFor(int Num, int MinBatch, PARALLELFUNC pfnFunc, void *pUser);
 };
 #endif
@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
+#include <engine/engine.h>
 #include <engine/map.h>
 #include <engine/storage.h>
 #include <game/mapitems.h>
@@ -42,6 +44,19 @@ public:
 		int GroupsStart, GroupsNum, LayersStart, LayersNum;
 		m_DataFile.GetType(MAPITEMTYPE_GROUP, &GroupsStart, &GroupsNum);
 		m_DataFile.GetType(MAPITEMTYPE_LAYER, &LayersStart, &LayersNum);
+
+		// inflate the tile data of all layers at once
+		int *pTileData = (int *)mem_alloc(max(LayersNum, 1)*sizeof(int), 1);
+		int NumTileData = 0;
+		for(int l = 0; l < LayersNum; l++)
+		{
+			CMapItemLayer *pLayer = static_cast<CMapItemLayer *>(m_DataFile.GetItem(LayersStart + l, 0, 0));
+			if(pLayer->m_Type == LAYERTYPE_TILES && reinterpret_cast<CMapItemLayerTilemap *>(pLayer)->m_Version > 3)
+				pTileData[NumTileData++] = reinterpret_cast<CMapItemLayerTilemap *>(pLayer)->m_Data;
+		}
+		IEngine *pEngine = Kernel() ? Kernel()->RequestInterface<IEngine>() : 0;
+		m_DataFile.LoadData(pTileData, NumTileData, pEngine ? pEngine->JobPool() : 0);
+		mem_free(pTileData);
 		for(int g = 0; g < GroupsNum; g++)
 		{
 			CMapItemGroup *pGroup = static_cast<CMapItemGroup *>(m_DataFile.GetItem(GroupsStart + g, 0, 0));
@@ -90,6 +105,21 @@ public:
 	{
 		return m_DataFile.Crc();
 	}
+
+	virtual const unsigned char *FileData()
+	{
+		return m_DataFile.FileData();
+	}
+
+	virtual unsigned FileSize()
+	{
+		return m_DataFile.FileSize();
+	}
+
+	virtual void Swap(IEngineMap *pOther)
+	{
+		m_DataFile.Swap(&static_cast<CMap *>(pOther)->m_DataFile);
+	}
 };
 
 extern IEngineMap *CreateEngineMap() { return new CMap; }
@@ -306,7 +306,9 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	if(pBan)
 	{
 		// adjust the ban
+		lock_wait(m_BanLock);
 		pBanPool->Update(pBan, &Info);
+		lock_unlock(m_BanLock);
 		char aBuf[128];
 		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_LIST);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
@@ -314,7 +316,9 @@ int CNetBan::Ban(T *pBanPool, const typename T::CDataType *pData, int Seconds, c
 	}
 
 	// add ban and print result
+	lock_wait(m_BanLock);
 	pBan = pBanPool->Add(pData, &Info, &NetHash);
+	lock_unlock(m_BanLock);
 	if(pBan)
 	{
 		char aBuf[128];
@@ -336,7 +340,9 @@ int CNetBan::Unban(T *pBanPool, const typename T::CDataType *pData)
 	{
 		char aBuf[256];
 		MakeBanInfo(pBan, aBuf, sizeof(aBuf), MSGTYPE_BANREM);
+		lock_wait(m_BanLock);
 		pBanPool->Remove(pBan);
+		lock_unlock(m_BanLock);
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
 		return 0;
 	}
@@ -345,6 +351,16 @@ int CNetBan::Unban(T *pBanPool, const typename T::CDataType *pData)
 	return -1;
 }
 
+CNetBan::CNetBan()
+{
+	m_BanLock = lock_create();
+}
+
+CNetBan::~CNetBan()
+{
+	lock_destroy(m_BanLock);
+}
+
 void CNetBan::Init(IConsole *pConsole, IStorage *pStorage)
 {
 	m_pConsole = pConsole;
@@ -374,13 +390,17 @@ void CNetBan::Update()
 	{
 		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanAddrPool.First()->m_Data, aNetStr, sizeof(aNetStr)));
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		lock_wait(m_BanLock);
 		m_BanAddrPool.Remove(m_BanAddrPool.First());
+		lock_unlock(m_BanLock);
 	}
 	while(m_BanRangePool.First() && m_BanRangePool.First()->m_Info.m_Expires != CBanInfo::EXPIRES_NEVER && m_BanRangePool.First()->m_Info.m_Expires < Now)
 	{
 		str_format(aBuf, sizeof(aBuf), "ban %s expired", NetToString(&m_BanRangePool.First()->m_Data, aNetStr, sizeof(aNetStr)));
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "net_ban", aBuf);
+		lock_wait(m_BanLock);
 		m_BanRangePool.Remove(m_BanRangePool.First());
+		lock_unlock(m_BanLock);
 	}
 }
 
@@ -420,7 +440,9 @@ int CNetBan::UnbanByIndex(int Index)
 	if(pBan)
 	{
 		NetToString(&pBan->m_Data, aBuf, sizeof(aBuf));
+		lock_wait(m_BanLock);
 		Result = m_BanAddrPool.Remove(pBan);
+		lock_unlock(m_BanLock);
 	}
 	else
 	{
@@ -428,7 +450,9 @@ int CNetBan::UnbanByIndex(int Index)
 		if(pBan)
 		{
 			NetToString(&pBan->m_Data, aBuf, sizeof(aBuf));
+			lock_wait(m_BanLock);
 			Result = m_BanRangePool.Remove(pBan);
+			lock_unlock(m_BanLock);
 		}
 		else
 		{
@@ -445,8 +469,10 @@ int CNetBan::UnbanByIndex(int Index)
 
 void CNetBan::UnbanAll()
 {
+	lock_wait(m_BanLock);
 	m_BanAddrPool.Reset();
 	m_BanRangePool.Reset();
+	lock_unlock(m_BanLock);
 }
 
 bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize) const
@@ -454,11 +480,14 @@ bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize) co
 	CNetHash aHash[17];
 	int Length = CNetHash::MakeHashArray(pAddr, aHash);
 
+	lock_wait(m_BanLock);
+
 	// check ban adresses
 	CBanAddr *pBan = m_BanAddrPool.Find(pAddr, &aHash[Length]);
 	if(pBan)
 	{
 		MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER);
+		lock_unlock(m_BanLock);
 		return true;
 	}
 
@@ -470,11 +499,13 @@ bool CNetBan::IsBanned(const NETADDR *pAddr, char *pBuf, unsigned BufferSize) co
 			if(NetMatch(&pBan->m_Data, pAddr, i, Length))
 			{
 				MakeBanInfo(pBan, pBuf, BufferSize, MSGTYPE_PLAYER);
+				lock_unlock(m_BanLock);
 				return true;
 			}
 		}
 	}
-	
+
+	lock_unlock(m_BanLock);
 	return false;
 }
 
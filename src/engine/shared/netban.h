@@ -156,6 +156,7 @@ protected:
 	CBanAddrPool m_BanAddrPool;
 	CBanRangePool m_BanRangePool;
 	NETADDR m_LocalhostIPV4, m_LocalhostIPV6;
+	LOCK m_BanLock; // the server checks bans on its network thread, changes hold this
 
 public:
 	enum
@@ -169,7 +170,8 @@ public:
 	class IConsole *Console() const { return m_pConsole; }
 	class IStorage *Storage() const { return m_pStorage; }
 
-	virtual ~CNetBan() {}
+	CNetBan();
+	virtual ~CNetBan();
 	void Init(class IConsole *pConsole, class IStorage *pStorage);
 	void Update();
 
@@ -1,5 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 
 
@@ -87,8 +88,87 @@ int CNetRecvUnpacker::FetchChunk(CNetChunk *pChunk)
 	}
 }
 
+void CNetSendBatch::Init(NETSOCKET Socket)
+{
+	m_Socket = Socket;
+	m_pQueue = 0;
+	m_NumPackets = 0;
+	for(int i = 0; i < NET_BATCH_MAX_PACKETS; i++)
+		m_aPackets[i].data = m_aaBuffers[i];
+}
+
+void CNetSendBatch::Add(const NETADDR *pAddr, const void *pData, int DataSize)
+{
+	if(m_NumPackets == NET_BATCH_MAX_PACKETS)
+		Flush();
+
+	NETPACKET *pPacket = &m_aPackets[m_NumPackets++];
+	pPacket->addr = *pAddr;
+	pPacket->size = DataSize;
+	mem_copy(pPacket->data, pData, DataSize);
+}
+
+int CNetSendBatch::Flush()
+{
+	if(!m_NumPackets)
+		return 0;
+
+	int NumPackets = m_NumPackets;
+	if(m_pQueue)
+	{
+		// sending directly when the queue is full would overtake the queued packets, wait for the network thread
+		for(int i = 0; i < m_NumPackets; )
+		{
+			CNetQueuedPacket *pEntry = m_pQueue->Allocate();
+			if(!pEntry)
+			{
+				thread_yield();
+				continue;
+			}
+			pEntry->m_Addr = m_aPackets[i].addr;
+			pEntry->m_DataSize = m_aPackets[i].size;
+			mem_copy(pEntry->m_aData, m_aPackets[i].data, m_aPackets[i].size);
+			m_pQueue->Commit();
+			i++;
+		}
+	}
+	else
+		net_udp_send_batch(m_Socket, m_aPackets, m_NumPackets);
+	m_NumPackets = 0;
+	return NumPackets;
+}
+
+void CNetRecvBatch::Init(NETSOCKET Socket)
+{
+	m_Socket = Socket;
+	m_NumPackets = 0;
+	m_CurrentPacket = 0;
+	for(int i = 0; i < NET_BATCH_MAX_PACKETS; i++)
+		m_aPackets[i].data = m_aaBuffers[i];
+}
+
+int CNetRecvBatch::Fetch(NETADDR *pAddr, unsigned char **ppData)
+{
+	// read the next batch from the socket once the current one is used up
+	if(m_CurrentPacket >= m_NumPackets)
+	{
+		m_CurrentPacket = 0;
+		m_NumPackets = net_udp_recv_batch(m_Socket, m_aPackets, NET_BATCH_MAX_PACKETS, NET_MAX_PACKETSIZE);
+		if(m_NumPackets <= 0)
+		{
+			m_NumPackets = 0;
+			return 0;
+		}
+	}
+
+	NETPACKET *pPacket = &m_aPackets[m_CurrentPacket++];
+	*pAddr = pPacket->addr;
+	*ppData = (unsigned char *)pPacket->data;
+	return pPacket->size;
+}
+
 // packs the data tight and sends it
-void CNetBase::SendPacketConnless(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize)
+void CNetBase::SendPacketConnless(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize, CNetSendBatch *pSendBatch)
 {
 	unsigned char aBuffer[NET_MAX_PACKETSIZE];
 
@@ -110,10 +190,14 @@ void CNetBase::SendPacketConnless(NETSOCKET Socket, const NETADDR *pAddr, TOKEN
 	dbg_assert(i == NET_PACKETHEADERSIZE_CONNLESS, "inconsistency");
 
 	mem_copy(&aBuffer[i], pData, DataSize);
-	net_udp_send(Socket, pAddr, aBuffer, i+DataSize);
+	if(pSendBatch)
+		pSendBatch->Add(pAddr, aBuffer, i+DataSize);
+	else
+		net_udp_send(Socket, pAddr, aBuffer, i+DataSize);
 }
 
-void CNetBase::SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketConstruct *pPacket)
+// returns the number of bytes sent on the wire or -1 on failure
+int CNetBase::SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketConstruct *pPacket, CNetSendBatch *pSendBatch)
 {
 	unsigned char aBuffer[NET_MAX_PACKETSIZE];
 	int CompressedSize = -1;
@@ -165,7 +249,10 @@ void CNetBase::SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketCons
 
 		dbg_assert(i == NET_PACKETHEADERSIZE, "inconsistency");
 
-		net_udp_send(Socket, pAddr, aBuffer, FinalSize);
+		if(pSendBatch)
+			pSendBatch->Add(pAddr, aBuffer, FinalSize);
+		else
+			net_udp_send(Socket, pAddr, aBuffer, FinalSize);
 
 		// log raw socket data
 		if(ms_DataLogSent)
@@ -177,6 +264,8 @@ void CNetBase::SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketCons
 			io_flush(ms_DataLogSent);
 		}
 	}
+
+	return FinalSize;
 }
 
 // TODO: rename this function
@@ -291,7 +380,7 @@ int CNetBase::UnpackPacket(unsigned char *pBuffer, int Size, CNetPacketConstruct
 }
 
 
-void CNetBase::SendControlMsg(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, const void *pExtra, int ExtraSize)
+void CNetBase::SendControlMsg(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, const void *pExtra, int ExtraSize, CNetSendBatch *pSendBatch)
 {
 	CNetPacketConstruct Construct;
 	Construct.m_Token = Token;
@@ -302,12 +391,12 @@ void CNetBase::SendControlMsg(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Toke
 	Construct.m_aChunkData[0] = ControlMsg;
 	mem_copy(&Construct.m_aChunkData[1], pExtra, ExtraSize);
 
-	// send the control message
-	CNetBase::SendPacket(Socket, pAddr, &Construct);
+	// send the control message, with a batch it stays behind the data sent before
+	CNetBase::SendPacket(Socket, pAddr, &Construct, pSendBatch);
 }
 
 
-void CNetBase::SendControlMsgWithToken(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, TOKEN MyToken, bool Extended)
+void CNetBase::SendControlMsgWithToken(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, TOKEN MyToken, bool Extended, CNetSendBatch *pSendBatch)
 {
 	dbg_assert((Token&~NET_TOKEN_MASK) == 0, "token out of range");
 	dbg_assert((MyToken&~NET_TOKEN_MASK) == 0, "resp token out of range");
@@ -317,7 +406,7 @@ void CNetBase::SendControlMsgWithToken(NETSOCKET Socket, const NETADDR *pAddr, T
 	aBuf[1] = (MyToken>>16)&0xff;
 	aBuf[2] = (MyToken>>8)&0xff;
 	aBuf[3] = (MyToken)&0xff;
-	SendControlMsg(Socket, pAddr, Token, 0, ControlMsg, aBuf, Extended ? sizeof(aBuf) : 4);
+	SendControlMsg(Socket, pAddr, Token, 0, ControlMsg, aBuf, Extended ? sizeof(aBuf) : 4, pSendBatch);
 }
 
 unsigned char *CNetChunkHeader::Pack(unsigned char *pData)
@@ -369,6 +458,7 @@ int CNetBase::IsSeqInBackroom(int Seq, int Ack)
 IOHANDLE CNetBase::ms_DataLogSent = 0;
 IOHANDLE CNetBase::ms_DataLogRecv = 0;
 CHuffman CNetBase::ms_Huffman;
+bool CNetBase::ms_SecureRandom = false;
 
 
 void CNetBase::OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv)
@@ -436,4 +526,15 @@ static const unsigned gs_aFreqTable[256+1] = {
 void CNetBase::Init()
 {
 	ms_Huffman.Init(gs_aFreqTable);
+	ms_SecureRandom = secure_random_init() == 0;
+}
+
+unsigned CNetBase::RandomBits()
+{
+	unsigned Bits;
+	if(ms_SecureRandom)
+		secure_random_fill(&Bits, sizeof(Bits));
+	else
+		Bits = random_int();
+	return Bits;
 }
@@ -108,6 +108,8 @@ enum
 	//
 	NET_MAX_CLIENTS = 64,
 	NET_MAX_CONSOLE_CLIENTS = 4,
+
+	NET_QUEUE_SIZE = 256,
 	
 	NET_MAX_SEQUENCE = 1<<10,
 	NET_SEQUENCE_MASK = NET_MAX_SEQUENCE-1,
@@ -187,6 +189,95 @@ public:
 };
 
 
+// lock-free ring buffer between exactly one producer and one consumer thread
+template<class T, int SIZE>
+class CNetQueue
+{
+	T m_aItems[SIZE];
+	volatile int m_ReadIndex;
+	volatile int m_WriteIndex;
+
+public:
+	CNetQueue() { m_ReadIndex = 0; m_WriteIndex = 0; }
+
+	// producer side, the item only becomes visible after Commit()
+	T *Allocate()
+	{
+		if((m_WriteIndex+1)%SIZE == m_ReadIndex)
+			return 0;
+		return &m_aItems[m_WriteIndex];
+	}
+	void Commit()
+	{
+		sync_barrier();
+		m_WriteIndex = (m_WriteIndex+1)%SIZE;
+	}
+
+	// consumer side
+	T *Front(int Offset = 0)
+	{
+		if(Offset >= (m_WriteIndex-m_ReadIndex+SIZE)%SIZE)
+			return 0;
+		sync_barrier();
+		return &m_aItems[(m_ReadIndex+Offset)%SIZE];
+	}
+	void Pop(int Num = 1)
+	{
+		sync_barrier();
+		m_ReadIndex = (m_ReadIndex+Num)%SIZE;
+	}
+	bool Empty() const { return m_ReadIndex == m_WriteIndex; }
+};
+
+struct CNetQueuedPacket
+{
+	NETADDR m_Addr;
+	int m_DataSize;
+	unsigned char m_aData[NET_MAX_PACKETSIZE];
+};
+
+struct CNetQueuedConstruct
+{
+	NETADDR m_Addr;
+	CNetPacketConstruct m_Data;
+};
+
+typedef CNetQueue<CNetQueuedPacket, NET_QUEUE_SIZE> CNetSendQueue;
+typedef CNetQueue<CNetQueuedConstruct, NET_QUEUE_SIZE> CNetRecvQueue;
+
+// collects outgoing packets so they can be handed to the socket in one go
+class CNetSendBatch
+{
+	NETSOCKET m_Socket;
+	CNetSendQueue *m_pQueue;
+	int m_NumPackets;
+	NETPACKET m_aPackets[NET_BATCH_MAX_PACKETS];
+	unsigned char m_aaBuffers[NET_BATCH_MAX_PACKETS][NET_MAX_PACKETSIZE];
+
+public:
+	void Init(NETSOCKET Socket);
+	// hand the packets to a network thread instead of sending them directly
+	void SetQueue(CNetSendQueue *pQueue) { m_pQueue = pQueue; }
+	void Add(const NETADDR *pAddr, const void *pData, int DataSize);
+	int Flush();
+	int NumPackets() const { return m_NumPackets; }
+};
+
+// reads as many packets as available from the socket at once
+class CNetRecvBatch
+{
+	NETSOCKET m_Socket;
+	int m_NumPackets;
+	int m_CurrentPacket;
+	NETPACKET m_aPackets[NET_BATCH_MAX_PACKETS];
+	unsigned char m_aaBuffers[NET_BATCH_MAX_PACKETS][NET_MAX_PACKETSIZE];
+
+public:
+	void Init(NETSOCKET Socket);
+	int Fetch(NETADDR *pAddr, unsigned char **ppData);
+};
+
+
 class CNetTokenManager
 {
 public:
@@ -273,6 +364,17 @@ private:
 };
 
 
+// per connection traffic counters, reset whenever a new connection is made
+struct CNetConnectionStats
+{
+	int64 m_SentPackets;
+	int64 m_SentBytes; // as sent on the wire, after compression
+	int64 m_SentUncompressedBytes;
+	int64 m_RecvPackets;
+	int64 m_RecvBytes; // after decompression
+	int64 m_ResentChunks;
+};
+
 class CNetConnection
 {
 	// TODO: is this needed because this needs to be aware of
@@ -303,7 +405,8 @@ private:
 	NETADDR m_PeerAddr;
 
 	NETSOCKET m_Socket;
-	NETSTATS m_Stats;
+	CNetSendBatch *m_pSendBatch;
+	CNetConnectionStats m_Stats;
 
 	//
 	void Reset();
@@ -320,7 +423,7 @@ private:
 	static TOKEN GenerateToken(const NETADDR *pPeerAddr);
 
 public:
-	void Init(NETSOCKET Socket, bool BlockCloseMsg);
+	void Init(NETSOCKET Socket, bool BlockCloseMsg, CNetSendBatch *pSendBatch = 0);
 	int Connect(NETADDR *pAddr);
 	void Disconnect(const char *pReason);
 
@@ -350,6 +453,7 @@ public:
 	int64 ConnectTime() const { return m_LastUpdateTime; }
 
 	int AckSequence() const { return m_Ack; }
+	const CNetConnectionStats *Stats() const { return &m_Stats; }
 };
 
 class CConsoleNetConnection
@@ -420,11 +524,45 @@ class CNetServer
 	void *m_UserPtr;
 
 	CNetRecvUnpacker m_RecvUnpacker;
+	CNetRecvBatch m_RecvBatch;
+	CNetSendBatch m_SendBatch;
 
 	CNetTokenManager m_TokenManager;
 	CNetTokenCache m_TokenCache;
 
 	int m_Flags;
+
+	// network thread
+	void *m_pThread;
+	volatile bool m_ThreadShutdown;
+	CNetRecvQueue m_RecvQueue;
+	CNetSendQueue m_SendQueue;
+	SEMAPHORE m_RecvSemaphore; // signaled when the thread queued packets
+
+	// browser info requests get answered right after decoding, on the network thread when it runs
+	enum
+	{
+		INFO_REQUEST_SLOTS=256,
+	};
+	struct CInfoRequestSource
+	{
+		NETADDR m_Addr;
+		int64 m_WindowStart;
+		int m_NumRequests;
+	};
+	LOCK m_InfoLock; // guards the info and the token seed against the network thread
+	unsigned char m_aInfo[NET_MAX_PAYLOAD];
+	int m_InfoSize;
+	int m_InfoRateLimit;
+	CInfoRequestSource m_aInfoRequestSources[INFO_REQUEST_SLOTS];
+
+	static void NetThread(void *pUser);
+	void ThreadRecv();
+	void ThreadSend();
+	bool FetchPacket(NETADDR *pAddr);
+	bool ProcessEarly(const NETADDR *pAddr, CNetPacketConstruct *pPacket, CNetSendBatch *pSendBatch);
+	bool InfoRequestLimited(const NETADDR *pAddr);
+
 public:
 	int SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT pfnDelClient, void *pUser);
 
@@ -436,13 +574,26 @@ public:
 	int Recv(CNetChunk *pChunk, TOKEN *pResponseToken = 0);
 	int Send(CNetChunk *pChunk, TOKEN Token = NET_TOKEN_NONE);
 	int Update();
+	int FlushSendBatch() { return m_SendBatch.Flush(); }
+	void Wait(int Time);
+
+	// moves socket I/O and packet decoding to a separate thread
+	void StartThread();
+	void StopThread();
+	bool Threaded() const { return m_pThread != 0; }
 	void AddToken(const NETADDR *pAddr, TOKEN Token) { m_TokenCache.AddToken(pAddr, Token, 0); };
 
+	// the server info for browser requests, packed without the request token. size 0 leaves them unanswered
+	void SetServerInfo(const void *pData, int Size);
+	// requests per second from one address, 0 is unlimited
+	void SetInfoRateLimit(int Limit);
+
 	//
 	int Drop(int ClientID, const char *pReason);
 
 	// status requests
 	const NETADDR *ClientAddr(int ClientID) const { return m_aSlots[ClientID].m_Connection.PeerAddress(); }
+	const CNetConnectionStats *ClientStats(int ClientID) const { return m_aSlots[ClientID].m_Connection.Stats(); }
 	NETSOCKET Socket() const { return m_Socket; }
 	class CNetBan *NetBan() const { return m_pNetBan; }
 	int NetType() const { return m_Socket.type; }
@@ -528,6 +679,7 @@ public:
 	int State() const;
 	bool GotProblems() const;
 	const char *ErrorString() const;
+	const CNetConnectionStats *Stats() const { return m_Connection.Stats(); }
 };
 
 
@@ -538,17 +690,20 @@ class CNetBase
 	static IOHANDLE ms_DataLogSent;
 	static IOHANDLE ms_DataLogRecv;
 	static CHuffman ms_Huffman;
+	static bool ms_SecureRandom;
 public:
 	static void OpenLog(IOHANDLE DataLogSent, IOHANDLE DataLogRecv);
 	static void CloseLog();
 	static void Init();
+	// tokens and seeds come from here so they don't consume the game's rand() sequence
+	static unsigned RandomBits();
 	static int Compress(const void *pData, int DataSize, void *pOutput, int OutputSize);
 	static int Decompress(const void *pData, int DataSize, void *pOutput, int OutputSize);
 
-	static void SendControlMsg(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, const void *pExtra, int ExtraSize);
-	static void SendControlMsgWithToken(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, TOKEN MyToken, bool Extended);
-	static void SendPacketConnless(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize);
-	static void SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketConstruct *pPacket);
+	static void SendControlMsg(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, const void *pExtra, int ExtraSize, CNetSendBatch *pSendBatch = 0);
+	static void SendControlMsgWithToken(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, int Ack, int ControlMsg, TOKEN MyToken, bool Extended, CNetSendBatch *pSendBatch = 0);
+	static void SendPacketConnless(NETSOCKET Socket, const NETADDR *pAddr, TOKEN Token, TOKEN ResponseToken, const void *pData, int DataSize, CNetSendBatch *pSendBatch = 0);
+	static int SendPacket(NETSOCKET Socket, const NETADDR *pAddr, CNetPacketConstruct *pPacket, CNetSendBatch *pSendBatch = 0);
 	static int UnpackPacket(unsigned char *pBuffer, int Size, CNetPacketConstruct *pPacket);
 
 	// The backroom is ack-NET_MAX_SEQUENCE/2. Used for knowing if we acked a packet or not
@@ -41,7 +41,7 @@ void CNetConnection::SetToken(TOKEN Token)
 
 TOKEN CNetConnection::GenerateToken(const NETADDR *pPeerAddr)
 {
-	return random_int() & NET_TOKEN_MASK;
+	return CNetBase::RandomBits() & NET_TOKEN_MASK;
 }
 
 const char *CNetConnection::ErrorString()
@@ -54,12 +54,13 @@ void CNetConnection::SetError(const char *pString)
 	str_copy(m_ErrorString, pString, sizeof(m_ErrorString));
 }
 
-void CNetConnection::Init(NETSOCKET Socket, bool BlockCloseMsg)
+void CNetConnection::Init(NETSOCKET Socket, bool BlockCloseMsg, CNetSendBatch *pSendBatch)
 {
 	Reset();
 	ResetStats();
 
 	m_Socket = Socket;
+	m_pSendBatch = pSendBatch;
 	m_BlockCloseMsg = BlockCloseMsg;
 	mem_zero(m_ErrorString, sizeof(m_ErrorString));
 }
@@ -93,7 +94,13 @@ int CNetConnection::Flush()
 	// send of the packets
 	m_Construct.m_Ack = m_Ack;
 	m_Construct.m_Token = m_PeerToken;
-	CNetBase::SendPacket(m_Socket, &m_PeerAddr, &m_Construct);
+	int Size = CNetBase::SendPacket(m_Socket, &m_PeerAddr, &m_Construct, m_pSendBatch);
+	if(Size > 0)
+	{
+		m_Stats.m_SentPackets++;
+		m_Stats.m_SentBytes += Size;
+		m_Stats.m_SentUncompressedBytes += NET_PACKETHEADERSIZE+m_Construct.m_DataSize;
+	}
 
 	// update send times
 	m_LastSendTime = time_get();
@@ -163,7 +170,10 @@ void CNetConnection::SendControl(int ControlMsg, const void *pExtra, int ExtraSi
 {
 	// send the control message
 	m_LastSendTime = time_get();
-	CNetBase::SendControlMsg(m_Socket, &m_PeerAddr, m_PeerToken, m_Ack, ControlMsg, pExtra, ExtraSize);
+	CNetBase::SendControlMsg(m_Socket, &m_PeerAddr, m_PeerToken, m_Ack, ControlMsg, pExtra, ExtraSize, m_pSendBatch);
+	m_Stats.m_SentPackets++;
+	m_Stats.m_SentBytes += NET_PACKETHEADERSIZE+1+ExtraSize;
+	m_Stats.m_SentUncompressedBytes += NET_PACKETHEADERSIZE+1+ExtraSize;
 }
 
 void CNetConnection::SendPacketConnless(const char *pData, int DataSize)
@@ -174,13 +184,14 @@ void CNetConnection::SendPacketConnless(const char *pData, int DataSize)
 void CNetConnection::SendControlWithToken(int ControlMsg)
 {
 	m_LastSendTime = time_get();
-	CNetBase::SendControlMsgWithToken(m_Socket, &m_PeerAddr, m_PeerToken, 0, ControlMsg, m_Token, true);
+	CNetBase::SendControlMsgWithToken(m_Socket, &m_PeerAddr, m_PeerToken, 0, ControlMsg, m_Token, true, m_pSendBatch);
 }
 
 void CNetConnection::ResendChunk(CNetChunkResend *pResend)
 {
 	QueueChunkEx(pResend->m_Flags|NET_CHUNKFLAG_RESEND, pResend->m_DataSize, pResend->m_pData, pResend->m_Sequence);
 	pResend->m_LastSendTime = time_get();
+	m_Stats.m_ResentChunks++;
 }
 
 void CNetConnection::Resend()
@@ -196,6 +207,7 @@ int CNetConnection::Connect(NETADDR *pAddr)
 
 	// init connection
 	Reset();
+	ResetStats();
 	m_PeerAddr = *pAddr;
 	m_PeerToken = NET_TOKEN_NONE;
 	SetToken(GenerateToken(pAddr));
@@ -315,6 +327,7 @@ int CNetConnection::Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr)
 						// send response and init connection
 						TOKEN Token = m_Token;
 						Reset();
+						ResetStats();
 						mem_zero(m_ErrorString, sizeof(m_ErrorString));
 						m_State = NET_CONNSTATE_PENDING;
 						m_PeerAddr = *pAddr;
@@ -358,6 +371,8 @@ int CNetConnection::Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr)
 	{
 		m_LastRecvTime = Now;
 		AckChunks(pPacket->m_Ack);
+		m_Stats.m_RecvPackets++;
+		m_Stats.m_RecvBytes += NET_PACKETHEADERSIZE+pPacket->m_DataSize;
 	}
 
 	return 1;
@@ -1,11 +1,15 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
 
 #include <engine/console.h>
 
+#include <mastersrv/mastersrv.h>
+
 #include "netban.h"
 #include "network.h"
+#include "packer.h"
 
 
 bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int MaxClientsPerIP, int Flags)
@@ -18,9 +22,15 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 	if(!m_Socket.type)
 		return false;
 
+	m_InfoLock = lock_create();
+	semaphore_init(&m_RecvSemaphore);
+
 	m_TokenManager.Init(m_Socket);
 	m_TokenCache.Init(m_Socket, &m_TokenManager);
 
+	m_RecvBatch.Init(m_Socket);
+	m_SendBatch.Init(m_Socket);
+
 	m_pNetBan = pNetBan;
 
 	// clamp clients
@@ -33,7 +43,7 @@ bool CNetServer::Open(NETADDR BindAddr, CNetBan *pNetBan, int MaxClients, int Ma
 	m_MaxClientsPerIP = MaxClientsPerIP;
 
 	for(int i = 0; i < NET_MAX_CLIENTS; i++)
-		m_aSlots[i].m_Connection.Init(m_Socket, true);
+		m_aSlots[i].m_Connection.Init(m_Socket, true, &m_SendBatch);
 
 	m_Flags = Flags;
 
@@ -50,10 +60,221 @@ int CNetServer::SetCallbacks(NETFUNC_NEWCLIENT pfnNewClient, NETFUNC_DELCLIENT p
 
 int CNetServer::Close()
 {
+	// the close messages of the dropped clients are still in the batch
+	m_SendBatch.Flush();
+	StopThread();
+	semaphore_destroy(&m_RecvSemaphore);
+	lock_destroy(m_InfoLock);
 	// TODO: implement me
 	return 0;
 }
 
+void CNetServer::StartThread()
+{
+	if(m_pThread)
+		return;
+
+	m_ThreadShutdown = false;
+	m_SendBatch.SetQueue(&m_SendQueue);
+	m_pThread = thread_init(NetThread, this);
+}
+
+void CNetServer::StopThread()
+{
+	if(!m_pThread)
+		return;
+
+	m_SendBatch.Flush();
+	m_ThreadShutdown = true;
+	thread_wait(m_pThread);
+	m_pThread = 0;
+	m_SendBatch.SetQueue(0);
+}
+
+void CNetServer::NetThread(void *pUser)
+{
+	CNetServer *pThis = (CNetServer *)pUser;
+
+	while(!pThis->m_ThreadShutdown)
+	{
+		pThis->ThreadSend();
+		net_socket_read_wait(pThis->m_Socket, 1);
+		pThis->ThreadRecv();
+	}
+	pThis->ThreadSend();
+}
+
+void CNetServer::ThreadRecv()
+{
+	// stop reading when the game thread falls behind, the socket buffer takes the rest
+	bool Queued = false;
+	CNetQueuedConstruct *pEntry;
+	while((pEntry = m_RecvQueue.Allocate()))
+	{
+		NETADDR Addr;
+		unsigned char *pData;
+		int Bytes = m_RecvBatch.Fetch(&Addr, &pData);
+		if(Bytes <= 0)
+			break;
+
+		if(CNetBase::UnpackPacket(pData, Bytes, &pEntry->m_Data) == 0 && !ProcessEarly(&Addr, &pEntry->m_Data, 0))
+		{
+			pEntry->m_Addr = Addr;
+			m_RecvQueue.Commit();
+			Queued = true;
+		}
+	}
+
+	if(Queued)
+		semaphore_signal(&m_RecvSemaphore);
+}
+
+void CNetServer::ThreadSend()
+{
+	while(!m_SendQueue.Empty())
+	{
+		NETPACKET aPackets[NET_BATCH_MAX_PACKETS];
+		int NumPackets = 0;
+		CNetQueuedPacket *pEntry;
+		while(NumPackets < NET_BATCH_MAX_PACKETS && (pEntry = m_SendQueue.Front(NumPackets)))
+		{
+			aPackets[NumPackets].addr = pEntry->m_Addr;
+			aPackets[NumPackets].data = pEntry->m_aData;
+			aPackets[NumPackets].size = pEntry->m_DataSize;
+			NumPackets++;
+		}
+
+		net_udp_send_batch(m_Socket, aPackets, NumPackets);
+		m_SendQueue.Pop(NumPackets);
+	}
+}
+
+void CNetServer::Wait(int Time)
+{
+	if(!m_pThread)
+	{
+		net_socket_read_wait(m_Socket, Time);
+		return;
+	}
+
+	// signals left over from packets that were fetched without waiting only cause another look
+	int64 WaitUntil = time_get() + time_freq()*Time/1000;
+	while(m_RecvQueue.Empty())
+	{
+		int64 Left = WaitUntil - time_get();
+		if(Left <= 0 || !semaphore_wait_timeout(&m_RecvSemaphore, (int)(Left*1000/time_freq())))
+			break;
+	}
+}
+
+// handles what needs no game state right after decoding: bans and browser info requests.
+// returns true when nothing is left to do with the packet
+bool CNetServer::ProcessEarly(const NETADDR *pAddr, CNetPacketConstruct *pPacket, CNetSendBatch *pSendBatch)
+{
+	// check for bans
+	char aBuf[128];
+	if(NetBan() && NetBan()->IsBanned(pAddr, aBuf, sizeof(aBuf)))
+	{
+		// banned, reply with a message
+		CNetBase::SendControlMsg(m_Socket, pAddr, pPacket->m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf)+1, pSendBatch);
+		return true;
+	}
+
+	if(!(pPacket->m_Flags&NET_PACKETFLAG_CONNLESS) || pPacket->m_DataSize < (int)sizeof(SERVERBROWSE_GETINFO) ||
+		mem_comp(pPacket->m_aChunkData, SERVERBROWSE_GETINFO, sizeof(SERVERBROWSE_GETINFO)) != 0)
+		return false;
+
+	CUnpacker Unpacker;
+	Unpacker.Reset(pPacket->m_aChunkData+sizeof(SERVERBROWSE_GETINFO), pPacket->m_DataSize-sizeof(SERVERBROWSE_GETINFO));
+	int BrowserToken = Unpacker.GetInt();
+	if(Unpacker.Error())
+		return true;
+
+	lock_wait(m_InfoLock);
+	if(m_InfoSize && m_TokenManager.ProcessMessage(pAddr, pPacket) > 0 && !InfoRequestLimited(pAddr))
+	{
+		CPacker Packer;
+		Packer.Reset();
+		Packer.AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
+		Packer.AddInt(BrowserToken);
+		Packer.AddRaw(m_aInfo, m_InfoSize);
+		CNetBase::SendPacketConnless(m_Socket, pAddr, pPacket->m_ResponseToken, m_TokenManager.GenerateToken(pAddr), Packer.Data(), Packer.Size(), pSendBatch);
+	}
+	lock_unlock(m_InfoLock);
+	return true;
+}
+
+bool CNetServer::InfoRequestLimited(const NETADDR *pAddr)
+{
+	if(!m_InfoRateLimit)
+		return false;
+
+	// one slot per source address (without port), collisions simply share the slot
+	NETADDR Addr = *pAddr;
+	Addr.port = 0;
+	unsigned Hash = 0;
+	for(int i = 0; i < (int)sizeof(Addr.ip); i++)
+		Hash = Hash*31 + Addr.ip[i];
+	CInfoRequestSource *pSource = &m_aInfoRequestSources[Hash%INFO_REQUEST_SLOTS];
+
+	int64 Now = time_get();
+	if(net_addr_comp(&pSource->m_Addr, &Addr) != 0 || pSource->m_WindowStart + time_freq() < Now)
+	{
+		pSource->m_Addr = Addr;
+		pSource->m_WindowStart = Now;
+		pSource->m_NumRequests = 0;
+	}
+	return ++pSource->m_NumRequests > m_InfoRateLimit;
+}
+
+void CNetServer::SetServerInfo(const void *pData, int Size)
+{
+	lock_wait(m_InfoLock);
+	m_InfoSize = min(Size, (int)sizeof(m_aInfo));
+	mem_copy(m_aInfo, pData, m_InfoSize);
+	lock_unlock(m_InfoLock);
+}
+
+void CNetServer::SetInfoRateLimit(int Limit)
+{
+	if(Limit == m_InfoRateLimit)
+		return;
+
+	lock_wait(m_InfoLock);
+	m_InfoRateLimit = Limit;
+	lock_unlock(m_InfoLock);
+}
+
+// fetches the next packet, either from the network thread or directly from the socket
+bool CNetServer::FetchPacket(NETADDR *pAddr)
+{
+	// also drain what the thread left behind after it was stopped
+	if(m_pThread || !m_RecvQueue.Empty())
+	{
+		CNetQueuedConstruct *pEntry = m_RecvQueue.Front();
+		if(!pEntry)
+			return false;
+
+		*pAddr = pEntry->m_Addr;
+		mem_copy(&m_RecvUnpacker.m_Data, &pEntry->m_Data, sizeof(m_RecvUnpacker.m_Data));
+		m_RecvQueue.Pop();
+		return true;
+	}
+
+	while(1)
+	{
+		unsigned char *pData;
+		int Bytes = m_RecvBatch.Fetch(pAddr, &pData);
+
+		// no more packets for now
+		if(Bytes <= 0)
+			return false;
+
+		if(CNetBase::UnpackPacket(pData, Bytes, &m_RecvUnpacker.m_Data) == 0 && !ProcessEarly(pAddr, &m_RecvUnpacker.m_Data, &m_SendBatch))
+			return true;
+	}
+}
+
 int CNetServer::Drop(int ClientID, const char *pReason)
 {
 	// TODO: insert lots of checks here
@@ -90,7 +311,10 @@ int CNetServer::Update()
 		}
 	}
 
+	// the network thread checks info request tokens against the seed
+	lock_wait(m_InfoLock);
 	m_TokenManager.Update();
+	lock_unlock(m_InfoLock);
 	m_TokenCache.Update();
 
 	return 0;
@@ -110,121 +334,106 @@ int CNetServer::Recv(CNetChunk *pChunk, TOKEN *pResponseToken)
 			return 1;
 
 		// TODO: empty the recvinfo
-		int Bytes = net_udp_recv(m_Socket, &Addr, m_RecvUnpacker.m_aBuffer, NET_MAX_PACKETSIZE);
-
-		// no more packets for now
-		if(Bytes <= 0)
+		if(!FetchPacket(&Addr))
 			break;
 
-		if(CNetBase::UnpackPacket(m_RecvUnpacker.m_aBuffer, Bytes, &m_RecvUnpacker.m_Data) == 0)
+		bool Found = false;
+		// try to find matching slot
+		for(int i = 0; i < MaxClients(); i++)
 		{
-			// check for bans
-			char aBuf[128];
-			if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
-			{
-				// banned, reply with a message
-				CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf)+1);
-				continue;
-			}
-
-			bool Found = false;
-			// try to find matching slot
-			for(int i = 0; i < MaxClients(); i++)
+			if(net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
 			{
-				if(net_addr_comp(m_aSlots[i].m_Connection.PeerAddress(), &Addr) == 0)
+				if(m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
 				{
-					if(m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr))
+					if(m_RecvUnpacker.m_Data.m_DataSize)
 					{
-						if(m_RecvUnpacker.m_Data.m_DataSize)
+						if(!(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS))
+							m_RecvUnpacker.Start(&Addr, &m_aSlots[i].m_Connection, i);
+						else
 						{
-							if(!(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS))
-								m_RecvUnpacker.Start(&Addr, &m_aSlots[i].m_Connection, i);
-							else
-							{
-								pChunk->m_Flags = NETSENDFLAG_CONNLESS;
-								pChunk->m_Address = *m_aSlots[i].m_Connection.PeerAddress();
-								pChunk->m_ClientID = i;
-								pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
-								pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
-								if(pResponseToken)
-									*pResponseToken = NET_TOKEN_NONE;
-								return 1;
-							}
+							pChunk->m_Flags = NETSENDFLAG_CONNLESS;
+							pChunk->m_Address = *m_aSlots[i].m_Connection.PeerAddress();
+							pChunk->m_ClientID = i;
+							pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
+							pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
+							if(pResponseToken)
+								*pResponseToken = NET_TOKEN_NONE;
+							return 1;
 						}
 					}
-					Found = true;
 				}
+				Found = true;
 			}
+		}
 
-			if(Found)
-				continue;
+		if(Found)
+			continue;
 
-			int Accept = m_TokenManager.ProcessMessage(&Addr, &m_RecvUnpacker.m_Data);
-			if(Accept <= 0)
-				continue;
+		int Accept = m_TokenManager.ProcessMessage(&Addr, &m_RecvUnpacker.m_Data);
+		if(Accept <= 0)
+			continue;
 
-			if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONTROL)
+		if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONTROL)
+		{
+			if(m_RecvUnpacker.m_Data.m_aChunkData[0] == NET_CTRLMSG_CONNECT)
 			{
-				if(m_RecvUnpacker.m_Data.m_aChunkData[0] == NET_CTRLMSG_CONNECT)
+				bool Found = false;
+
+				// only allow a specific number of players with the same ip
+				NETADDR ThisAddr = Addr, OtherAddr;
+				int FoundAddr = 1;
+				ThisAddr.port = 0;
+				for(int i = 0; i < MaxClients(); i++)
 				{
-					bool Found = false;
+					if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
+						continue;
 
-					// only allow a specific number of players with the same ip
-					NETADDR ThisAddr = Addr, OtherAddr;
-					int FoundAddr = 1;
-					ThisAddr.port = 0;
-					for(int i = 0; i < MaxClients(); i++)
+					OtherAddr = *m_aSlots[i].m_Connection.PeerAddress();
+					OtherAddr.port = 0;
+					if(!net_addr_comp(&ThisAddr, &OtherAddr))
 					{
-						if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-							continue;
-
-						OtherAddr = *m_aSlots[i].m_Connection.PeerAddress();
-						OtherAddr.port = 0;
-						if(!net_addr_comp(&ThisAddr, &OtherAddr))
+						if(FoundAddr++ >= m_MaxClientsPerIP)
 						{
-							if(FoundAddr++ >= m_MaxClientsPerIP)
-							{
-								char aBuf[128];
-								str_format(aBuf, sizeof(aBuf), "Only %d players with the same IP are allowed", m_MaxClientsPerIP);
-								CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1);
-								return 0;
-							}
+							char aBuf[128];
+							str_format(aBuf, sizeof(aBuf), "Only %d players with the same IP are allowed", m_MaxClientsPerIP);
+							CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf) + 1);
+							return 0;
 						}
 					}
+				}
 
-					for(int i = 0; i < MaxClients(); i++)
+				for(int i = 0; i < MaxClients(); i++)
+				{
+					if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
 					{
-						if(m_aSlots[i].m_Connection.State() == NET_CONNSTATE_OFFLINE)
-						{
-							Found = true;
-							m_aSlots[i].m_Connection.SetToken(m_RecvUnpacker.m_Data.m_Token);
-							m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr);
-							if(m_pfnNewClient)
-								m_pfnNewClient(i, m_UserPtr);
-							break;
-						}
+						Found = true;
+						m_aSlots[i].m_Connection.SetToken(m_RecvUnpacker.m_Data.m_Token);
+						m_aSlots[i].m_Connection.Feed(&m_RecvUnpacker.m_Data, &Addr);
+						if(m_pfnNewClient)
+							m_pfnNewClient(i, m_UserPtr);
+						break;
 					}
+				}
 
-					if(!Found)
-					{
-						const char FullMsg[] = "This server is full";
-						CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, FullMsg, sizeof(FullMsg));
-					}
+				if(!Found)
+				{
+					const char FullMsg[] = "This server is full";
+					CNetBase::SendControlMsg(m_Socket, &Addr, m_RecvUnpacker.m_Data.m_ResponseToken, 0, NET_CTRLMSG_CLOSE, FullMsg, sizeof(FullMsg));
 				}
-				else if(m_RecvUnpacker.m_Data.m_aChunkData[0] == NET_CTRLMSG_TOKEN)
-					m_TokenCache.AddToken(&Addr, m_RecvUnpacker.m_Data.m_ResponseToken, NET_TOKENFLAG_RESPONSEONLY);
-			}
-			else if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS)
-			{
-				pChunk->m_Flags = NETSENDFLAG_CONNLESS;
-				pChunk->m_ClientID = -1;
-				pChunk->m_Address = Addr;
-				pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
-				pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
-				if(pResponseToken)
-					*pResponseToken = m_RecvUnpacker.m_Data.m_ResponseToken;
-				return 1;
 			}
+			else if(m_RecvUnpacker.m_Data.m_aChunkData[0] == NET_CTRLMSG_TOKEN)
+				m_TokenCache.AddToken(&Addr, m_RecvUnpacker.m_Data.m_ResponseToken, NET_TOKENFLAG_RESPONSEONLY);
+		}
+		else if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS)
+		{
+			pChunk->m_Flags = NETSENDFLAG_CONNLESS;
+			pChunk->m_ClientID = -1;
+			pChunk->m_Address = Addr;
+			pChunk->m_DataSize = m_RecvUnpacker.m_Data.m_DataSize;
+			pChunk->m_pData = m_RecvUnpacker.m_Data.m_aChunkData;
+			if(pResponseToken)
+				*pResponseToken = m_RecvUnpacker.m_Data.m_ResponseToken;
+			return 1;
 		}
 	}
 	return 0;
@@ -251,7 +460,7 @@ int CNetServer::Send(CNetChunk *pChunk, TOKEN Token)
 
 		if(Token != NET_TOKEN_NONE)
 		{
-			CNetBase::SendPacketConnless(m_Socket, &pChunk->m_Address, Token, m_TokenManager.GenerateToken(&pChunk->m_Address), pChunk->m_pData, pChunk->m_DataSize);
+			CNetBase::SendPacketConnless(m_Socket, &pChunk->m_Address, Token, m_TokenManager.GenerateToken(&pChunk->m_Address), pChunk->m_pData, pChunk->m_DataSize, &m_SendBatch);
 		}
 		else
 		{
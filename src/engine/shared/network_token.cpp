@@ -80,7 +80,7 @@ void CNetTokenManager::GenerateSeed()
 	for(int i = 0; i < 2; i++)
 	{
 		m_Seed <<= 32;
-		m_Seed ^= random_int();
+		m_Seed ^= CNetBase::RandomBits();
 	}
 
 	m_PrevGlobalToken = m_GlobalToken;
@@ -0,0 +1,108 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <stdlib.h>
+
+#include <base/math.h>
+#include <base/system.h>
+
+#include "profiler.h"
+
+CTickProfiler::CTickProfiler()
+{
+	m_NumPhases = 0;
+	m_CurrentPhase = -1;
+	m_Enabled = false;
+	m_Freq = time_freq();
+}
+
+int CTickProfiler::RegisterPhase(const char *pName)
+{
+	for(int i = 0; i < m_NumPhases; i++)
+	{
+		if(str_comp(m_aPhases[i].m_aName, pName) == 0)
+			return i;
+	}
+
+	if(m_NumPhases == MAX_PHASES)
+	{
+		dbg_msg("profiler", "too many phases, can't register '%s'", pName);
+		return -1;
+	}
+
+	CPhase *pPhase = &m_aPhases[m_NumPhases];
+	str_copy(pPhase->m_aName, pName, sizeof(pPhase->m_aName));
+	pPhase->m_NumSamples = 0;
+	pPhase->m_FrameSelf = 0;
+	pPhase->m_Total = 0;
+	return m_NumPhases++;
+}
+
+void CTickProfiler::Add(int Phase, int64 Duration)
+{
+	CPhase *pPhase = &m_aPhases[Phase];
+	pPhase->m_aSamples[pPhase->m_NumSamples%NUM_SAMPLES] = (int)(Duration*1000000/m_Freq);
+	pPhase->m_NumSamples++;
+	pPhase->m_Total += Duration;
+
+	pPhase->m_FrameSelf += Duration;
+	if(m_CurrentPhase >= 0 && m_CurrentPhase != Phase)
+		m_aPhases[m_CurrentPhase].m_FrameSelf -= Duration;
+}
+
+void CTickProfiler::Reset()
+{
+	for(int i = 0; i < m_NumPhases; i++)
+	{
+		m_aPhases[i].m_NumSamples = 0;
+		m_aPhases[i].m_Total = 0;
+	}
+}
+
+void CTickProfiler::BeginFrame()
+{
+	for(int i = 0; i < m_NumPhases; i++)
+		m_aPhases[i].m_FrameSelf = 0;
+}
+
+int CTickProfiler::WorstFramePhase(int64 *pSelfTime) const
+{
+	int Worst = -1;
+	int64 WorstTime = 0;
+	for(int i = 0; i < m_NumPhases; i++)
+	{
+		if(m_aPhases[i].m_FrameSelf > WorstTime)
+		{
+			Worst = i;
+			WorstTime = m_aPhases[i].m_FrameSelf;
+		}
+	}
+	*pSelfTime = WorstTime;
+	return Worst;
+}
+
+static int CompareSamples(const void *pA, const void *pB)
+{
+	return *(const int *)pA - *(const int *)pB;
+}
+
+void CTickProfiler::GetSummary(int Phase, CSummary *pSummary) const
+{
+	const CPhase *pPhase = &m_aPhases[Phase];
+	int NumSamples = min(pPhase->m_NumSamples, (int)NUM_SAMPLES);
+
+	pSummary->m_pName = pPhase->m_aName;
+	pSummary->m_NumSamples = pPhase->m_NumSamples;
+	pSummary->m_P50 = 0;
+	pSummary->m_P99 = 0;
+	pSummary->m_Max = 0;
+	pSummary->m_Total = pPhase->m_Total*1000000/m_Freq;
+	if(!NumSamples)
+		return;
+
+	int aSorted[NUM_SAMPLES];
+	mem_copy(aSorted, pPhase->m_aSamples, NumSamples*sizeof(int));
+	qsort(aSorted, NumSamples, sizeof(int), CompareSamples);
+	pSummary->m_P50 = aSorted[(NumSamples-1)*50/100];
+	pSummary->m_P99 = aSorted[(NumSamples-1)*99/100];
+	pSummary->m_Max = aSorted[NumSamples-1];
+}
@@ -0,0 +1,105 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_PROFILER_H
+#define ENGINE_SHARED_PROFILER_H
+
+#include <base/system.h>
+
+// keeps the last NUM_SAMPLES durations of each named phase of the server tick
+// and the time spent in each phase since the last BeginFrame, nested phases excluded
+class CTickProfiler
+{
+public:
+	enum
+	{
+		MAX_PHASES=32,
+		MAX_PHASE_NAME=32,
+		NUM_SAMPLES=512, // ~10 seconds of ticks
+	};
+
+	struct CSummary
+	{
+		const char *m_pName;
+		int m_NumSamples;
+		// in microseconds over the samples kept
+		int m_P50;
+		int m_P99;
+		int m_Max;
+		int64 m_Total; // in microseconds over all samples since reset
+	};
+
+private:
+	struct CPhase
+	{
+		char m_aName[MAX_PHASE_NAME];
+		int m_aSamples[NUM_SAMPLES]; // microseconds
+		int m_NumSamples; // total since reset, the next sample goes to m_NumSamples%NUM_SAMPLES
+		int64 m_FrameSelf; // time_get() units
+		int64 m_Total; // time_get() units
+	};
+
+	CPhase m_aPhases[MAX_PHASES];
+	int m_NumPhases;
+	int m_CurrentPhase; // innermost running scope, -1 outside of all
+	bool m_Enabled;
+	int64 m_Freq;
+
+public:
+	CTickProfiler();
+
+	// returns the id of an already registered phase with the same name, -1 if there is no room
+	int RegisterPhase(const char *pName);
+
+	void SetEnabled(bool Enabled) { m_Enabled = Enabled; }
+	bool Enabled() const { return m_Enabled; }
+
+	// Duration is in time_get() units, it is not counted as own time of the current phase
+	void Add(int Phase, int64 Duration);
+	void Reset();
+
+	int CurrentPhase() const { return m_CurrentPhase; }
+	void SetCurrentPhase(int Phase) { m_CurrentPhase = Phase; }
+
+	void BeginFrame();
+	// phase with the most own time since BeginFrame, -1 if nothing was timed
+	int WorstFramePhase(int64 *pSelfTime) const;
+
+	int NumPhases() const { return m_NumPhases; }
+	const char *PhaseName(int Phase) const { return m_aPhases[Phase].m_aName; }
+	void GetSummary(int Phase, CSummary *pSummary) const;
+};
+
+// times the enclosing scope, only costs a branch while the profiler is disabled
+class CProfileScope
+{
+	CTickProfiler *m_pProfiler;
+	int m_Phase;
+	int m_OuterPhase;
+	int64 m_Start;
+
+public:
+	CProfileScope(CTickProfiler *pProfiler, int Phase)
+	{
+		m_pProfiler = pProfiler->Enabled() && Phase >= 0 ? pProfiler : 0;
+		m_Phase = Phase;
+		m_OuterPhase = -1;
+		m_Start = 0;
+		if(m_pProfiler)
+		{
+			m_OuterPhase = m_pProfiler->CurrentPhase();
+			m_pProfiler->SetCurrentPhase(Phase);
+			m_Start = time_get();
+		}
+	}
+
+	~CProfileScope()
+	{
+		if(m_pProfiler)
+		{
+			m_pProfiler->SetCurrentPhase(m_OuterPhase);
+			m_pProfiler->Add(m_Phase, time_get()-m_Start);
+		}
+	}
+};
+
+#endif
@@ -117,12 +117,10 @@ static int DiffItem(int *pPast, int *pCurrent, int *pOut, int Size)
 	return Needed;
 }
 
-void CSnapshotDelta::UndiffItem(int *pPast, int *pDiff, int *pOut, int Size)
+void CSnapshotDelta::UpdateDataRate(const int *pDiff, int Size)
 {
 	while(Size)
 	{
-		*pOut = *pPast+*pDiff;
-
 		if(*pDiff == 0)
 			m_aSnapshotDataRate[m_SnapshotCurrent] += 1;
 		else
@@ -132,6 +130,19 @@ void CSnapshotDelta::UndiffItem(int *pPast, int *pDiff, int *pOut, int Size)
 			m_aSnapshotDataRate[m_SnapshotCurrent] += (int)(pEnd - (unsigned char*)aBuf) * 8;
 		}
 
+		pDiff++;
+		Size--;
+	}
+}
+
+void CSnapshotDelta::UndiffItem(int *pPast, int *pDiff, int *pOut, int Size)
+{
+	UpdateDataRate(pDiff, Size);
+
+	while(Size)
+	{
+		*pOut = *pPast+*pDiff;
+
 		pOut++;
 		pPast++;
 		pDiff++;
@@ -145,6 +156,7 @@ CSnapshotDelta::CSnapshotDelta()
 	mem_zero(m_aSnapshotDataRate, sizeof(m_aSnapshotDataRate));
 	mem_zero(m_aSnapshotDataUpdates, sizeof(m_aSnapshotDataUpdates));
 	m_SnapshotCurrent = 0;
+	m_CreateDataRate = false;
 	mem_zero(&m_Empty, sizeof(m_Empty));
 }
 
@@ -220,6 +232,12 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 
 			if(DiffItem((int*)pPastItem->Data(), (int*)pCurItem->Data(), pItemDataDst, ItemSize/4))
 			{
+				if(m_CreateDataRate)
+				{
+					m_SnapshotCurrent = pCurItem->Type();
+					UpdateDataRate(pItemDataDst, ItemSize/4);
+					m_aSnapshotDataUpdates[m_SnapshotCurrent]++;
+				}
 
 				*pData++ = pCurItem->Type();
 				*pData++ = pCurItem->ID();
@@ -237,6 +255,11 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 				*pData++ = ItemSize/4;
 
 			mem_copy(pData, pCurItem->Data(), ItemSize);
+			if(m_CreateDataRate)
+			{
+				m_aSnapshotDataRate[pCurItem->Type()] += ItemSize*8;
+				m_aSnapshotDataUpdates[pCurItem->Type()]++;
+			}
 			SizeCount += ItemSize;
 			pData += ItemSize/4;
 			pDelta->m_NumUpdateItems++;
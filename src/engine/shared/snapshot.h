@@ -66,14 +66,18 @@ private:
 	int m_aSnapshotDataRate[0xffff];
 	int m_aSnapshotDataUpdates[0xffff];
 	int m_SnapshotCurrent;
+	bool m_CreateDataRate; // CreateDelta only counts when somebody reads the counters
 	CData m_Empty;
 
+	void UpdateDataRate(const int *pDiff, int Size);
 	void UndiffItem(int *pPast, int *pDiff, int *pOut, int Size);
 
 public:
 	CSnapshotDelta();
 	int GetDataRate(int Index) { return m_aSnapshotDataRate[Index]; }
 	int GetDataUpdates(int Index) { return m_aSnapshotDataUpdates[Index]; }
+	void ClearDataRate(int Index) { m_aSnapshotDataRate[Index] = 0; m_aSnapshotDataUpdates[Index] = 0; }
+	void SetCreateDataRate(bool Enable) { m_CreateDataRate = Enable; }
 	void SetStaticsize(int ItemType, int Size);
 	CData *EmptyDelta();
 	int CreateDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData);
@@ -0,0 +1,124 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include "chatcommands.h"
+
+static char s_aEmptyArg[1] = { 0 };
+
+char *CChatCommands::CResult::GetString(int Index)
+{
+	if(Index < 0 || Index >= m_NumArgs)
+		return s_aEmptyArg;
+	return m_apArgs[Index];
+}
+
+int CChatCommands::CResult::GetInteger(int Index)
+{
+	return str_toint(GetString(Index));
+}
+
+const char *CChatCommands::CResult::GetRest(int Index)
+{
+	if(Index < 0 || Index >= m_NumArgs)
+		return "";
+	return m_apRest[Index];
+}
+
+CChatCommands::CChatCommands()
+{
+	m_NumCommands = 0;
+	mem_zero(m_aHashTable, sizeof(m_aHashTable));
+}
+
+CChatCommands::CCommand *CChatCommands::Find(const char *pName)
+{
+	// case insensitive, commands are matched like str_comp_nocase
+	for(unsigned Slot = str_quickhash_nocase(pName)&(HASHTABLE_SIZE-1); m_aHashTable[Slot]; Slot = (Slot+1)&(HASHTABLE_SIZE-1))
+	{
+		CCommand *pCommand = &m_aCommands[m_aHashTable[Slot]-1];
+		if(str_comp_nocase(pCommand->m_pName, pName) == 0)
+			return pCommand;
+	}
+	return 0;
+}
+
+void CChatCommands::Register(const char *pName, int AccessLevel, int Cooldown, FCommandCallback pfnCallback, void *pUserData)
+{
+	CCommand *pCommand = Find(pName);
+	if(!pCommand)
+	{
+		if(m_NumCommands == MAX_COMMANDS)
+		{
+			dbg_msg("chatcommands", "too many commands, can't register '%s'", pName);
+			return;
+		}
+
+		pCommand = &m_aCommands[m_NumCommands++];
+		unsigned Slot = str_quickhash_nocase(pName)&(HASHTABLE_SIZE-1);
+		while(m_aHashTable[Slot])
+			Slot = (Slot+1)&(HASHTABLE_SIZE-1);
+		m_aHashTable[Slot] = m_NumCommands;
+	}
+
+	pCommand->m_pName = pName;
+	pCommand->m_AccessLevel = AccessLevel;
+	pCommand->m_Cooldown = Cooldown;
+	pCommand->m_pfnCallback = pfnCallback;
+	pCommand->m_pUserData = pUserData;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		pCommand->m_aLastUse[i] = -1;
+}
+
+int CChatCommands::Execute(int ClientID, const char *pLine, int AccessLevel, int Tick)
+{
+	CResult Result;
+	Result.m_ClientID = ClientID;
+	Result.m_NumArgs = 0;
+	str_copy(Result.m_aBuffer, pLine, sizeof(Result.m_aBuffer));
+
+	// split the copy at spaces: the command name followed by up to MAX_ARGS arguments
+	char *pCommandName = s_aEmptyArg;
+	char *p = Result.m_aBuffer;
+	for(int i = 0; i <= MAX_ARGS; i++)
+	{
+		while(*p == ' ')
+			p++;
+		if(!*p)
+			break;
+
+		if(i == 0)
+			pCommandName = p;
+		else
+		{
+			Result.m_apArgs[Result.m_NumArgs] = p;
+			Result.m_apRest[Result.m_NumArgs] = pLine + (p-Result.m_aBuffer);
+			Result.m_NumArgs++;
+		}
+
+		while(*p && *p != ' ')
+			p++;
+		if(*p)
+			*p++ = 0;
+	}
+
+	CCommand *pCommand = Find(pCommandName);
+	if(!pCommand)
+		return EXEC_UNKNOWN;
+	if(AccessLevel < pCommand->m_AccessLevel)
+		return EXEC_DENIED;
+
+	int *pLastUse = &pCommand->m_aLastUse[ClientID];
+	if(pCommand->m_Cooldown && *pLastUse >= 0 && Tick < *pLastUse + pCommand->m_Cooldown)
+		return EXEC_COOLDOWN;
+	*pLastUse = Tick;
+
+	pCommand->m_pfnCallback(&Result, pCommand->m_pUserData);
+	return EXEC_DONE;
+}
+
+void CChatCommands::ClearClient(int ClientID)
+{
+	for(int i = 0; i < m_NumCommands; i++)
+		m_aCommands[i].m_aLastUse[ClientID] = -1;
+}
@@ -0,0 +1,81 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_SERVER_CHATCOMMANDS_H
+#define GAME_SERVER_CHATCOMMANDS_H
+
+#include <engine/shared/protocol.h>
+
+// slash commands players can type into the chat
+class CChatCommands
+{
+public:
+	enum
+	{
+		MAX_COMMANDS=64,
+		MAX_ARGS=3,
+		HASHTABLE_SIZE=128, // power of two, twice MAX_COMMANDS
+
+		ACCESS_PLAYER=0,
+		ACCESS_MODERATOR,
+
+		EXEC_DONE=0,
+		EXEC_UNKNOWN,
+		EXEC_DENIED,
+		EXEC_COOLDOWN,
+	};
+
+	// the line is split once into a single copy, the rest pointers point into the original line
+	class CResult
+	{
+		friend class CChatCommands;
+
+		char m_aBuffer[512];
+		char *m_apArgs[MAX_ARGS];
+		const char *m_apRest[MAX_ARGS];
+		int m_NumArgs;
+
+	public:
+		int m_ClientID;
+
+		int NumArguments() const { return m_NumArgs; }
+
+		// missing arguments are returned as empty strings
+		char *GetString(int Index);
+		int GetInteger(int Index);
+		// the rest of the line starting at the given argument, spaces included
+		const char *GetRest(int Index);
+	};
+
+	typedef void (*FCommandCallback)(CResult *pResult, void *pUserData);
+
+private:
+	struct CCommand
+	{
+		const char *m_pName;
+		int m_AccessLevel;
+		int m_Cooldown; // in ticks
+		FCommandCallback m_pfnCallback;
+		void *m_pUserData;
+		int m_aLastUse[MAX_CLIENTS];
+	};
+
+	CCommand m_aCommands[MAX_COMMANDS];
+	int m_NumCommands;
+	int m_aHashTable[HASHTABLE_SIZE]; // command index+1, 0 marks a free slot
+
+	CCommand *Find(const char *pName);
+
+public:
+	CChatCommands();
+
+	// pName has to stay valid, registering a name again replaces the command
+	void Register(const char *pName, int AccessLevel, int Cooldown, FCommandCallback pfnCallback, void *pUserData);
+
+	// pLine is the chat message without the leading slash
+	int Execute(int ClientID, const char *pLine, int AccessLevel, int Tick);
+
+	// forgets the cooldowns of a client slot, so the next client in it starts fresh
+	void ClearClient(int ClientID);
+};
+
+#endif
@@ -55,6 +55,7 @@ CCharacter::CCharacter(CGameWorld *pWorld)
 	HandleVirtualHealth();
 
 	m_TriggeredEvents = 0;
+	m_WeaponProfile.m_Generation = -1;
 }
 
 void CCharacter::Reset()
@@ -294,21 +295,8 @@ void CCharacter::FireWeapon()
 	DoWeaponSwitch();
 	vec2 Direction = normalize(vec2(m_LatestInput.m_TargetX, m_LatestInput.m_TargetY));
 
-	bool FullAuto = false;
-
 	// check if we have auto hammer / gun yet
-	switch (m_ActiveWeapon)
-	{
-	case WEAPON_HAMMER:
-		FullAuto = m_pPlayer->m_aPlayer_stat[m_ActiveWeapon] >= GameServer()->m_Req_hammer_auto;
-		break;
-	case WEAPON_GUN:
-		FullAuto = m_pPlayer->m_aPlayer_stat[m_ActiveWeapon] >= GameServer()->m_Req_gun_auto;
-		break;
-	default:// for special weapons
-		FullAuto = true;
-		break;
-	}
+	bool FullAuto = WeaponProfile()->m_aFullAuto[m_ActiveWeapon];
 
 	// check if we gonna fire
 	bool WillFire = false;
@@ -673,81 +661,124 @@ void CCharacter::HandleWeapons()
 
 float CCharacter::GetDamage(int Weapon)
 {
-	float damage = 0;
-
-	if (Weapon < 0 || Weapon > WEAPON_LASER)
+	if (Weapon < 0 || Weapon >= NUM_WEAPONS)
 		return 0;
+	return WeaponProfile()->m_aDamage[Weapon];
+}
 
-	damage = (GameServer()->m_aBaseDmg[Weapon]) + (float)GameServer()->m_aBaseDmg[Weapon] * (GameServer()->m_DamageScaling / 100.0) * (m_pPlayer->m_aPlayer_stat[Weapon] - 1);
+float CCharacter::GetFireRate()
+{
+	return WeaponProfile()->m_aFireRate[m_ActiveWeapon];
+}
 
-	switch (m_ActiveWeapon)
+const CCharacter::CWeaponProfile *CCharacter::WeaponProfile()
+{
+	const CWeaponProfile *pProfile = &m_WeaponProfile;
+	if (pProfile->m_Generation != GameServer()->m_WeaponProfileGeneration ||
+		pProfile->m_SwitchMode != m_pPlayer->m_aPlayer_option[0] ||
+		pProfile->m_BonusHandle != GameServer()->m_EvtBonusHandle ||
+		mem_comp(pProfile->m_aStats, m_pPlayer->m_aPlayer_stat, sizeof(pProfile->m_aStats)) != 0)
+		BuildWeaponProfile();
+	return pProfile;
+}
+
+void CCharacter::BuildWeaponProfile()
+{
+	CWeaponProfile *pProfile = &m_WeaponProfile;
+	mem_copy(pProfile->m_aStats, m_pPlayer->m_aPlayer_stat, sizeof(pProfile->m_aStats));
+	pProfile->m_SwitchMode = m_pPlayer->m_aPlayer_option[0];
+	pProfile->m_BonusHandle = GameServer()->m_EvtBonusHandle;
+	pProfile->m_Generation = GameServer()->m_WeaponProfileGeneration;
+
+	for (int Weapon = 0; Weapon < NUM_WEAPONS; Weapon++)
 	{
-	case WEAPON_HAMMER:// increase hammer damage in fly mode
-		if (m_pPlayer->m_aPlayer_option[0] != 1 && m_pPlayer->m_aPlayer_stat[WEAPON_HAMMER] >= GameServer()->m_Req_hammer_fly)
-		damage *= GameServer()->swep_hammer_dmgscale;
-		break;
+		// damage
+		float damage = 0;
 
-	case WEAPON_GUN:
-		damage *= GameServer()->swep_gun_dmgscale;
-		break;
+		if (Weapon <= WEAPON_LASER)
+		{
+			damage = (GameServer()->m_aBaseDmg[Weapon]) + (float)GameServer()->m_aBaseDmg[Weapon] * (GameServer()->m_DamageScaling / 100.0) * (m_pPlayer->m_aPlayer_stat[Weapon] - 1);
 
-	case WEAPON_SHOTGUN:
-		damage *= GameServer()->swep_shotgun_dmgscale;
-		break;
+			switch (Weapon)
+			{
+			case WEAPON_HAMMER:// increase hammer damage in fly mode
+				if (m_pPlayer->m_aPlayer_option[0] != 1 && m_pPlayer->m_aPlayer_stat[WEAPON_HAMMER] >= GameServer()->m_Req_hammer_fly)
+				damage *= GameServer()->swep_hammer_dmgscale;
+				break;
+
+			case WEAPON_GUN:
+				damage *= GameServer()->swep_gun_dmgscale;
+				break;
+
+			case WEAPON_SHOTGUN:
+				damage *= GameServer()->swep_shotgun_dmgscale;
+				break;
+
+			case WEAPON_GRENADE:
+				damage *= GameServer()->swep_grenade_dmgscale;
+				break;
+
+			case WEAPON_LASER:
+				damage *= GameServer()->swep_rifle_dmgscale;
+				break;
+			}
+		}
 
-	case WEAPON_GRENADE:
-		damage *= GameServer()->swep_grenade_dmgscale;
-		break;
+		pProfile->m_aDamage[Weapon] = damage;
 
-	case WEAPON_LASER:
-		damage *= GameServer()->swep_rifle_dmgscale;
-		break;
-	}
+		// fire rate
+		// show effect only each 10 steps
+		// m_ReloadTimer = (AsBase / (1 + (1 * floor((float)m_pPlayer->m_aPlayer_stat[6] / 10) * (AsPerTen / 100.0))))// increase only each 10 handle
 
-	//	GameServer()->ServerMessage(0, "%.2f", damage);
-	
-		return damage;
-}
+		float Retval = 0;
+		float AsPerTen = 50;// % attackspeed increase each 10 level (smooth increase)
+		float AsBase = g_pData->m_Weapons.m_aId[Weapon].m_Firedelay;
 
-float CCharacter::GetFireRate()
-{
-	// show effect only each 10 steps
-	// m_ReloadTimer = (AsBase / (1 + (1 * floor((float)m_pPlayer->m_aPlayer_stat[6] / 10) * (AsPerTen / 100.0))))// increase only each 10 handle
+		Retval = (AsBase / (1 + (1 * (((float)m_pPlayer->m_aPlayer_stat[6] + GameServer()->m_EvtBonusHandle) / 10) * (AsPerTen / 100.0))))
+			* Server()->TickSpeed() / 1000;
 
-	float Retval = 0;
-	float AsPerTen = 50;// % attackspeed increase each 10 level (smooth increase)
-	float AsBase = g_pData->m_Weapons.m_aId[m_ActiveWeapon].m_Firedelay;
+		if (Weapon == WEAPON_HAMMER && m_pPlayer->m_aPlayer_stat[WEAPON_HAMMER] >= GameServer()->m_Req_hammer_fly)
+		{
+			// double firerate for fly hammer
+			if (m_pPlayer->m_aPlayer_option[0] == 0)
+				Retval *= (1.f - 0.2);
+			else// half firerate for mine hammer
+				Retval *= 2;
+		}
+		
+		// switchmode gun one third firerate decrease
+		if (Weapon == WEAPON_GUN && m_pPlayer->m_aPlayer_option[0] == 1 && m_pPlayer->m_aPlayer_stat[WEAPON_GUN] >= GameServer()->m_Req_gun_spread)
+		{
+			Retval *= (1.f + 1.f/3);
+		}
 
-	Retval = (AsBase / (1 + (1 * (((float)m_pPlayer->m_aPlayer_stat[6] + GameServer()->m_EvtBonusHandle) / 10) * (AsPerTen / 100.0))))
-		* Server()->TickSpeed() / 1000;
+		// switchmode rifle *amount spread firerate
+		if (Weapon == WEAPON_LASER && m_pPlayer->m_aPlayer_option[0] == 1)
+		{
+			// double spread to double firerate
+			if (m_pPlayer->m_aPlayer_stat[WEAPON_LASER] >= GameServer()->m_Req_rifle_dual)
+				Retval /= 2;
+			// triple spread to triple firerate
+			if (m_pPlayer->m_aPlayer_stat[WEAPON_LASER] >= GameServer()->m_Req_rifle_triple)
+				Retval /= 2;
+		}
 
-	if (m_ActiveWeapon == WEAPON_HAMMER && m_pPlayer->m_aPlayer_stat[WEAPON_HAMMER] >= GameServer()->m_Req_hammer_fly)
-	{
-		// double firerate for fly hammer
-		if (m_pPlayer->m_aPlayer_option[0] == 0)
-			Retval *= (1.f - 0.2);
-		else// half firerate for mine hammer
-			Retval *= 2;
-	}
-	
-	// switchmode gun one third firerate decrease
-	if (m_ActiveWeapon == WEAPON_GUN && m_pPlayer->m_aPlayer_option[0] == 1 && m_pPlayer->m_aPlayer_stat[WEAPON_GUN] >= GameServer()->m_Req_gun_spread)
-	{
-		Retval *= (1.f + 1.f/3);
-	}
+		pProfile->m_aFireRate[Weapon] = Retval;
 
-	// switchmode rifle *amount spread firerate
-	if (m_ActiveWeapon == WEAPON_LASER && m_pPlayer->m_aPlayer_option[0] == 1)
-	{
-		// double spread to double firerate
-		if (m_pPlayer->m_aPlayer_stat[WEAPON_LASER] >= GameServer()->m_Req_rifle_dual)
-			Retval /= 2;
-		// triple spread to triple firerate
-		if (m_pPlayer->m_aPlayer_stat[WEAPON_LASER] >= GameServer()->m_Req_rifle_triple)
-			Retval /= 2;
+		// check if we have auto hammer / gun yet
+		switch (Weapon)
+		{
+		case WEAPON_HAMMER:
+			pProfile->m_aFullAuto[Weapon] = m_pPlayer->m_aPlayer_stat[Weapon] >= GameServer()->m_Req_hammer_auto;
+			break;
+		case WEAPON_GUN:
+			pProfile->m_aFullAuto[Weapon] = m_pPlayer->m_aPlayer_stat[Weapon] >= GameServer()->m_Req_gun_auto;
+			break;
+		default:// for special weapons
+			pProfile->m_aFullAuto[Weapon] = true;
+			break;
+		}
 	}
-
-	return Retval;
 }
 
 bool CCharacter::GiveWeapon(int Weapon, int Ammo)
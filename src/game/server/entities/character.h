@@ -65,6 +65,7 @@ public:
 	void GainAmmoBack(int Amount);
 	void FreezeSelf();
 
+	// read from the weapon profile, rebuilt when its inputs change
 	float GetFireRate();
 	float GetDamage(int Weapon);
 
@@ -132,6 +133,23 @@ private:
 	float m_ReloadTimer;
 	int m_AttackTick;
 
+	// per weapon values derived from stats, switch mode, events and modsettings
+	struct CWeaponProfile
+	{
+		float m_aDamage[NUM_WEAPONS];
+		float m_aFireRate[NUM_WEAPONS]; // reload ticks
+		bool m_aFullAuto[NUM_WEAPONS];
+
+		// inputs the profile was built from
+		int m_aStats[7];
+		int m_SwitchMode;
+		int m_BonusHandle;
+		int m_Generation; // CGameContext::m_WeaponProfileGeneration, -1 while not built
+	} m_WeaponProfile;
+
+	const CWeaponProfile *WeaponProfile();
+	void BuildWeaponProfile();
+
 	int m_EmoteType;
 	signed long m_EmoteStop;
 
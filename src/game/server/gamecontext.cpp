@@ -4,6 +4,7 @@
 
 #include <engine/shared/config.h>
 #include <engine/shared/memheap.h>
+#include <engine/shared/profiler.h>
 #include <engine/map.h>
 
 #include <generated/server_data.h>
@@ -59,6 +60,7 @@ void CGameContext::Construct(int Resetting)
 {
 	m_Resetting = 0;
 	m_pServer = 0;
+	m_pAccountsFolder = FOLDERPATH_ACCOUNTS;
 
 	for (int i = 0; i < MAX_CLIENTS; i++)
 	{
@@ -81,7 +83,12 @@ void CGameContext::Construct(int Resetting)
 	m_aBaseDmg[3] = 6;// grenade
 	m_aBaseDmg[4] = 5;// rifle
 
+	// tick profiler phases, set in RegisterProfilePhases
+	for(int i = 0; i < NUM_PROFILE_PHASES; i++)
+		m_aProfilePhases[i] = -1;
+
 	// tune mod settings
+	m_pModSettingsWatch = 0;
 	if (TuneModSettings(FILEPATH_MODSETTINGS) == false)
 	{
 		printf("[%s]: error initializing %s\n", __func__, FILEPATH_MODSETTINGS);
@@ -120,6 +127,7 @@ void CGameContext::Clear()
 	CVoteOptionServer *pVoteOptionLast = m_pVoteOptionLast;
 	int NumVoteOptions = m_NumVoteOptions;
 	CTuningParams Tuning = m_Tuning;
+	FS_WATCH *pModSettingsWatch = m_pModSettingsWatch;
 
 	m_Resetting = true;
 	this->~CGameContext();
@@ -131,6 +139,7 @@ void CGameContext::Clear()
 	m_pVoteOptionLast = pVoteOptionLast;
 	m_NumVoteOptions = NumVoteOptions;
 	m_Tuning = Tuning;
+	m_pModSettingsWatch = pModSettingsWatch;
 }
 
 
@@ -313,24 +322,22 @@ void CGameContext::SendChat(int ChatterClientID, int Mode, int To, const char *p
 		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, -1);
 	else if(Mode == CHAT_TEAM)
 	{
-		// pack one for the recording only
-		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_NOSEND, -1);
-
 		To = m_apPlayers[ChatterClientID]->GetTeam();
 
-		// send to the clients
+		// pack once for the whole team
+		int64 Mask = 0;
 		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
 			if(m_apPlayers[i] && m_apPlayers[i]->GetTeam() == To)
-				Server()->SendPackMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_NORECORD, i);
+				Mask |= CmaskOne(i);
 		}
+		Server()->SendPackMsgMask(&Msg, MSGFLAG_VITAL, Mask);
 	}
 	else if(Mode == CHAT_WHISPER)
 	{
 		// send to the clients
 		Msg.m_TargetID = To;
-		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, ChatterClientID);
-		Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, To);
+		Server()->SendPackMsgMask(&Msg, MSGFLAG_VITAL, CmaskOne(ChatterClientID)|CmaskOne(To));
 	}
 	else if(Mode == CHAT_NONE)
 	{
@@ -345,6 +352,13 @@ void CGameContext::SendBroadcast(const char* pText, int ClientID)
 	Server()->SendPackMsg(&Msg, MSGFLAG_VITAL, ClientID);
 }
 
+void CGameContext::SendBroadcastMask(const char *pText, int64 Mask)
+{
+	CNetMsg_Sv_Broadcast Msg;
+	Msg.m_pMessage = pText;
+	Server()->SendPackMsgMask(&Msg, MSGFLAG_VITAL, Mask);
+}
+
 void CGameContext::SendEmoticon(int ClientID, int Emoticon)
 {
 	CNetMsg_Sv_Emoticon Msg;
@@ -430,6 +444,32 @@ void CGameContext::StartVote(const char *pDesc, const char *pCommand, const char
 	str_copy(m_aVoteReason, pReason, sizeof(m_aVoteReason));
 	SendVoteSet(m_VoteType, -1);
 	m_VoteUpdate = true;
+
+	// a map vote likely passes, load the map while the players vote
+	const char *pMap = 0;
+	if(str_comp_num(pCommand, "sv_map ", 7) == 0)
+		pMap = pCommand+7;
+	else if(str_comp_num(pCommand, "change_map ", 11) == 0)
+		pMap = pCommand+11;
+	if(pMap)
+	{
+		char aMap[128];
+		str_copy(aMap, pMap, sizeof(aMap));
+		char *pName = str_skip_whitespaces(aMap);
+		if(*pName == '"')
+			pName++;
+		for(int i = 0; pName[i]; i++)
+		{
+			if(pName[i] == '"' || pName[i] == ';')
+			{
+				pName[i] = 0;
+				break;
+			}
+		}
+		str_clean_whitespaces(pName);
+		if(pName[0])
+			Server()->PreloadMap(pName);
+	}
 }
 
 
@@ -549,6 +589,13 @@ void CGameContext::SwapTeams()
 
 void CGameContext::OnTick()
 {
+	// apply modsettings.cfg changes between ticks, once a second is plenty
+	if(m_pModSettingsWatch && Server()->Tick()%Server()->TickSpeed() == 0 && fs_watch_changed(m_pModSettingsWatch))
+	{
+		if(TuneModSettings(FILEPATH_MODSETTINGS))
+			SendTuningParams(-1);
+	}
+
 	// check tuning
 	CheckPureTuning();
 
@@ -557,19 +604,25 @@ void CGameContext::OnTick()
 	m_World.Tick();
 
 	//if(world.paused) // make sure that the game object always updates
-	m_pController->Tick();
+	{
+		CProfileScope ProfileController(Server()->TickProfiler(), m_aProfilePhases[PROFILE_CONTROLLER]);
+		m_pController->Tick();
+	}
 
-	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
-		if(m_apPlayers[i])
+		CProfileScope ProfilePlayers(Server()->TickProfiler(), m_aProfilePhases[PROFILE_PLAYERS]);
+		for(int i = 0; i < MAX_CLIENTS; i++)
 		{
-			m_apPlayers[i]->Tick();
-			m_apPlayers[i]->PostTick();
-			
-			if (m_apPlayers[i]->m_Player_logged == true)
+			if(m_apPlayers[i])
 			{
-				if (m_ClUpdateTime[i] > 0)
-					m_ClUpdateTime[i]--;
+				m_apPlayers[i]->Tick();
+				m_apPlayers[i]->PostTick();
+				
+				if (m_apPlayers[i]->m_Player_logged == true)
+				{
+					if (m_ClUpdateTime[i] > 0)
+						m_ClUpdateTime[i]--;
+				}
 			}
 		}
 	}
@@ -579,14 +632,18 @@ void CGameContext::OnTick()
 	{
 		m_HelpBroadcastDelay = m_HelpBroadcastDelayDefault * Server()->TickSpeed();
 
+		int64 Mask = 0;
 		for (int i = 0; i < MAX_CLIENTS; ++i)
 		{
 			if (!m_apPlayers[i] || m_apPlayers[i]->IsDummy())
 				continue;
 
 			if (!m_apPlayers[i]->m_Player_logged)
-				SendBroadcast("To join, write into chat:\n/register username password - registers your account\n/login username password - logs you in", m_apPlayers[i]->GetCID());
+				Mask |= CmaskOne(m_apPlayers[i]->GetCID());
 		}
+
+		if (Mask)
+			SendBroadcastMask("To join, write into chat:\n/register username password - registers your account\n/login username password - logs you in", Mask);
 	}
 
 	// update an account when its time again
@@ -652,11 +709,16 @@ void CGameContext::OnTick()
 		m_botchat_delay--;
 
 	// handle event system
-	HandleEventSystem();
+	{
+		CProfileScope ProfileEvents(Server()->TickProfiler(), m_aProfilePhases[PROFILE_EVENTS]);
+		HandleEventSystem();
+	}
 
 	// update voting
 	if(m_VoteCloseTime)
 	{
+		CProfileScope ProfileVotes(Server()->TickProfiler(), m_aProfilePhases[PROFILE_VOTES]);
+
 		// abort the kick-vote on player-leave
 		if(m_VoteCloseTime == -1)
 			EndVote(VOTE_END_ABORT, false);
@@ -664,42 +726,7 @@ void CGameContext::OnTick()
 		{
 			int Total = 0, Yes = 0, No = 0;
 			if(m_VoteUpdate)
-			{
-				// count votes
-				char aaBuf[MAX_CLIENTS][NETADDR_MAXSTRSIZE] = {{0}};
-				for(int i = 0; i < MAX_CLIENTS; i++)
-					if(m_apPlayers[i])
-						Server()->GetClientAddr(i, aaBuf[i], NETADDR_MAXSTRSIZE);
-				bool aVoteChecked[MAX_CLIENTS] = {0};
-				for(int i = 0; i < MAX_CLIENTS; i++)
-				{
-					if(!m_apPlayers[i] || m_apPlayers[i]->GetTeam() == TEAM_SPECTATORS || aVoteChecked[i] || m_apPlayers[i]->IsDummy())	// don't count in votes by spectators
-						continue;
-
-					int ActVote = m_apPlayers[i]->m_Vote;
-					int ActVotePos = m_apPlayers[i]->m_VotePos;
-
-					// check for more players with the same ip (only use the vote of the one who voted first)
-					for(int j = i+1; j < MAX_CLIENTS; ++j)
-					{
-						if(!m_apPlayers[j] || aVoteChecked[j] || str_comp(aaBuf[j], aaBuf[i]))
-							continue;
-
-						aVoteChecked[j] = true;
-						if(m_apPlayers[j]->m_Vote && (!ActVote || ActVotePos > m_apPlayers[j]->m_VotePos))
-						{
-							ActVote = m_apPlayers[j]->m_Vote;
-							ActVotePos = m_apPlayers[j]->m_VotePos;
-						}
-					}
-
-					Total++;
-					if(ActVote > 0)
-						Yes++;
-					else if(ActVote < 0)
-						No++;
-				}
-			}
+				CountVotes(&Total, &Yes, &No);
 
 			if(m_VoteEnforce == VOTE_ENFORCE_YES || (m_VoteUpdate && Yes >= Total/2+1))
 			{
@@ -724,7 +751,10 @@ void CGameContext::OnTick()
 	}
 
 	//*dummy handle system
-	HandleDummySystem();
+	{
+		CProfileScope ProfileDummies(Server()->TickProfiler(), m_aProfilePhases[PROFILE_DUMMIES]);
+		HandleDummySystem();
+	}
 
 	// dont allow sv_register 1 if the version is private
 	if (IS_PRIVATE_VERSION)
@@ -746,6 +776,65 @@ void CGameContext::OnTick()
 #endif
 }
 
+void CGameContext::CountVotes(int *pTotal, int *pYes, int *pNo)
+{
+	// one vote per ip: the first counted player of an ip opens a group, later
+	// players of the same ip only contribute their vote if it was cast earlier
+	enum
+	{
+		GROUP_HASH_SIZE=MAX_CLIENTS*2,
+	};
+	struct CVoteGroup
+	{
+		int64 m_AddrKey;
+		int m_Vote;
+		int m_VotePos;
+	};
+	CVoteGroup aGroups[MAX_CLIENTS];
+	int aGroupHash[GROUP_HASH_SIZE] = {0}; // group index+1, 0 marks a free slot
+	int NumGroups = 0;
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_apPlayers[i])
+			continue;
+
+		int64 Key = Server()->ClientAddrKey(i);
+		unsigned Slot = (unsigned)(Key^(Key>>32))&(GROUP_HASH_SIZE-1);
+		while(aGroupHash[Slot] && aGroups[aGroupHash[Slot]-1].m_AddrKey != Key)
+			Slot = (Slot+1)&(GROUP_HASH_SIZE-1);
+
+		if(aGroupHash[Slot])
+		{
+			CVoteGroup *pGroup = &aGroups[aGroupHash[Slot]-1];
+			if(m_apPlayers[i]->m_Vote && (!pGroup->m_Vote || pGroup->m_VotePos > m_apPlayers[i]->m_VotePos))
+			{
+				pGroup->m_Vote = m_apPlayers[i]->m_Vote;
+				pGroup->m_VotePos = m_apPlayers[i]->m_VotePos;
+			}
+		}
+		else if(m_apPlayers[i]->GetTeam() != TEAM_SPECTATORS && !m_apPlayers[i]->IsDummy())	// don't count in votes by spectators
+		{
+			CVoteGroup *pGroup = &aGroups[NumGroups++];
+			pGroup->m_AddrKey = Key;
+			pGroup->m_Vote = m_apPlayers[i]->m_Vote;
+			pGroup->m_VotePos = m_apPlayers[i]->m_VotePos;
+			aGroupHash[Slot] = NumGroups;
+		}
+	}
+
+	*pTotal = NumGroups;
+	*pYes = 0;
+	*pNo = 0;
+	for(int i = 0; i < NumGroups; i++)
+	{
+		if(aGroups[i].m_Vote > 0)
+			(*pYes)++;
+		else if(aGroups[i].m_Vote < 0)
+			(*pNo)++;
+	}
+}
+
 void CGameContext::HandleDummySystem()
 {
 	// *dummy system
@@ -1076,6 +1165,35 @@ void CGameContext::OnClientPredictedInput(int ClientID, void *pInput)
 	}
 }
 
+void CGameContext::OnBenchmarkClient(int ClientID, int Tick, void *pInput)
+{
+	CPlayer *pPlayer = m_apPlayers[ClientID];
+	if(!pPlayer)
+		return;
+
+	// join like a player would, with a fresh account as the stats of the last run would change the outcome
+	if(!pPlayer->m_Player_logged && Tick%Server()->TickSpeed() == 0)
+	{
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%s/bench%d.ini", m_pAccountsFolder, ClientID);
+		fs_remove(aBuf);
+		str_format(aBuf, sizeof(aBuf), "register bench%d bench", ClientID);
+		m_ChatCommands.Execute(ClientID, aBuf, CChatCommands::ACCESS_PLAYER, Tick);
+	}
+
+	// run back and forth, jump, hook, aim in circles, shoot and cycle through the weapons
+	CNetObj_PlayerInput *pIn = (CNetObj_PlayerInput *)pInput;
+	int Time = Tick + ClientID*37;
+	float Angle = Time*0.05f;
+	pIn->m_Direction = (Time/Server()->TickSpeed())%3 - 1;
+	pIn->m_TargetX = (int)(cosf(Angle)*100.0f);
+	pIn->m_TargetY = (int)(sinf(Angle)*100.0f);
+	pIn->m_Jump = (Time%40) < 5;
+	pIn->m_Hook = (Time%100) < 30;
+	pIn->m_Fire = Time/4;
+	pIn->m_WantedWeapon = 1 + (Time/(Server()->TickSpeed()*5))%(NUM_WEAPONS-1);
+}
+
 void CGameContext::OnClientEnter(int ClientID)
 {
 	m_pController->OnPlayerConnect(m_apPlayers[ClientID]);
@@ -1123,6 +1241,7 @@ void CGameContext::OnClientEnter(int ClientID)
 		NewClientInfoMsg.m_aSkinPartColors[p] = m_apPlayers[ClientID]->m_TeeInfos.m_aSkinPartColors[p];
 	}
 
+	int64 OthersMask = 0;
 	for (int i = 0; i < MAX_CLIENTS; ++i)
 	{
 		if (i == ClientID || !m_apPlayers[i] || (!Server()->ClientIngame(i) && !m_apPlayers[i]->IsDummy()))
@@ -1130,7 +1249,7 @@ void CGameContext::OnClientEnter(int ClientID)
 
 		// new info for others
 		if (Server()->ClientIngame(i))
-			Server()->SendPackMsg(&NewClientInfoMsg, MSGFLAG_VITAL | MSGFLAG_NORECORD, i);
+			OthersMask |= CmaskOne(i);
 
 		// existing infos for new player
 		CNetMsg_Sv_ClientInfo ClientInfoMsg;
@@ -1160,6 +1279,8 @@ void CGameContext::OnClientEnter(int ClientID)
 
 		Server()->SendPackMsg(&ClientInfoMsg, MSGFLAG_VITAL|MSGFLAG_NORECORD, ClientID);
 	}
+	if (OthersMask)
+		Server()->SendPackMsgMask(&NewClientInfoMsg, MSGFLAG_VITAL | MSGFLAG_NORECORD, OthersMask);
 
 	// local info
 	NewClientInfoMsg.m_Local = 1;
@@ -1207,6 +1328,8 @@ void CGameContext::OnClientTeamChange(int ClientID)
 
 void CGameContext::OnClientDrop(int ClientID, const char *pReason)
 {
+	m_ChatCommands.ClearClient(ClientID);
+
 	if (!m_apPlayers[ClientID])
 		return;
 
@@ -1306,241 +1429,12 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 			// process chat input
 			if (pMsg->m_pMessage[0] == '/')
 			{
-				int cnt = 0;
-
-				char aComString[MAX_INPUT_SIZE] = { 0 };//contains command string
-				char aComPart[4][MAX_INPUT_SIZE] = { 0 };//contains up to three commands
-				char aMsgPart[MAX_INPUT_SIZE] = { 0 };// message part
-				char *pChar;
-				char aTextBuf[MAX_INPUT_SIZE] = { 0 };
-				char aWeaponName[7][MAX_INPUT_SIZE] = { "hammer", "gun", "shotgun", "grenade", "rifle", "life", "handle" };
-
-				str_copy(aComString, pMsg->m_pMessage, sizeof(aComString));//copy message to buffer
-				memmove(aComString, aComString + 1, sizeof(aComString));//remove first character from buffer
-
-				//tokenize command string
-				pChar = strtok(aComString, " ");
-
-				while (pChar != NULL)
-				{
-					str_copy(aComPart[cnt], pChar, sizeof(aComPart[0]));
-					pChar = strtok(NULL, " ");
-					cnt++;
-
-					if (cnt == 4)
-						break;
-				}
-
-				// for message commands we need the whole rest of the string
-				cnt = 0;
-				cnt = strlen(aComPart[0]) + 2;
-				while (1) {
-					str_format(aMsgPart, sizeof(aMsgPart), "%s%c", aMsgPart, pMsg->m_pMessage[cnt]);
-					if (pMsg->m_pMessage[cnt] == '\0')
-						break;
-					cnt++;
-				}
-				//evaluate commands
-				if (str_comp_nocase(aComPart[0], "info") == 0)//server info
-				{
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, m_aSepLine);
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "*** Levels, Upgrades & Mayhem ~ By Nolay ***");
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, m_aSepLine);// TODO - add donations
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Contact: Nolay.LUM@gmail.com");
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Discord: discord.gg/ju4z5Kj");
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Mod details: Teeworlds forum --> Search --> \"LUM\"");
-					//					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Donations are welcome!");
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, m_aSepLine);
-				}
-				else if (str_comp_nocase(aComPart[0], "rules") == 0)// server rules
-				{
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, m_aSepLine);
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "No bad language, show us your good manners");
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "No cheating, be a sportsmanlike player");
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "No afk / farming, show us some action");
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, m_aSepLine);
-				}
-				else if (str_comp_nocase(aComPart[0], "topten") == 0)// show top ten players
-				{
-					ShowTopTen(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "help") == 0)//help commands
-				{
-					if (str_comp_nocase(aComPart[1], "game") == 0)//help game
-					{
-						ShowGameHelp(ClientID);
-					}
-					else if (str_comp_nocase(aComPart[1], "account") == 0)//help account
-					{
-						ShowAccountHelp(ClientID);
-					}
-					else if (str_comp_nocase(aComPart[1], "moderator") == 0)//help moderator
-					{
-						if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-						{
-							ShowModeratorHelp(ClientID);
-						}
-						else
-						{
-							ShowDefaultHelp(ClientID);
-						}
-					}
-					else if (str_comp_nocase(aComPart[1], "emote") == 0)//help emote
-					{
-						ShowEmoteHelp(ClientID);
-					}
-					else//help server
-					{
-						ShowServerHelp(ClientID);
-					}
-				}
-				else if (str_comp_nocase(aComPart[0], "upgr") == 0)//upgrade command
-				{
-					UpgradeStats(ClientID, aComPart[1], aComPart[2]);
-				}
-				else if (str_comp_nocase(aComPart[0], "stats") == 0)//list stats
-				{
-					ShowStats(ClientID, aComPart[1]);
-				}
-				else if (str_comp_nocase(aComPart[0], "switchmode") == 0)//switch weapon mode
-				{
-					ToggleSwitchMode(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "showexp") == 0)//showexp
-				{
-					ToggleShowExp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "register") == 0)//register account
-				{
-					AccountRegister(ClientID, aComPart[1], aComPart[2]);
-				}
-				else if (str_comp_nocase(aComPart[0], "login") == 0)//login account
-				{
-					AccountLogIn(ClientID, aComPart[1], aComPart[2]);
-				}
-				else if (str_comp_nocase(aComPart[0], "logout") == 0)//login account
-				{
-					AccountLogOut(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "newpassword") == 0)//change password
-				{
-					AccountChangePassword(ClientID, aComPart[1], aComPart[2], aComPart[3]);
-				}
-				else if (str_comp_nocase(aComPart[0], "ticket") == 0)//send a ticket to the creator
-				{
-					SubmitTicket(ClientID, aMsgPart);
-				}
-				else if (str_comp_nocase(aComPart[0], "redeem") == 0)//redeem a code
-				{
-					RedeemCode(ClientID, aComPart[1]);
-				}
-				else if (str_comp_nocase(aComPart[0], "angry") == 0)//emote angry
-				{
-					SetTeeEmote(ClientID, EMOTE_ANGRY);
-				}
-				else if (str_comp_nocase(aComPart[0], "happy") == 0)//emote happy
-				{
-					SetTeeEmote(ClientID, EMOTE_HAPPY);
-				}
-				else if (str_comp_nocase(aComPart[0], "default") == 0)//emote default
-				{
-					SetTeeEmote(ClientID, EMOTE_NORMAL);
-				}
-				else if (str_comp_nocase(aComPart[0], "pain") == 0)//emote pain
-				{
-					SetTeeEmote(ClientID, EMOTE_PAIN);
-				}
-				else if (str_comp_nocase(aComPart[0], "blink") == 0)//emote blink
-				{
-					SetTeeEmote(ClientID, EMOTE_BLINK);
-				}
-				else if (str_comp_nocase(aComPart[0], "surprise") == 0)//emote surprise
-				{
-					SetTeeEmote(ClientID, EMOTE_SURPRISE);
-				}
-				else if (str_comp_nocase(aComPart[0], "notify") == 0)//moderator send notification
-				{
-					if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-					{//******************************************************
-						SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, "######################################");
-						SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, "*");
-						SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, aMsgPart);
-						SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, "*");
-						SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, "######################################");
-					}
-					else
-						ShowDefaultHelp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "undercover") == 0)//moderator undercover
-				{
-					if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-						ToggleUndercover(ClientID);
-					else
-						ShowDefaultHelp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "freeze") == 0)//moderator freeze player
-				{
-					if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-						FreezePlayer(aComPart[1], ClientID, 0);
-					else
-						ShowDefaultHelp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "unfreeze") == 0)//moderator unfreeze player
-				{
-					if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-						FreezePlayer(aComPart[1], ClientID, 1);
-					else
-						ShowDefaultHelp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "idlist") == 0)//moderator idlist
-				{
-					if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-						ShowIdList(ClientID);
-					else
-						ShowDefaultHelp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "showstats") == 0)//moderator showstats
-				{
-					if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-						ShowPlayerStats(atoi(aComPart[1]), ClientID);
-					else
-						ShowDefaultHelp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "kick") == 0)// moderator kick player
-				{
-					if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-					{
-						TreatPlayer(aComPart[1], ClientID, 0, atoi(aComPart[2]));
-					}
-					else
-						ShowDefaultHelp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "ban") == 0)// moderator kick player
-				{
-					if (m_apPlayers[ClientID]->m_Player_status == 2 || m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
-					{
-						TreatPlayer(aComPart[1], ClientID, 1, atoi(aComPart[2]));
-					}
-					else
-						ShowDefaultHelp(ClientID);
-				}
-				else if (str_comp_nocase(aComPart[0], "hesoyam") == 0)// GTA san andreas easter egg ^^
-				{
-					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "This is not GTA");
-
-					// log in modlog
-					WriteModLog("%s has found the GTA easter egg", Server()->ClientName(ClientID));
-				}
-				/*else if (str_comp(aComPart[0], "CowBelliesAreFluffy") == 0)// Crash the server with a secret command that only the developer knows
-				{
-					// log in modlog
-					WriteModLog("%s has crashed the server... DELIBERATELY. Not so smart now are ya? (I could do this all day)", Server()->ClientName(ClientID));
-					exit(0);
-				}*/
-				else//type command that does not exist show help general
-				{
+				int AccessLevel = (pPlayer->m_Player_status == 2 || pPlayer->m_Player_status == 3) ? CChatCommands::ACCESS_MODERATOR : CChatCommands::ACCESS_PLAYER; // if moderator or admin
+				int Result = m_ChatCommands.Execute(ClientID, pMsg->m_pMessage+1, AccessLevel, Server()->Tick());
+				if (Result == CChatCommands::EXEC_COOLDOWN)
+					SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Please wait a moment before using this command again");
+				else if (Result != CChatCommands::EXEC_DONE)//type command that does not exist show help general
 					ShowDefaultHelp(ClientID);
-				}
 			}
 			else
 			{
@@ -1846,123 +1740,145 @@ void CGameContext::OnMessage(int MsgID, CUnpacker *pUnpacker, int ClientID)
 	}
 }
 
-int CGameContext::TuneModSettings(char *Filepath)
+int CGameContext::TuneModSettings(const char *pFilepath)
 {
-	FILE *fpointer;
+	enum
+	{
+		SETTING_INT=0,
+		SETTING_FLOAT,
+	};
 
-	int cnt = 0;
-	char ch = 0;
-	char aLineBuf[256] = { 0 };
-	char aSaveString[MAX_LINES_MODSETTINGS][256] = { 0 };// save all file lines
-	char* pChar;// token pointer
-	char aStrPart[2][128] = { 0 };// tokenized file lines
+	struct CModSetting
+	{
+		const char *m_pName;
+		int m_Type;
+		int CGameContext::*m_pInt;
+		float CGameContext::*m_pFloat;
+		float m_Min;
+		float m_Max;
+	};
 
-	if (GetFileExists(Filepath) == false)
-		return false;
+	static const CModSetting s_aSettings[] =
+	{
+		#define MACRO_MODSETTING_INT(Name,Member,Min,Max) { #Name, SETTING_INT, &CGameContext::Member, 0, Min, Max },
+		#define MACRO_MODSETTING_FLOAT(Name,Member,Min,Max) { #Name, SETTING_FLOAT, 0, &CGameContext::Member, Min, Max },
 
-	fpointer = fopen(Filepath, "r");
+		#include "modsettings.h"
 
-	while (1)
-	{
-		ch = fgetc(fpointer);
+		#undef MACRO_MODSETTING_INT
+		#undef MACRO_MODSETTING_FLOAT
+	};
 
-		if (ch == EOF)
-			break;
+	enum
+	{
+		NUM_SETTINGS=sizeof(s_aSettings)/sizeof(s_aSettings[0]),
+	};
 
-		if (ch == '\n')
-		{
-			cnt++;
-		}
-		else
+	// the members start out at their defaults, keep them for settings that get removed from the file
+	static int s_aIntDefaults[NUM_SETTINGS];
+	static float s_aFloatDefaults[NUM_SETTINGS];
+	static bool s_DefaultsSaved = false;
+	if(!s_DefaultsSaved)
+	{
+		for(int i = 0; i < NUM_SETTINGS; i++)
 		{
-			snprintf(aSaveString[cnt], sizeof(aSaveString[0]), "%s%c", aSaveString[cnt], ch);
+			if(s_aSettings[i].m_Type == SETTING_INT)
+				s_aIntDefaults[i] = this->*s_aSettings[i].m_pInt;
+			else
+				s_aFloatDefaults[i] = this->*s_aSettings[i].m_pFloat;
 		}
+		s_DefaultsSaved = true;
 	}
 
-	fclose(fpointer);
+	IOHANDLE File = io_open(pFilepath, IOFLAG_READ);
+	if(!File)
+		return false;
 
-	// eval commands
-	for (int i = 0; i < MAX_LINES_MODSETTINGS; i++)
+	long int FileSize = io_length(File);
+	if(FileSize < 0)
 	{
-		// skip lines who begin as comments and empty ones
-		if (aSaveString[i][0] == '/' || aSaveString[i][0] == 0)
+		io_close(File);
+		return false;
+	}
+	char *pFileData = (char *)mem_alloc(FileSize+1, 1);
+	FileSize = io_read(File, pFileData, FileSize);
+	pFileData[FileSize] = 0;
+	io_close(File);
+
+	// parse everything first and apply it in one go, so a half edited file never leaves mixed values
+	int aIntValues[NUM_SETTINGS];
+	float aFloatValues[NUM_SETTINGS];
+	bool aParsed[NUM_SETTINGS] = { false };
+
+	int LineNum = 0;
+	char *pLine = pFileData;
+	while(pLine)
+	{
+		char *pNextLine = pLine;
+		while(*pNextLine && *pNextLine != '\n')
+			pNextLine++;
+		if(*pNextLine)
+			*pNextLine++ = 0;
+		else
+			pNextLine = 0;
+		LineNum++;
+
+		// "name value", everything after the value is a comment
+		char *pName = str_skip_whitespaces(pLine);
+		pLine = pNextLine;
+		if(pName[0] == 0 || pName[0] == '/' || pName[0] == '#')
 			continue;
 
-		// tokenize string
-		pChar = strtok(aSaveString[i], " ");
+		char *pValue = str_skip_to_whitespace(pName);
+		if(*pValue)
+			*pValue++ = 0;
+		pValue = str_skip_whitespaces(pValue);
+		*str_skip_to_whitespace(pValue) = 0;
 
-		cnt = 0;
-		while (pChar != NULL)
+		int Index = 0;
+		while(Index < NUM_SETTINGS && str_comp_nocase(s_aSettings[Index].m_pName, pName) != 0)
+			Index++;
+		if(Index == NUM_SETTINGS)
 		{
-			str_copy(aStrPart[cnt], pChar, sizeof(aStrPart[0]));
-			pChar = strtok(NULL, " ");
-			cnt++;
+			dbg_msg("modsettings", "line %d: unknown setting '%s'", LineNum, pName);
+			continue;
+		}
+		if(pValue[0] == 0)
+		{
+			dbg_msg("modsettings", "line %d: missing value for '%s'", LineNum, pName);
+			continue;
+		}
 
-			// so you can put comments after the lines
-			if (cnt == 2)
-				break;
+		const CModSetting *pSetting = &s_aSettings[Index];
+		float Value = pSetting->m_Type == SETTING_INT ? (float)str_toint(pValue) : str_tofloat(pValue);
+		if(Value < pSetting->m_Min || Value > pSetting->m_Max)
+		{
+			dbg_msg("modsettings", "line %d: '%s' out of range, clamped to %g..%g", LineNum, pName, pSetting->m_Min, pSetting->m_Max);
+			Value = clamp(Value, pSetting->m_Min, pSetting->m_Max);
 		}
 
-		printf("[%s]: Line %02d: %s %s\n", __func__, i, aStrPart[0], aStrPart[1]);
-
-		// write new values
-		if (str_comp_nocase(aStrPart[0], "sv_req_hammer_auto") == 0)
-			m_Req_hammer_auto = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_req_hammer_fly") == 0)
-			m_Req_hammer_fly = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_req_gun_auto") == 0)
-			m_Req_gun_auto = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_req_gun_spread") == 0)
-			m_Req_gun_spread = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_req_grenade_bounce") == 0)
-			m_Req_grenade_bounce = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_req_grenade_bounce2") == 0)
-			m_Req_grenade_bounce2 = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_req_rifle_exp") == 0)
-			m_Req_rifle_dual = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_req_rifle_range") == 0)
-			m_Req_rifle_range = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_req_rifle_spread") == 0)
-			m_Req_rifle_triple = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_shotgun_spreadbase") == 0)
-			twep_shotgun_spreadbase = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_shotgun_speeddiff") == 0)
-			twep_shotgun_speeddiff = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_shotgun_rangegain") == 0)
-			twep_shotgun_rangegain = atof(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_health_per_point") == 0)
-			m_Per_health_max = atof(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_armor_per_point") == 0)
-			m_Per_armor_max = atof(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_damage_ratio") == 0)
-			m_DamageScaling = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_level_min") == 0)
-			m_MinAllowedLevel = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_level_max") == 0)
-			m_MaxAllowedLevel = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_spawnprotection") == 0)
-			m_SpawnProtectionBase = atof(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_reward_ammo") == 0)
-			m_AmmoReward = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_reward_streak") == 0)
-			m_BonusPerStreak = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_reward_leveldiff") == 0)
-			m_BonusPer100 = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_kills_for_streak") == 0)
-			m_StepKillstreak = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_mine_lifetime") == 0)
-			m_MineLifeTime = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_mine_radius") == 0)
-			m_MineRadius = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_droplife_ratio") == 0)
-			m_DropLifeRewardRatio = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_droplife_lifetime") == 0)
-			m_DropLifeLifeTime = atoi(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_droplife_gravity") == 0)
-			m_DropLifeGravity = atof(aStrPart[1]);
-		else if (str_comp_nocase(aStrPart[0], "sv_droplife_bounce") == 0)
-			m_DropLifeBounceForce = atoi(aStrPart[1]);
+		if(pSetting->m_Type == SETTING_INT)
+			aIntValues[Index] = (int)Value;
+		else
+			aFloatValues[Index] = Value;
+		aParsed[Index] = true;
+	}
+
+	mem_free(pFileData);
+
+	// settings missing in the file go back to their defaults
+	int NumApplied = 0;
+	for(int i = 0; i < NUM_SETTINGS; i++)
+	{
+		if(s_aSettings[i].m_Type == SETTING_INT)
+			this->*s_aSettings[i].m_pInt = aParsed[i] ? aIntValues[i] : s_aIntDefaults[i];
+		else
+			this->*s_aSettings[i].m_pFloat = aParsed[i] ? aFloatValues[i] : s_aFloatDefaults[i];
+		if(aParsed[i])
+			NumApplied++;
 	}
+	m_WeaponProfileGeneration++;
+	dbg_msg("modsettings", "applied %d settings from '%s', %d at default", NumApplied, pFilepath, NUM_SETTINGS-NumApplied);
 
 	return true;
 }
@@ -2200,6 +2116,7 @@ bool CGameContext::GetFromFile(int Position, char *Buffer, unsigned int Size, ch
 	FILE *fpointer;
 
 	int counter = 0;
+	int length = 0;
 	char ch = 0;
 
 	char aLineBuf[256] = { 0 };
@@ -2222,9 +2139,10 @@ bool CGameContext::GetFromFile(int Position, char *Buffer, unsigned int Size, ch
 		}
 		else
 		{
-			if (counter == Position)
+			// append in place, formatting the buffer into itself is undefined and yields only the last character with glibc
+			if (counter == Position && length < (int)sizeof(aLineBuf) - 1)
 			{
-				str_format(aLineBuf, sizeof(aLineBuf), "%s%c", aLineBuf, ch);
+				aLineBuf[length++] = ch;
 			}
 		}
 
@@ -2241,6 +2159,8 @@ bool CGameContext::GetFromFile(int Position, char *Buffer, unsigned int Size, ch
 
 void CGameContext::AccountRegister(int ClientID, char *Username, char *Password)
 {
+	CProfileScope ProfileAccounts(Server()->TickProfiler(), m_aProfilePhases[PROFILE_ACCOUNTS]);
+
 	if (m_apPlayers[ClientID]->m_Player_logged == false)
 	{
 		FILE* fpointer;
@@ -2255,7 +2175,7 @@ void CGameContext::AccountRegister(int ClientID, char *Username, char *Password)
 			return;
 		}
 
-		str_format(aFilePathComplete, sizeof(aFilePathComplete), "%s/%s.ini", FOLDERPATH_ACCOUNTS, Username);
+		str_format(aFilePathComplete, sizeof(aFilePathComplete), "%s/%s.ini", m_pAccountsFolder, Username);
 
 		//check empty
 		if (Username[0] != 0 && Password[0] != 0)
@@ -2398,6 +2318,8 @@ bool CGameContext::CheckRedeemFormat(char *Text, int Length, int ClientID)
 
 void CGameContext::AccountLogIn(int ClientID, char *Username, char *Password)
 {
+	CProfileScope ProfileAccounts(Server()->TickProfiler(), m_aProfilePhases[PROFILE_ACCOUNTS]);
+
 	FILE* fpointer;
 
 	bool AccIsLogged = false;//account logged in
@@ -2409,7 +2331,7 @@ void CGameContext::AccountLogIn(int ClientID, char *Username, char *Password)
 	char aFilePathComplete[256] = { 0 };//full filepath
 	char aNameTrans[256] = { 0 };//name with level indicator
 
-	str_format(aFilePathComplete, sizeof(aFilePathComplete), "%s/%s.ini", FOLDERPATH_ACCOUNTS, Username);
+	str_format(aFilePathComplete, sizeof(aFilePathComplete), "%s/%s.ini", m_pAccountsFolder, Username);
 
 	if (m_apPlayers[ClientID]->m_Player_logged == false)
 	{
@@ -2620,7 +2542,7 @@ void CGameContext::AccountChangePassword(int ClientID, char *Password, char *New
 
 	if (m_apPlayers[ClientID]->m_Player_logged == true)
 	{
-		str_format(aFilePathComplete, sizeof(aFilePathComplete), "%s/%s.ini", FOLDERPATH_ACCOUNTS, m_apPlayers[ClientID]->m_Player_username);
+		str_format(aFilePathComplete, sizeof(aFilePathComplete), "%s/%s.ini", m_pAccountsFolder, m_apPlayers[ClientID]->m_Player_username);
 
 		GetFromFile(ACC_PASSWORD, aRetBuf, sizeof(aRetBuf), aFilePathComplete);
 
@@ -2670,6 +2592,8 @@ void CGameContext::AccountChangePassword(int ClientID, char *Password, char *New
 
 void CGameContext::AccountUpdate(int ClientID)
 {
+	CProfileScope ProfileAccounts(Server()->TickProfiler(), m_aProfilePhases[PROFILE_ACCOUNTS]);
+
 	if (m_apPlayers[ClientID]->IsDummy())
 		return;
 
@@ -2703,7 +2627,7 @@ void CGameContext::AccountUpdate(int ClientID)
 	for (int i = 0; i < strlen(m_apPlayers[ClientID]->m_Player_password); ++i)
 		encStr[i] = m_apPlayers[ClientID]->m_Player_password[i] + m_EncryptLetterShift;
 
-	str_format(aFilePathComplete, sizeof(aFilePathComplete), "%s/%s.ini", FOLDERPATH_ACCOUNTS, m_apPlayers[ClientID]->m_Player_username);
+	str_format(aFilePathComplete, sizeof(aFilePathComplete), "%s/%s.ini", m_pAccountsFolder, m_apPlayers[ClientID]->m_Player_username);
 
 	fpointer = fopen(aFilePathComplete, "w");
 	//username
@@ -2926,7 +2850,7 @@ void CGameContext::ResetAccount(int ClientID)
 	ServerMessage(ClientID, "Your account has been reset!");
 }
 
-void CGameContext::SubmitTicket(int ClientID, char *Message)
+void CGameContext::SubmitTicket(int ClientID, const char *Message)
 {
 	FILE* fpointer;
 	va_list argList;
@@ -3842,20 +3766,18 @@ void CGameContext::WriteModLog(char *format, ...)
 	va_list argList;
 	char buffer[256] = { 0 };
 
-	fpointer = fopen(FILEPATH_MODLOG, "a");
-
+	// format only once, the argument list can't be used a second time
 	va_start(argList, format);
-
-	fprintf(fpointer, "\n");
-
-	vfprintf(fpointer, format, argList);
-
-	fclose(fpointer);
-
-	vsprintf(buffer, format, argList);// write arguments to buffer for chat log
-
+	vsnprintf(buffer, sizeof(buffer), format, argList);
 	va_end(argList);
 
+	fpointer = fopen(FILEPATH_MODLOG, "a");
+	if (fpointer)
+	{
+		fprintf(fpointer, "\n%s", buffer);
+		fclose(fpointer);
+	}
+
 	// also write mod log line to chat log
 	WriteChatLog(buffer);
 }
@@ -4694,6 +4616,261 @@ void CGameContext::ConchainGameinfoUpdate(IConsole::IResult *pResult, void *pUse
 	}
 }
 
+void CGameContext::ChatInfo(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, pSelf->m_aSepLine);
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "*** Levels, Upgrades & Mayhem ~ By Nolay ***");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, pSelf->m_aSepLine);// TODO - add donations
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Contact: Nolay.LUM@gmail.com");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Discord: discord.gg/ju4z5Kj");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Mod details: Teeworlds forum --> Search --> \"LUM\"");
+	//	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "Donations are welcome!");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, pSelf->m_aSepLine);
+}
+
+void CGameContext::ChatRules(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, pSelf->m_aSepLine);
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "No bad language, show us your good manners");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "No cheating, be a sportsmanlike player");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, "No afk / farming, show us some action");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, ClientID, pSelf->m_aSepLine);
+}
+
+void CGameContext::ChatTopTen(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->ShowTopTen(pResult->m_ClientID);
+}
+
+void CGameContext::ChatHelp(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+	const char *pTopic = pResult->GetString(0);
+
+	if (str_comp_nocase(pTopic, "game") == 0)//help game
+		pSelf->ShowGameHelp(ClientID);
+	else if (str_comp_nocase(pTopic, "account") == 0)//help account
+		pSelf->ShowAccountHelp(ClientID);
+	else if (str_comp_nocase(pTopic, "moderator") == 0)//help moderator
+	{
+		if (pSelf->m_apPlayers[ClientID]->m_Player_status == 2 || pSelf->m_apPlayers[ClientID]->m_Player_status == 3) // if moderator or admin
+			pSelf->ShowModeratorHelp(ClientID);
+		else
+			pSelf->ShowDefaultHelp(ClientID);
+	}
+	else if (str_comp_nocase(pTopic, "emote") == 0)//help emote
+		pSelf->ShowEmoteHelp(ClientID);
+	else//help server
+		pSelf->ShowServerHelp(ClientID);
+}
+
+void CGameContext::ChatUpgrade(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->UpgradeStats(pResult->m_ClientID, pResult->GetString(0), pResult->GetString(1));
+}
+
+void CGameContext::ChatStats(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->ShowStats(pResult->m_ClientID, pResult->GetString(0));
+}
+
+void CGameContext::ChatSwitchMode(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->ToggleSwitchMode(pResult->m_ClientID);
+}
+
+void CGameContext::ChatShowExp(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->ToggleShowExp(pResult->m_ClientID);
+}
+
+void CGameContext::ChatRegister(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->AccountRegister(pResult->m_ClientID, pResult->GetString(0), pResult->GetString(1));
+}
+
+void CGameContext::ChatLogin(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->AccountLogIn(pResult->m_ClientID, pResult->GetString(0), pResult->GetString(1));
+}
+
+void CGameContext::ChatLogout(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->AccountLogOut(pResult->m_ClientID);
+}
+
+void CGameContext::ChatNewPassword(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->AccountChangePassword(pResult->m_ClientID, pResult->GetString(0), pResult->GetString(1), pResult->GetString(2));
+}
+
+void CGameContext::ChatTicket(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->SubmitTicket(pResult->m_ClientID, pResult->GetRest(0));
+}
+
+void CGameContext::ChatRedeem(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->RedeemCode(pResult->m_ClientID, pResult->GetString(0));
+}
+
+void CGameContext::ChatAngry(CChatCommands::CResult *pResult, void *pUserData)
+{
+	((CGameContext *)pUserData)->SetTeeEmote(pResult->m_ClientID, EMOTE_ANGRY);
+}
+
+void CGameContext::ChatHappy(CChatCommands::CResult *pResult, void *pUserData)
+{
+	((CGameContext *)pUserData)->SetTeeEmote(pResult->m_ClientID, EMOTE_HAPPY);
+}
+
+void CGameContext::ChatDefault(CChatCommands::CResult *pResult, void *pUserData)
+{
+	((CGameContext *)pUserData)->SetTeeEmote(pResult->m_ClientID, EMOTE_NORMAL);
+}
+
+void CGameContext::ChatPain(CChatCommands::CResult *pResult, void *pUserData)
+{
+	((CGameContext *)pUserData)->SetTeeEmote(pResult->m_ClientID, EMOTE_PAIN);
+}
+
+void CGameContext::ChatBlink(CChatCommands::CResult *pResult, void *pUserData)
+{
+	((CGameContext *)pUserData)->SetTeeEmote(pResult->m_ClientID, EMOTE_BLINK);
+}
+
+void CGameContext::ChatSurprise(CChatCommands::CResult *pResult, void *pUserData)
+{
+	((CGameContext *)pUserData)->SetTeeEmote(pResult->m_ClientID, EMOTE_SURPRISE);
+}
+
+void CGameContext::ChatNotify(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	int ClientID = pResult->m_ClientID;
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, "######################################");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, "*");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, pResult->GetRest(0));
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, "*");
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_ALL, ClientID, "######################################");
+}
+
+void CGameContext::ChatUndercover(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->ToggleUndercover(pResult->m_ClientID);
+}
+
+void CGameContext::ChatFreeze(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->FreezePlayer(pResult->GetString(0), pResult->m_ClientID, 0);
+}
+
+void CGameContext::ChatUnfreeze(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->FreezePlayer(pResult->GetString(0), pResult->m_ClientID, 1);
+}
+
+void CGameContext::ChatIdList(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->ShowIdList(pResult->m_ClientID);
+}
+
+void CGameContext::ChatShowStats(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->ShowPlayerStats(pResult->GetInteger(0), pResult->m_ClientID);
+}
+
+void CGameContext::ChatKick(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->TreatPlayer(pResult->GetString(0), pResult->m_ClientID, 0, pResult->GetInteger(1));
+}
+
+void CGameContext::ChatBan(CChatCommands::CResult *pResult, void *pUserData)
+{
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->TreatPlayer(pResult->GetString(0), pResult->m_ClientID, 1, pResult->GetInteger(1));
+}
+
+void CGameContext::ChatHesoyam(CChatCommands::CResult *pResult, void *pUserData)
+{
+	// GTA san andreas easter egg ^^
+	CGameContext *pSelf = (CGameContext *)pUserData;
+	pSelf->SendChat(TEAM_SPECTATORS, CHAT_NONE, pResult->m_ClientID, "This is not GTA");
+
+	// log in modlog
+	pSelf->WriteModLog("%s has found the GTA easter egg", pSelf->Server()->ClientName(pResult->m_ClientID));
+}
+
+void CGameContext::RegisterProfilePhases()
+{
+	static const char *s_apNames[NUM_PROFILE_PHASES] = { "controller", "players", "account_io", "events", "votes", "dummies" };
+	for(int i = 0; i < NUM_PROFILE_PHASES; i++)
+		m_aProfilePhases[i] = Server()->TickProfiler()->RegisterPhase(s_apNames[i]);
+}
+
+void CGameContext::RegisterChatCommands()
+{
+	// account commands hit the disk, throttle them against brute forcing
+	int AccountCooldown = Server()->TickSpeed();
+
+	m_ChatCommands.Register("info", CChatCommands::ACCESS_PLAYER, 0, ChatInfo, this);
+	m_ChatCommands.Register("rules", CChatCommands::ACCESS_PLAYER, 0, ChatRules, this);
+	m_ChatCommands.Register("topten", CChatCommands::ACCESS_PLAYER, 0, ChatTopTen, this);
+	m_ChatCommands.Register("help", CChatCommands::ACCESS_PLAYER, 0, ChatHelp, this);
+	m_ChatCommands.Register("upgr", CChatCommands::ACCESS_PLAYER, 0, ChatUpgrade, this);
+	m_ChatCommands.Register("stats", CChatCommands::ACCESS_PLAYER, 0, ChatStats, this);
+	m_ChatCommands.Register("switchmode", CChatCommands::ACCESS_PLAYER, 0, ChatSwitchMode, this);
+	m_ChatCommands.Register("showexp", CChatCommands::ACCESS_PLAYER, 0, ChatShowExp, this);
+	m_ChatCommands.Register("register", CChatCommands::ACCESS_PLAYER, AccountCooldown, ChatRegister, this);
+	m_ChatCommands.Register("login", CChatCommands::ACCESS_PLAYER, AccountCooldown, ChatLogin, this);
+	m_ChatCommands.Register("logout", CChatCommands::ACCESS_PLAYER, 0, ChatLogout, this);
+	m_ChatCommands.Register("newpassword", CChatCommands::ACCESS_PLAYER, AccountCooldown, ChatNewPassword, this);
+	m_ChatCommands.Register("ticket", CChatCommands::ACCESS_PLAYER, 0, ChatTicket, this);
+	m_ChatCommands.Register("redeem", CChatCommands::ACCESS_PLAYER, AccountCooldown, ChatRedeem, this);
+
+	// emotes
+	m_ChatCommands.Register("angry", CChatCommands::ACCESS_PLAYER, 0, ChatAngry, this);
+	m_ChatCommands.Register("happy", CChatCommands::ACCESS_PLAYER, 0, ChatHappy, this);
+	m_ChatCommands.Register("default", CChatCommands::ACCESS_PLAYER, 0, ChatDefault, this);
+	m_ChatCommands.Register("pain", CChatCommands::ACCESS_PLAYER, 0, ChatPain, this);
+	m_ChatCommands.Register("blink", CChatCommands::ACCESS_PLAYER, 0, ChatBlink, this);
+	m_ChatCommands.Register("surprise", CChatCommands::ACCESS_PLAYER, 0, ChatSurprise, this);
+
+	// moderator commands
+	m_ChatCommands.Register("notify", CChatCommands::ACCESS_MODERATOR, 0, ChatNotify, this);
+	m_ChatCommands.Register("undercover", CChatCommands::ACCESS_MODERATOR, 0, ChatUndercover, this);
+	m_ChatCommands.Register("freeze", CChatCommands::ACCESS_MODERATOR, 0, ChatFreeze, this);
+	m_ChatCommands.Register("unfreeze", CChatCommands::ACCESS_MODERATOR, 0, ChatUnfreeze, this);
+	m_ChatCommands.Register("idlist", CChatCommands::ACCESS_MODERATOR, 0, ChatIdList, this);
+	m_ChatCommands.Register("showstats", CChatCommands::ACCESS_MODERATOR, 0, ChatShowStats, this);
+	m_ChatCommands.Register("kick", CChatCommands::ACCESS_MODERATOR, 0, ChatKick, this);
+	m_ChatCommands.Register("ban", CChatCommands::ACCESS_MODERATOR, 0, ChatBan, this);
+
+	m_ChatCommands.Register("hesoyam", CChatCommands::ACCESS_PLAYER, 0, ChatHesoyam, this);
+}
+
 void CGameContext::OnConsoleInit()
 {
 	m_pServer = Kernel()->RequestInterface<IServer>();
@@ -4752,6 +4929,8 @@ void CGameContext::OnInit()
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 	m_World.SetGameServer(this);
 	m_Events.SetGameServer(this);
+	RegisterChatCommands();
+	RegisterProfilePhases();
 
 	for(int i = 0; i < NUM_NETOBJTYPES; i++)
 		Server()->SnapSetStaticsize(i, m_NetObjHandler.GetObjSize(i));
@@ -4790,6 +4969,16 @@ void CGameContext::OnInit()
 		}
 	}
 
+	// the benchmark keeps a fixed amount of dummies around and its accounts away from the real ones
+	if(g_Config.m_SvBenchTicks)
+	{
+		m_AmountBotsDefault = m_Vote_AmountBots = g_Config.m_SvBenchDummies;
+		m_pAccountsFolder = FOLDERPATH_BENCH_ACCOUNTS;
+		str_copy(folderpaths[0], m_pAccountsFolder, sizeof(folderpaths[0]));
+	}
+
+	m_pModSettingsWatch = fs_watch_create(FILEPATH_MODSETTINGS);
+
 	Console()->Chain("sv_motd", ConchainSpecialMotdupdate, this);
 
 	Console()->Chain("sv_vote_kick", ConchainSettingUpdate, this);
@@ -4854,6 +5043,9 @@ void CGameContext::OnInit()
 
 void CGameContext::OnShutdown()
 {
+	fs_watch_destroy(m_pModSettingsWatch);
+	m_pModSettingsWatch = 0;
+
 	delete m_pController;
 	m_pController = 0;
 	Clear();
@@ -4902,5 +5094,6 @@ bool CGameContext::IsClientPlayer(int ClientID) const
 const char *CGameContext::GameType() const { return m_pController && m_pController->GetGameType() ? m_pController->GetGameType() : ""; }
 const char *CGameContext::Version() const { return GAME_VERSION; }
 const char *CGameContext::NetVersion() const { return GAME_NETVERSION; }
+const char *CGameContext::GetItemName(int Type) const { return m_NetObjHandler.GetObjName(Type); }
 
 IGameServer *CreateGameServer() { return new CGameContext; }
@@ -4,6 +4,7 @@
 #define GAME_SERVER_GAMECONTEXT_H
 
 #define FOLDERPATH_ACCOUNTS "../../accounts"
+#define FOLDERPATH_BENCH_ACCOUNTS "../../bench_accounts"
 #define FOLDERPATH_TOPTEN "../../topten"
 #define FOLDERPATH_REDEEMCODES "../../redeemcodes"
 #define FOLDERPATH_LOGS "../../logs"
@@ -19,7 +20,6 @@
 #define FILEPATH_CHATLOG "chatlog.txt"
 #define FILEPATH_EVENTTIMES "eventtimes.ini"
 
-#define MAX_LINES_MODSETTINGS 50
 #define MAX_LEN_REGSTR 24
 
 #define IS_PRIVATE_VERSION 1
@@ -30,6 +30,7 @@
 #include <game/layers.h>
 #include <game/voting.h>
 
+#include "chatcommands.h"
 #include "eventhandler.h"
 #include "gameworld.h"
 
@@ -117,6 +118,7 @@ public:
 	void ForceVote(int Type, const char *pDescription, const char *pReason);
 	void SendVoteSet(int Type, int ToClientID);
 	void SendVoteStatus(int ClientID, int Total, int Yes, int No);
+	void CountVotes(int *pTotal, int *pYes, int *pNo);
 	void AbortVoteOnDisconnect(int ClientID);
 	void AbortVoteOnTeamChange(int ClientID);
 
@@ -156,6 +158,7 @@ public:
 	// network
 	void SendChat(int ChatterClientID, int Mode, int To, const char *pText);
 	void SendBroadcast(const char *pText, int ClientID);
+	void SendBroadcastMask(const char *pText, int64 Mask);
 	void SendEmoticon(int ClientID, int Emoticon);
 	void SendWeaponPickup(int ClientID, int Weapon);
 	void SendMotd(int ClientID);
@@ -191,6 +194,7 @@ public:
 	virtual void OnClientDrop(int ClientID, const char *pReason);
 	virtual void OnClientDirectInput(int ClientID, void *pInput);
 	virtual void OnClientPredictedInput(int ClientID, void *pInput);
+	virtual void OnBenchmarkClient(int ClientID, int Tick, void *pInput);
 
 	virtual bool IsClientReady(int ClientID) const;
 	virtual bool IsClientPlayer(int ClientID) const;
@@ -198,6 +202,7 @@ public:
 	virtual const char *GameType() const;
 	virtual const char *Version() const;
 	virtual const char *NetVersion() const;
+	virtual const char *GetItemName(int Type) const;
 
 	// general control
 	int m_aTellDelay[MAX_CLIENTS] = { 0 };
@@ -262,6 +267,7 @@ public:
 	int m_EvtBonusAmountBots = 0;// event bonus amount bots (deactivated)
 	float m_EvtGravityScale = 0.5;// event low gravity scale
 	int m_EvtBonusHandle = 0;// event rapidfire bonus handle
+	int m_WeaponProfileGeneration = 0;// increased when modsettings change, invalidates CCharacter weapon profiles
 	int m_EvtNoclip = false;// event rapidfire noclip
 
 	// hammer mines
@@ -332,7 +338,8 @@ public:
 	float m_GrenadeLifetimeDefault = 2.00;
 
 	// mod functions
-	int TuneModSettings(char *Filepath);// apply modsettings.cfg
+	int TuneModSettings(const char *pFilepath);// apply modsettings.cfg, see modsettings.h for the known settings
+	FS_WATCH *m_pModSettingsWatch;// reloads modsettings.cfg when it changes
 
 	void UpgradeStats(int ClientID, char *pStat, char *pAmount);
 	void ResetAccount(int ClientID);
@@ -352,7 +359,7 @@ public:
 	void AccountLogOut(int ClientID);
 	void AccountChangePassword(int ClientID, char *Password, char *Newpassword, char *Newpasswordconfirm);
 	void AccountUpdate(int ClientID);
-	void SubmitTicket(int ClientID, char *Message);
+	void SubmitTicket(int ClientID, const char *Message);
 	void RedeemCode(int ClientID, char *Code);
 
 	bool CheckRegisterFormat(char *Text, int Length, int ClientID);
@@ -402,6 +409,57 @@ public:
 	void ShowPlayerStats(int ID, int ClientID);
 	void ToggleUndercover(int ClientID);
 
+	// tick profiler phases, timed while sv_profile is on
+	enum
+	{
+		PROFILE_CONTROLLER=0,
+		PROFILE_PLAYERS,
+		PROFILE_ACCOUNTS,
+		PROFILE_EVENTS,
+		PROFILE_VOTES,
+		PROFILE_DUMMIES,
+		NUM_PROFILE_PHASES
+	};
+	int m_aProfilePhases[NUM_PROFILE_PHASES];
+	void RegisterProfilePhases();
+
+	// the benchmark gets a scratch folder for its accounts
+	const char *m_pAccountsFolder;
+
+	// chat commands
+	CChatCommands m_ChatCommands;
+	void RegisterChatCommands();
+
+	static void ChatInfo(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatRules(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatTopTen(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatHelp(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatUpgrade(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatStats(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatSwitchMode(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatShowExp(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatRegister(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatLogin(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatLogout(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatNewPassword(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatTicket(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatRedeem(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatAngry(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatHappy(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatDefault(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatPain(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatBlink(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatSurprise(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatNotify(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatUndercover(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatFreeze(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatUnfreeze(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatIdList(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatShowStats(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatKick(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatBan(CChatCommands::CResult *pResult, void *pUserData);
+	static void ChatHesoyam(CChatCommands::CResult *pResult, void *pUserData);
+
 	// *dummy functions
 	bool m_has_human_players;
 	bool m_has_human_active_players;
@@ -491,7 +549,7 @@ public:
 };
 
 inline int64 CmaskAll() { return -1; }
-inline int64 CmaskOne(int ClientID) { return 1<<ClientID; }
+inline int64 CmaskOne(int ClientID) { return (int64)1<<ClientID; }
 inline int64 CmaskAllExceptOne(int ClientID) { return CmaskAll()^CmaskOne(ClientID); }
 inline bool CmaskIsSet(int64 Mask, int ClientID) { return (Mask&CmaskOne(ClientID)) != 0; }
 #endif
\ No newline at end of file
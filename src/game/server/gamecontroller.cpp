@@ -668,6 +668,20 @@ void IGameController::SetGameState(EGameState GameState, int Timer)
 			m_GameStateTimer = Timer*Server()->TickSpeed();
 			m_SuddenDeath = 0;
 			GameServer()->m_World.m_Paused = true;
+
+			// the map changes once this match is over, get it loaded meanwhile
+			if(GameState == IGS_END_MATCH && m_MatchCount >= m_GameInfo.m_MatchNum-1)
+			{
+				char aMap[128];
+				if(m_aMapWish[0])
+					str_copy(aMap, m_aMapWish, sizeof(aMap));
+				else if(str_length(g_Config.m_SvMaprotation))
+					GetNextRotationMap(aMap, sizeof(aMap));
+				else
+					aMap[0] = 0;
+				if(aMap[0])
+					Server()->PreloadMap(aMap);
+			}
 		}
 	}
 }
@@ -931,13 +945,13 @@ void IGameController::UpdateGameInfo(int ClientID)
 
 	if(ClientID == -1)
 	{
+		int64 Mask = 0;
 		for(int i = 0; i < MAX_CLIENTS; ++i)
 		{
-			if(!GameServer()->m_apPlayers[i] || !Server()->ClientIngame(i))
-				continue;
-
-			Server()->SendPackMsg(&GameInfoMsg, MSGFLAG_VITAL|MSGFLAG_NORECORD, i);
+			if(GameServer()->m_apPlayers[i] && Server()->ClientIngame(i))
+				Mask |= CmaskOne(i);
 		}
+		Server()->SendPackMsgMask(&GameInfoMsg, MSGFLAG_VITAL|MSGFLAG_NORECORD, Mask);
 	}
 	else
 		Server()->SendPackMsg(&GameInfoMsg, MSGFLAG_VITAL|MSGFLAG_NORECORD, ClientID);
@@ -977,6 +991,18 @@ void IGameController::CycleMap()
 	if(!str_length(g_Config.m_SvMaprotation))
 		return;
 
+	char aMap[128];
+	GetNextRotationMap(aMap, sizeof(aMap));
+	m_MatchCount = 0;
+
+	char aBufMsg[256];
+	str_format(aBufMsg, sizeof(aBufMsg), "rotating map to %s", aMap);
+	GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBufMsg);
+	str_copy(g_Config.m_SvMap, aMap, sizeof(g_Config.m_SvMap));
+}
+
+void IGameController::GetNextRotationMap(char *pBuf, int BufSize) const
+{
 	// handle maprotation
 	const char *pMapRotation = g_Config.m_SvMaprotation;
 	const char *pCurrentMap = g_Config.m_SvMap;
@@ -1023,12 +1049,7 @@ void IGameController::CycleMap()
 	while(IsSeparator(aBuf[i]))
 		i++;
 
-	m_MatchCount = 0;
-
-	char aBufMsg[256];
-	str_format(aBufMsg, sizeof(aBufMsg), "rotating map to %s", &aBuf[i]);
-	GameServer()->Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
-	str_copy(g_Config.m_SvMap, &aBuf[i], sizeof(g_Config.m_SvMap));
+	str_copy(pBuf, &aBuf[i], BufSize);
 }
 
 // spawn
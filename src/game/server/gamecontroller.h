@@ -66,6 +66,7 @@ class IGameController
 	char m_aMapWish[128];
 	
 	void CycleMap();
+	void GetNextRotationMap(char *pBuf, int BufSize) const;
 
 	// spawn
 	struct CSpawnEval
@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <engine/shared/profiler.h>
+
 #include "entities/character.h"
 #include "entity.h"
 #include "gamecontext.h"
@@ -19,7 +21,10 @@ CGameWorld::CGameWorld()
 	m_Paused = false;
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
+	{
 		m_apFirstEntityTypes[i] = 0;
+		m_aProfilePhases[i] = -1;
+	}
 }
 
 CGameWorld::~CGameWorld()
@@ -34,6 +39,10 @@ void CGameWorld::SetGameServer(CGameContext *pGameServer)
 {
 	m_pGameServer = pGameServer;
 	m_pServer = m_pGameServer->Server();
+
+	static const char *s_apPhaseNames[NUM_ENTTYPES] = { "world_projectile", "world_laser", "world_pickup", "world_character", "world_flag" };
+	for(int i = 0; i < NUM_ENTTYPES; i++)
+		m_aProfilePhases[i] = m_pServer->TickProfiler()->RegisterPhase(s_apPhaseNames[i]);
 }
 
 CEntity *CGameWorld::FindFirst(int Type)
@@ -168,22 +177,46 @@ void CGameWorld::Tick()
 
 	if(!m_Paused)
 	{
+		// time both passes per entity type when profiling
+		CTickProfiler *pProfiler = Server()->TickProfiler();
+		bool Profile = pProfiler->Enabled();
+		int64 aDuration[NUM_ENTTYPES] = {0};
+
 		// update all objects
 		for(int i = 0; i < NUM_ENTTYPES; i++)
+		{
+			int64 Start = Profile ? time_get() : 0;
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
 				pEnt->Tick();
 				pEnt = m_pNextTraverseEntity;
 			}
+			if(Profile)
+				aDuration[i] += time_get()-Start;
+		}
 
 		for(int i = 0; i < NUM_ENTTYPES; i++)
+		{
+			int64 Start = Profile ? time_get() : 0;
 			for(CEntity *pEnt = m_apFirstEntityTypes[i]; pEnt; )
 			{
 				m_pNextTraverseEntity = pEnt->m_pNextTypeEntity;
 				pEnt->TickDefered();
 				pEnt = m_pNextTraverseEntity;
 			}
+			if(Profile)
+				aDuration[i] += time_get()-Start;
+		}
+
+		if(Profile)
+		{
+			for(int i = 0; i < NUM_ENTTYPES; i++)
+			{
+				if(m_aProfilePhases[i] >= 0)
+					pProfiler->Add(m_aProfilePhases[i], aDuration[i]);
+			}
+		}
 	}
 	else if(GameServer()->m_pController->IsGamePaused())
 	{
@@ -36,6 +36,8 @@ private:
 	class CGameContext *m_pGameServer;
 	class IServer *m_pServer;
 
+	int m_aProfilePhases[NUM_ENTTYPES];
+
 public:
 	class CGameContext *GameServer() { return m_pGameServer; }
 	class IServer *Server() { return m_pServer; }
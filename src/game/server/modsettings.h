@@ -0,0 +1,50 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_SERVER_MODSETTINGS_H
+#define GAME_SERVER_MODSETTINGS_H
+#undef GAME_SERVER_MODSETTINGS_H // this file will be included several times
+
+// settings read from modsettings.cfg, values outside of min..max get clamped
+// and settings missing in the file keep the default of their member
+// MACRO_MODSETTING_INT(Name, Member, Min, Max)
+// MACRO_MODSETTING_FLOAT(Name, Member, Min, Max)
+
+// weapon requirement levels
+MACRO_MODSETTING_INT(sv_req_hammer_auto, m_Req_hammer_auto, 0, 100000)
+MACRO_MODSETTING_INT(sv_req_hammer_fly, m_Req_hammer_fly, 0, 100000)
+MACRO_MODSETTING_INT(sv_req_gun_auto, m_Req_gun_auto, 0, 100000)
+MACRO_MODSETTING_INT(sv_req_gun_spread, m_Req_gun_spread, 0, 100000)
+MACRO_MODSETTING_INT(sv_req_grenade_bounce, m_Req_grenade_bounce, 0, 100000)
+MACRO_MODSETTING_INT(sv_req_grenade_bounce2, m_Req_grenade_bounce2, 0, 100000)
+MACRO_MODSETTING_INT(sv_req_rifle_exp, m_Req_rifle_dual, 0, 100000)
+MACRO_MODSETTING_INT(sv_req_rifle_range, m_Req_rifle_range, 0, 100000)
+MACRO_MODSETTING_INT(sv_req_rifle_spread, m_Req_rifle_triple, 0, 100000)
+
+// shotgun tuning
+MACRO_MODSETTING_FLOAT(sv_shotgun_spreadbase, twep_shotgun_spreadbase, 0, 360)
+MACRO_MODSETTING_INT(sv_shotgun_speeddiff, twep_shotgun_speeddiff, 0, 100)
+MACRO_MODSETTING_FLOAT(sv_shotgun_rangegain, twep_shotgun_rangegain, 0, 100)
+
+// character
+MACRO_MODSETTING_FLOAT(sv_health_per_point, m_Per_health_max, 0, 1000)
+MACRO_MODSETTING_FLOAT(sv_armor_per_point, m_Per_armor_max, 0, 1000)
+MACRO_MODSETTING_INT(sv_damage_ratio, m_DamageScaling, 0, 1000)
+MACRO_MODSETTING_INT(sv_level_min, m_MinAllowedLevel, -1, 100000)
+MACRO_MODSETTING_INT(sv_level_max, m_MaxAllowedLevel, -1, 100000)
+MACRO_MODSETTING_FLOAT(sv_spawnprotection, m_SpawnProtectionBase, 0, 60)
+
+// rewards
+MACRO_MODSETTING_INT(sv_reward_ammo, m_AmmoReward, 0, 1000)
+MACRO_MODSETTING_INT(sv_reward_streak, m_BonusPerStreak, 0, 1000)
+MACRO_MODSETTING_INT(sv_reward_leveldiff, m_BonusPer100, 0, 1000)
+MACRO_MODSETTING_INT(sv_kills_for_streak, m_StepKillstreak, 1, 1000)
+
+// mines and dropped life
+MACRO_MODSETTING_INT(sv_mine_lifetime, m_MineLifeTime, 0, 3600)
+MACRO_MODSETTING_INT(sv_mine_radius, m_MineRadius, 0, 1000)
+MACRO_MODSETTING_INT(sv_droplife_ratio, m_DropLifeRewardRatio, 0, 100)
+MACRO_MODSETTING_INT(sv_droplife_lifetime, m_DropLifeLifeTime, 0, 3600)
+MACRO_MODSETTING_FLOAT(sv_droplife_gravity, m_DropLifeGravity, -10, 10)
+MACRO_MODSETTING_INT(sv_droplife_bounce, m_DropLifeBounceForce, 0, 1000)
+
+#endif
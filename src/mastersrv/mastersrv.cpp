@@ -17,9 +17,11 @@
 enum {
 	MTU = 1400,
 	MAX_SERVERS_PER_PACKET=75,
-	MAX_PACKETS=16,
+	MAX_PACKETS=64,
 	MAX_SERVERS=MAX_SERVERS_PER_PACKET*MAX_PACKETS,
-	EXPIRE_TIME = 90
+	EXPIRE_TIME = 90,
+	HASH_SIZE = 4096,
+	WHEEL_SIZE = 128 // seconds, has to be more than EXPIRE_TIME plus the purge interval
 };
 
 struct CCheckServer
@@ -30,9 +32,17 @@ struct CCheckServer
 	int m_TryCount;
 	int64 m_TryTime;
 	TOKEN m_Token;
+
+	CCheckServer *m_pHashNext;
+	CCheckServer *m_pHashPrev;
+	CCheckServer *m_pNext;
+	CCheckServer *m_pPrev;
 };
 
 static CCheckServer m_aCheckServers[MAX_SERVERS];
+static CCheckServer *m_pFirstFreeCheckServer = 0;
+static CCheckServer *m_pFirstCheckServer = 0;
+static CCheckServer *m_apCheckServerHash[HASH_SIZE]; // by ip only, the alt address only differs in the port
 static int m_NumCheckServers = 0;
 
 struct CServerEntry
@@ -40,9 +50,20 @@ struct CServerEntry
 	enum ServerType m_Type;
 	NETADDR m_Address;
 	int64 m_Expire;
+	int m_Position; // in the list packets
+
+	CServerEntry *m_pHashNext;
+	CServerEntry *m_pHashPrev;
+	CServerEntry *m_pWheelNext;
+	CServerEntry *m_pWheelPrev;
 };
 
 static CServerEntry m_aServers[MAX_SERVERS];
+static CServerEntry *m_pFirstFreeServer = 0;
+static CServerEntry *m_apServerHash[HASH_SIZE];
+static CServerEntry *m_apExpireWheel[WHEEL_SIZE]; // by the second of m_Expire
+static int64 m_PurgeSecond = 0;
+static CServerEntry *m_apServerPositions[MAX_SERVERS];
 static int m_NumServers = 0;
 
 struct CPacketData
@@ -75,59 +96,192 @@ static CNetClient m_NetOp; // main
 
 IConsole *m_pConsole;
 
-void BuildPackets()
+void InitLists()
 {
-	CServerEntry *pCurrent = &m_aServers[0];
-	int ServersLeft = m_NumServers;
-	m_NumPackets = 0;
-	int PacketIndex = 0;
-	int PacketIndexLegacy = 0;
-	while(ServersLeft-- && m_NumPackets < MAX_PACKETS)
+	for(int i = 0; i < MAX_SERVERS-1; i++)
 	{
-		if(pCurrent->m_Type == SERVERTYPE_NORMAL)
-		{
-			if(PacketIndex % MAX_SERVERS_PER_PACKET == 0)
-			{
-				PacketIndex = 0;
-				m_NumPackets++;
-			}
+		m_aServers[i].m_pHashNext = &m_aServers[i+1];
+		m_aCheckServers[i].m_pHashNext = &m_aCheckServers[i+1];
+	}
+	m_aServers[MAX_SERVERS-1].m_pHashNext = 0;
+	m_aCheckServers[MAX_SERVERS-1].m_pHashNext = 0;
+	m_pFirstFreeServer = &m_aServers[0];
+	m_pFirstFreeCheckServer = &m_aCheckServers[0];
 
-			// copy header
-			mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
+	for(int i = 0; i < MAX_PACKETS; i++)
+		mem_copy(m_aPackets[i].m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
+}
 
-			// copy server addresses
-			if(pCurrent->m_Address.type == NETTYPE_IPV6)
-			{
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, pCurrent->m_Address.ip,
-					sizeof(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp));
-			}
-			else
-			{
-				static unsigned char s_aIPV4Mapping[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF};
+unsigned AddrHash(const NETADDR *pAddr, bool WithPort)
+{
+	unsigned Hash = 2166136261u;
+	for(int i = 0; i < 16; i++)
+		Hash = (Hash^pAddr->ip[i])*16777619u;
+	if(WithPort)
+		Hash = (((Hash^(pAddr->port&0xff))*16777619u)^(pAddr->port>>8))*16777619u;
+	return Hash^(Hash>>16);
+}
 
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, s_aIPV4Mapping, sizeof(s_aIPV4Mapping));
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[12] = pCurrent->m_Address.ip[0];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[13] = pCurrent->m_Address.ip[1];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[14] = pCurrent->m_Address.ip[2];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[15] = pCurrent->m_Address.ip[3];
-			}
+int WheelSlot(int64 Time)
+{
+	return (int)((Time/time_freq())%WHEEL_SIZE);
+}
+
+void LinkServer(CServerEntry *pEntry)
+{
+	CServerEntry **ppHashFirst = &m_apServerHash[AddrHash(&pEntry->m_Address, true)%HASH_SIZE];
+	pEntry->m_pHashPrev = 0;
+	pEntry->m_pHashNext = *ppHashFirst;
+	if(*ppHashFirst)
+		(*ppHashFirst)->m_pHashPrev = pEntry;
+	*ppHashFirst = pEntry;
+}
+
+void UnlinkServer(CServerEntry *pEntry)
+{
+	if(pEntry->m_pHashNext)
+		pEntry->m_pHashNext->m_pHashPrev = pEntry->m_pHashPrev;
+	if(pEntry->m_pHashPrev)
+		pEntry->m_pHashPrev->m_pHashNext = pEntry->m_pHashNext;
+	else
+		m_apServerHash[AddrHash(&pEntry->m_Address, true)%HASH_SIZE] = pEntry->m_pHashNext;
+}
 
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[0] = (pCurrent->m_Address.port>>8)&0xff;
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[1] = pCurrent->m_Address.port&0xff;
+void LinkExpire(CServerEntry *pEntry)
+{
+	CServerEntry **ppWheelFirst = &m_apExpireWheel[WheelSlot(pEntry->m_Expire)];
+	pEntry->m_pWheelPrev = 0;
+	pEntry->m_pWheelNext = *ppWheelFirst;
+	if(*ppWheelFirst)
+		(*ppWheelFirst)->m_pWheelPrev = pEntry;
+	*ppWheelFirst = pEntry;
+}
 
-			PacketIndex++;
+void UnlinkExpire(CServerEntry *pEntry)
+{
+	if(pEntry->m_pWheelNext)
+		pEntry->m_pWheelNext->m_pWheelPrev = pEntry->m_pWheelPrev;
+	if(pEntry->m_pWheelPrev)
+		pEntry->m_pWheelPrev->m_pWheelNext = pEntry->m_pWheelNext;
+	else
+		m_apExpireWheel[WheelSlot(pEntry->m_Expire)] = pEntry->m_pWheelNext;
+}
 
-			m_aPackets[m_NumPackets-1].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*PacketIndex;
+CServerEntry *FindServer(const NETADDR *pAddr)
+{
+	for(CServerEntry *pEntry = m_apServerHash[AddrHash(pAddr, true)%HASH_SIZE]; pEntry; pEntry = pEntry->m_pHashNext)
+	{
+		if(net_addr_comp(&pEntry->m_Address, pAddr) == 0)
+			return pEntry;
+	}
+	return 0;
+}
 
-			pCurrent++;
-		}
-		else
-		{
-			*pCurrent = m_aServers[m_NumServers-1];
-			m_NumServers--;
-			dbg_msg("mastersrv", "error: server of invalid type, dropping it");
-		}
+void LinkCheckServer(CCheckServer *pCheck)
+{
+	CCheckServer **ppHashFirst = &m_apCheckServerHash[AddrHash(&pCheck->m_Address, false)%HASH_SIZE];
+	pCheck->m_pHashPrev = 0;
+	pCheck->m_pHashNext = *ppHashFirst;
+	if(*ppHashFirst)
+		(*ppHashFirst)->m_pHashPrev = pCheck;
+	*ppHashFirst = pCheck;
+
+	pCheck->m_pPrev = 0;
+	pCheck->m_pNext = m_pFirstCheckServer;
+	if(m_pFirstCheckServer)
+		m_pFirstCheckServer->m_pPrev = pCheck;
+	m_pFirstCheckServer = pCheck;
+	m_NumCheckServers++;
+}
+
+void RemoveCheckServer(CCheckServer *pCheck)
+{
+	if(pCheck->m_pHashNext)
+		pCheck->m_pHashNext->m_pHashPrev = pCheck->m_pHashPrev;
+	if(pCheck->m_pHashPrev)
+		pCheck->m_pHashPrev->m_pHashNext = pCheck->m_pHashNext;
+	else
+		m_apCheckServerHash[AddrHash(&pCheck->m_Address, false)%HASH_SIZE] = pCheck->m_pHashNext;
+
+	if(pCheck->m_pNext)
+		pCheck->m_pNext->m_pPrev = pCheck->m_pPrev;
+	if(pCheck->m_pPrev)
+		pCheck->m_pPrev->m_pNext = pCheck->m_pNext;
+	else
+		m_pFirstCheckServer = pCheck->m_pNext;
+	m_NumCheckServers--;
+
+	pCheck->m_pHashNext = m_pFirstFreeCheckServer;
+	m_pFirstFreeCheckServer = pCheck;
+}
+
+CCheckServer *FindCheckServer(const NETADDR *pAddr, bool MatchAlt)
+{
+	for(CCheckServer *pCheck = m_apCheckServerHash[AddrHash(pAddr, false)%HASH_SIZE]; pCheck; pCheck = pCheck->m_pHashNext)
+	{
+		if(net_addr_comp(&pCheck->m_Address, pAddr) == 0 || (MatchAlt && net_addr_comp(&pCheck->m_AltAddress, pAddr) == 0))
+			return pCheck;
+	}
+	return 0;
+}
+
+// every server keeps its place in the list packets, a removed one is replaced by the last one
+void WritePacketAddr(int Position)
+{
+	const NETADDR *pAddr = &m_apServerPositions[Position]->m_Address;
+	CMastersrvAddr *pOut = &m_aPackets[Position/MAX_SERVERS_PER_PACKET].m_Data.m_aServers[Position%MAX_SERVERS_PER_PACKET];
+
+	// copy server addresses
+	if(pAddr->type == NETTYPE_IPV6)
+	{
+		mem_copy(pOut->m_aIp, pAddr->ip, sizeof(pOut->m_aIp));
+	}
+	else
+	{
+		static unsigned char s_aIPV4Mapping[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF};
+
+		mem_copy(pOut->m_aIp, s_aIPV4Mapping, sizeof(s_aIPV4Mapping));
+		pOut->m_aIp[12] = pAddr->ip[0];
+		pOut->m_aIp[13] = pAddr->ip[1];
+		pOut->m_aIp[14] = pAddr->ip[2];
+		pOut->m_aIp[15] = pAddr->ip[3];
+	}
+
+	pOut->m_aPort[0] = (pAddr->port>>8)&0xff;
+	pOut->m_aPort[1] = pAddr->port&0xff;
+}
+
+void UpdatePacketSizes()
+{
+	// all packets but the last one are full
+	m_NumPackets = (m_NumServers+MAX_SERVERS_PER_PACKET-1)/MAX_SERVERS_PER_PACKET;
+	if(m_NumPackets > 1)
+		m_aPackets[m_NumPackets-2].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*MAX_SERVERS_PER_PACKET;
+	if(m_NumPackets > 0)
+		m_aPackets[m_NumPackets-1].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*(m_NumServers-(m_NumPackets-1)*MAX_SERVERS_PER_PACKET);
+}
+
+void RemoveServer(CServerEntry *pEntry)
+{
+	char aAddrStr[NETADDR_MAXSTRSIZE];
+	net_addr_str(&pEntry->m_Address, aAddrStr, sizeof(aAddrStr), true);
+	dbg_msg("mastersrv", "expired: %s", aAddrStr);
+
+	UnlinkServer(pEntry);
+	UnlinkExpire(pEntry);
+
+	m_NumServers--;
+	if(pEntry->m_Position != m_NumServers)
+	{
+		CServerEntry *pLast = m_apServerPositions[m_NumServers];
+		pLast->m_Position = pEntry->m_Position;
+		m_apServerPositions[pLast->m_Position] = pLast;
+		WritePacketAddr(pLast->m_Position);
 	}
+	UpdatePacketSizes();
+
+	pEntry->m_pHashNext = m_pFirstFreeServer;
+	m_pFirstFreeServer = pEntry;
 }
 
 void SendOk(NETADDR *pAddr, TOKEN Token)
@@ -168,44 +322,58 @@ void SendCheck(NETADDR *pAddr, TOKEN Token)
 
 void AddCheckserver(NETADDR *pInfo, NETADDR *pAlt, ServerType Type, TOKEN Token)
 {
+	char aAddrStr[NETADDR_MAXSTRSIZE];
+	net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
+	char aAltAddrStr[NETADDR_MAXSTRSIZE];
+	net_addr_str(pAlt, aAltAddrStr, sizeof(aAltAddrStr), true);
+
+	// a repeated heartbeat restarts the check of the server
+	CCheckServer *pCheck = FindCheckServer(pInfo, false);
+	if(pCheck)
+		RemoveCheckServer(pCheck);
+
 	// add server
-	if(m_NumCheckServers == MAX_SERVERS)
+	if(!m_pFirstFreeCheckServer)
 	{
 		dbg_msg("mastersrv", "error: mastersrv is full");
 		return;
 	}
 
-	char aAddrStr[NETADDR_MAXSTRSIZE];
-	net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
-	char aAltAddrStr[NETADDR_MAXSTRSIZE];
-	net_addr_str(pAlt, aAltAddrStr, sizeof(aAltAddrStr), true);
 	dbg_msg("mastersrv", "checking: %s (%s)", aAddrStr, aAltAddrStr);
-	m_aCheckServers[m_NumCheckServers].m_Address = *pInfo;
-	m_aCheckServers[m_NumCheckServers].m_AltAddress = *pAlt;
-	m_aCheckServers[m_NumCheckServers].m_TryCount = 0;
-	m_aCheckServers[m_NumCheckServers].m_TryTime = 0;
-	m_aCheckServers[m_NumCheckServers].m_Type = Type;
-	m_aCheckServers[m_NumCheckServers].m_Token = Token;
-	m_NumCheckServers++;
+	pCheck = m_pFirstFreeCheckServer;
+	m_pFirstFreeCheckServer = pCheck->m_pHashNext;
+	pCheck->m_Address = *pInfo;
+	pCheck->m_AltAddress = *pAlt;
+	pCheck->m_TryCount = 0;
+	pCheck->m_TryTime = 0;
+	pCheck->m_Type = Type;
+	pCheck->m_Token = Token;
+	LinkCheckServer(pCheck);
 }
 
 void AddServer(NETADDR *pInfo, ServerType Type)
 {
+	if(Type != SERVERTYPE_NORMAL)
+	{
+		dbg_msg("mastersrv", "error: server of invalid type, dropping it");
+		return;
+	}
+
 	// see if server already exists in list
-	for(int i = 0; i < m_NumServers; i++)
+	CServerEntry *pEntry = FindServer(pInfo);
+	if(pEntry)
 	{
-		if(net_addr_comp(&m_aServers[i].m_Address, pInfo) == 0)
-		{
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "updated: %s", aAddrStr);
-			m_aServers[i].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-			return;
-		}
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
+		dbg_msg("mastersrv", "updated: %s", aAddrStr);
+		UnlinkExpire(pEntry);
+		pEntry->m_Expire = time_get()+time_freq()*EXPIRE_TIME;
+		LinkExpire(pEntry);
+		return;
 	}
 
 	// add server
-	if(m_NumServers == MAX_SERVERS)
+	if(!m_pFirstFreeServer)
 	{
 		dbg_msg("mastersrv", "error: mastersrv is full");
 		return;
@@ -214,42 +382,50 @@ void AddServer(NETADDR *pInfo, ServerType Type)
 	char aAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
 	dbg_msg("mastersrv", "added: %s", aAddrStr);
-	m_aServers[m_NumServers].m_Address = *pInfo;
-	m_aServers[m_NumServers].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-	m_aServers[m_NumServers].m_Type = Type;
-	m_NumServers++;
+	pEntry = m_pFirstFreeServer;
+	m_pFirstFreeServer = pEntry->m_pHashNext;
+	pEntry->m_Address = *pInfo;
+	pEntry->m_Expire = time_get()+time_freq()*EXPIRE_TIME;
+	pEntry->m_Type = Type;
+	LinkServer(pEntry);
+	LinkExpire(pEntry);
+
+	pEntry->m_Position = m_NumServers++;
+	m_apServerPositions[pEntry->m_Position] = pEntry;
+	WritePacketAddr(pEntry->m_Position);
+	UpdatePacketSizes();
 }
 
 void UpdateServers()
 {
 	int64 Now = time_get();
 	int64 Freq = time_freq();
-	for(int i = 0; i < m_NumCheckServers; i++)
+	CCheckServer *pNext;
+	for(CCheckServer *pCheck = m_pFirstCheckServer; pCheck; pCheck = pNext)
 	{
-		if(Now > m_aCheckServers[i].m_TryTime+Freq)
+		pNext = pCheck->m_pNext;
+		if(Now > pCheck->m_TryTime+Freq)
 		{
-			if(m_aCheckServers[i].m_TryCount == 10)
+			if(pCheck->m_TryCount == 10)
 			{
 				char aAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&m_aCheckServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
+				net_addr_str(&pCheck->m_Address, aAddrStr, sizeof(aAddrStr), true);
 				char aAltAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&m_aCheckServers[i].m_AltAddress, aAltAddrStr, sizeof(aAltAddrStr), true);
+				net_addr_str(&pCheck->m_AltAddress, aAltAddrStr, sizeof(aAltAddrStr), true);
 				dbg_msg("mastersrv", "check failed: %s (%s)", aAddrStr, aAltAddrStr);
 
 				// FAIL!!
-				SendError(&m_aCheckServers[i].m_Address, m_aCheckServers[i].m_Token);
-				m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers-1];
-				m_NumCheckServers--;
-				i--;
+				SendError(&pCheck->m_Address, pCheck->m_Token);
+				RemoveCheckServer(pCheck);
 			}
 			else
 			{
-				m_aCheckServers[i].m_TryCount++;
-				m_aCheckServers[i].m_TryTime = Now;
-				if(m_aCheckServers[i].m_TryCount&1)
-					SendCheck(&m_aCheckServers[i].m_Address, m_aCheckServers[i].m_Token);
+				pCheck->m_TryCount++;
+				pCheck->m_TryTime = Now;
+				if(pCheck->m_TryCount&1)
+					SendCheck(&pCheck->m_Address, pCheck->m_Token);
 				else
-					SendCheck(&m_aCheckServers[i].m_AltAddress, m_aCheckServers[i].m_Token);
+					SendCheck(&pCheck->m_AltAddress, pCheck->m_Token);
 			}
 		}
 	}
@@ -257,22 +433,24 @@ void UpdateServers()
 
 void PurgeServers()
 {
+	// only the wheel slots of the seconds since the last purge are due
 	int64 Now = time_get();
-	int i = 0;
-	while(i < m_NumServers)
+	int64 Second = Now/time_freq();
+	if(Second-m_PurgeSecond >= WHEEL_SIZE)
+		m_PurgeSecond = Second-WHEEL_SIZE+1;
+	for(; m_PurgeSecond <= Second; m_PurgeSecond++)
 	{
-		if(m_aServers[i].m_Expire < Now)
+		CServerEntry *pNext;
+		for(CServerEntry *pEntry = m_apExpireWheel[m_PurgeSecond%WHEEL_SIZE]; pEntry; pEntry = pNext)
 		{
-			// remove server
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(&m_aServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "expired: %s", aAddrStr);
-			m_aServers[i] = m_aServers[m_NumServers-1];
-			m_NumServers--;
+			pNext = pEntry->m_pWheelNext;
+			if(pEntry->m_Expire < Now)
+				RemoveServer(pEntry);
 		}
-		else
-			i++;
 	}
+
+	// the current second is not over yet
+	m_PurgeSecond = Second;
 }
 
 void ReloadBans()
@@ -283,7 +461,7 @@ void ReloadBans()
 
 int main(int argc, const char **argv) // ignore_convention
 {
-	int64 LastBuild = 0, LastBanReload = 0;
+	int64 LastUpdate = 0, LastBanReload = 0;
 	ServerType Type = SERVERTYPE_INVALID;
 	NETADDR BindAddr;
 
@@ -291,6 +469,7 @@ int main(int argc, const char **argv) // ignore_convention
 	net_init();
 
 	mem_copy(m_CountData.m_Header, SERVERBROWSE_COUNT, sizeof(SERVERBROWSE_COUNT));
+	InitLists();
 
 	int FlagMask = CFGFLAG_MASTER;
 	IKernel *pKernel = IKernel::Create();
@@ -414,16 +593,11 @@ int main(int argc, const char **argv) // ignore_convention
 			{
 				Type = SERVERTYPE_INVALID;
 				// remove it from checking
-				for(int i = 0; i < m_NumCheckServers; i++)
+				CCheckServer *pCheck = FindCheckServer(&Packet.m_Address, true);
+				if(pCheck)
 				{
-					if(net_addr_comp(&m_aCheckServers[i].m_Address, &Packet.m_Address) == 0 ||
-						net_addr_comp(&m_aCheckServers[i].m_AltAddress, &Packet.m_Address) == 0)
-					{
-						Type = m_aCheckServers[i].m_Type;
-						m_NumCheckServers--;
-						m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers];
-						break;
-					}
+					Type = pCheck->m_Type;
+					RemoveCheckServer(pCheck);
 				}
 
 				// drops servers that were not in the CheckServers list
@@ -442,13 +616,12 @@ int main(int argc, const char **argv) // ignore_convention
 			ReloadBans();
 		}
 
-		if(time_get()-LastBuild > time_freq()*5)
+		if(time_get()-LastUpdate > time_freq()*5)
 		{
-			LastBuild = time_get();
+			LastUpdate = time_get();
 
 			PurgeServers();
 			UpdateServers();
-			BuildPackets();
 		}
 
 		// be nice to the CPU
@@ -0,0 +1,679 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/compression.h>
+#include <engine/shared/huffman.h>
+
+// checks the network codecs and times them. CHuffman has to match the tree walking
+// implementation it replaced byte for byte, CVariableInt's array functions the single
+// ints of Pack and Unpack, also for broken input and too small buffers.
+// exits with 1 on failures, -n skips the timing
+
+static int gs_NumChecks = 0;
+static int gs_NumFailures = 0;
+
+static unsigned gs_Seed = 1;
+static unsigned Random()
+{
+	gs_Seed = gs_Seed*1103515245+12345;
+	return gs_Seed>>8;
+}
+
+// counts a check, the results and the first Got bytes of both outputs have to match
+static void Compare(const char *pWhat, int InputSize, int OutputSize, long Got, long Expected, const void *pOut, const void *pRef)
+{
+	gs_NumChecks++;
+	if(Got == Expected && (Got <= 0 || mem_comp(pOut, pRef, Got) == 0))
+		return;
+	if(gs_NumFailures++ < 10)
+		dbg_msg("compression_test", "%s differs. input=%d output=%d got=%ld expected=%ld", pWhat, InputSize, OutputSize, Got, Expected);
+}
+
+// keeps the best of several rounds in nanoseconds per call
+static void TakeBest(double *pBest, int64 Start, int Iterations)
+{
+	*pBest = min(*pBest, (time_get()-Start)*1e9/time_freq()/Iterations);
+}
+
+// the tree walking implementation, kept as the reference
+class CRefHuffman
+{
+	enum
+	{
+		HUFFMAN_EOF_SYMBOL = 256,
+
+		HUFFMAN_MAX_SYMBOLS=HUFFMAN_EOF_SYMBOL+1,
+		HUFFMAN_MAX_NODES=HUFFMAN_MAX_SYMBOLS*2-1,
+
+		HUFFMAN_LUTBITS = 10,
+		HUFFMAN_LUTSIZE = (1<<HUFFMAN_LUTBITS),
+		HUFFMAN_LUTMASK = (HUFFMAN_LUTSIZE-1)
+	};
+
+	struct CNode
+	{
+		unsigned m_Bits;
+		unsigned m_NumBits;
+		unsigned short m_aLeafs[2];
+		unsigned char m_Symbol;
+	};
+
+	struct CConstructNode
+	{
+		unsigned short m_NodeId;
+		int m_Frequency;
+	};
+
+	CNode m_aNodes[HUFFMAN_MAX_NODES];
+	CNode *m_apDecodeLut[HUFFMAN_LUTSIZE];
+	CNode *m_pStartNode;
+	int m_NumNodes;
+
+	void Setbits_r(CNode *pNode, int Bits, unsigned Depth)
+	{
+		if(pNode->m_aLeafs[1] != 0xffff)
+			Setbits_r(&m_aNodes[pNode->m_aLeafs[1]], Bits|(1<<Depth), Depth+1);
+		if(pNode->m_aLeafs[0] != 0xffff)
+			Setbits_r(&m_aNodes[pNode->m_aLeafs[0]], Bits, Depth+1);
+
+		if(pNode->m_NumBits)
+		{
+			pNode->m_Bits = Bits;
+			pNode->m_NumBits = Depth;
+		}
+	}
+
+	static void BubbleSort(CConstructNode **ppList, int Size)
+	{
+		int Changed = 1;
+		while(Changed)
+		{
+			Changed = 0;
+			for(int i = 0; i < Size-1; i++)
+			{
+				if(ppList[i]->m_Frequency < ppList[i+1]->m_Frequency)
+				{
+					CConstructNode *pTemp = ppList[i];
+					ppList[i] = ppList[i+1];
+					ppList[i+1] = pTemp;
+					Changed = 1;
+				}
+			}
+			Size--;
+		}
+	}
+
+	void ConstructTree(const unsigned *pFrequencies)
+	{
+		CConstructNode aNodesLeftStorage[HUFFMAN_MAX_SYMBOLS];
+		CConstructNode *apNodesLeft[HUFFMAN_MAX_SYMBOLS];
+		int NumNodesLeft = HUFFMAN_MAX_SYMBOLS;
+
+		for(int i = 0; i < HUFFMAN_MAX_SYMBOLS; i++)
+		{
+			m_aNodes[i].m_NumBits = 0xFFFFFFFF;
+			m_aNodes[i].m_Symbol = i;
+			m_aNodes[i].m_aLeafs[0] = 0xffff;
+			m_aNodes[i].m_aLeafs[1] = 0xffff;
+			aNodesLeftStorage[i].m_Frequency = i == HUFFMAN_EOF_SYMBOL ? 1 : pFrequencies[i];
+			aNodesLeftStorage[i].m_NodeId = i;
+			apNodesLeft[i] = &aNodesLeftStorage[i];
+		}
+
+		m_NumNodes = HUFFMAN_MAX_SYMBOLS;
+		while(NumNodesLeft > 1)
+		{
+			BubbleSort(apNodesLeft, NumNodesLeft);
+
+			m_aNodes[m_NumNodes].m_NumBits = 0;
+			m_aNodes[m_NumNodes].m_aLeafs[0] = apNodesLeft[NumNodesLeft-1]->m_NodeId;
+			m_aNodes[m_NumNodes].m_aLeafs[1] = apNodesLeft[NumNodesLeft-2]->m_NodeId;
+			apNodesLeft[NumNodesLeft-2]->m_NodeId = m_NumNodes;
+			apNodesLeft[NumNodesLeft-2]->m_Frequency = apNodesLeft[NumNodesLeft-1]->m_Frequency + apNodesLeft[NumNodesLeft-2]->m_Frequency;
+
+			m_NumNodes++;
+			NumNodesLeft--;
+		}
+
+		m_pStartNode = &m_aNodes[m_NumNodes-1];
+		Setbits_r(m_pStartNode, 0, 0);
+	}
+
+public:
+	void Init(const unsigned *pFrequencies)
+	{
+		mem_zero(this, sizeof(*this));
+		ConstructTree(pFrequencies);
+
+		for(int i = 0; i < HUFFMAN_LUTSIZE; i++)
+		{
+			unsigned Bits = i;
+			int k;
+			CNode *pNode = m_pStartNode;
+			for(k = 0; k < HUFFMAN_LUTBITS; k++)
+			{
+				pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+				Bits >>= 1;
+
+				if(pNode->m_NumBits)
+				{
+					m_apDecodeLut[i] = pNode;
+					break;
+				}
+			}
+
+			if(k == HUFFMAN_LUTBITS)
+				m_apDecodeLut[i] = pNode;
+		}
+	}
+
+	int Compress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
+	{
+#define HUFFMAN_MACRO_LOADSYMBOL(Sym) \
+	Bits |= m_aNodes[Sym].m_Bits << Bitcount; \
+	Bitcount += m_aNodes[Sym].m_NumBits;
+
+#define HUFFMAN_MACRO_WRITE() \
+	while(Bitcount >= 8) \
+	{ \
+		*pDst++ = (unsigned char)(Bits&0xff); \
+		if(pDst == pDstEnd) \
+			return -1; \
+		Bits >>= 8; \
+		Bitcount -= 8; \
+	}
+
+		const unsigned char *pSrc = (const unsigned char *)pInput;
+		const unsigned char *pSrcEnd = pSrc + InputSize;
+		unsigned char *pDst = (unsigned char *)pOutput;
+		unsigned char *pDstEnd = pDst + OutputSize;
+		unsigned Bits = 0;
+		unsigned Bitcount = 0;
+
+		if(InputSize)
+		{
+			int Symbol = *pSrc++;
+			while(pSrc != pSrcEnd)
+			{
+				HUFFMAN_MACRO_LOADSYMBOL(Symbol)
+				Symbol = *pSrc++;
+				HUFFMAN_MACRO_WRITE()
+			}
+			HUFFMAN_MACRO_LOADSYMBOL(Symbol)
+			HUFFMAN_MACRO_WRITE()
+		}
+		HUFFMAN_MACRO_LOADSYMBOL(HUFFMAN_EOF_SYMBOL)
+		HUFFMAN_MACRO_WRITE()
+
+		*pDst++ = Bits;
+		return (int)(pDst - (const unsigned char *)pOutput);
+
+#undef HUFFMAN_MACRO_LOADSYMBOL
+#undef HUFFMAN_MACRO_WRITE
+	}
+
+	int Decompress(const void *pInput, int InputSize, void *pOutput, int OutputSize)
+	{
+		unsigned char *pDst = (unsigned char *)pOutput;
+		unsigned char *pSrc = (unsigned char *)pInput;
+		unsigned char *pDstEnd = pDst + OutputSize;
+		unsigned char *pSrcEnd = pSrc + InputSize;
+		unsigned Bits = 0;
+		unsigned Bitcount = 0;
+		CNode *pEof = &m_aNodes[HUFFMAN_EOF_SYMBOL];
+
+		while(1)
+		{
+			CNode *pNode = 0;
+			if(Bitcount >= HUFFMAN_LUTBITS)
+				pNode = m_apDecodeLut[Bits&HUFFMAN_LUTMASK];
+
+			while(Bitcount < 24 && pSrc != pSrcEnd)
+			{
+				Bits |= (*pSrc++) << Bitcount;
+				Bitcount += 8;
+			}
+
+			if(!pNode)
+				pNode = m_apDecodeLut[Bits&HUFFMAN_LUTMASK];
+			if(!pNode)
+				return -1;
+
+			if(pNode->m_NumBits)
+			{
+				Bits >>= pNode->m_NumBits;
+				Bitcount -= pNode->m_NumBits;
+			}
+			else
+			{
+				Bits >>= HUFFMAN_LUTBITS;
+				Bitcount -= HUFFMAN_LUTBITS;
+				while(1)
+				{
+					pNode = &m_aNodes[pNode->m_aLeafs[Bits&1]];
+					Bitcount--;
+					Bits >>= 1;
+					if(pNode->m_NumBits)
+						break;
+					if(Bitcount == 0)
+						return -1;
+				}
+			}
+
+			if(pNode == pEof)
+				break;
+
+			if(pDst == pDstEnd)
+				return -1;
+			*pDst++ = pNode->m_Symbol;
+		}
+
+		return (int)(pDst - (const unsigned char *)pOutput);
+	}
+};
+
+// the table from network.cpp
+static const unsigned gs_aNetFreqTable[256+1] = {
+	1<<30,4545,2657,431,1950,919,444,482,2244,617,838,542,715,1814,304,240,754,212,647,186,
+	283,131,146,166,543,164,167,136,179,859,363,113,157,154,204,108,137,180,202,176,
+	872,404,168,134,151,111,113,109,120,126,129,100,41,20,16,22,18,18,17,19,
+	16,37,13,21,362,166,99,78,95,88,81,70,83,284,91,187,77,68,52,68,
+	59,66,61,638,71,157,50,46,69,43,11,24,13,19,10,12,12,20,14,9,
+	20,20,10,10,15,15,12,12,7,19,15,14,13,18,35,19,17,14,8,5,
+	15,17,9,15,14,18,8,10,2173,134,157,68,188,60,170,60,194,62,175,71,
+	148,67,167,78,211,67,156,69,1674,90,174,53,147,89,181,51,174,63,163,80,
+	167,94,128,122,223,153,218,77,200,110,190,73,174,69,145,66,277,143,141,60,
+	136,53,180,57,142,57,158,61,166,112,152,92,26,22,21,28,20,26,30,21,
+	32,27,20,17,23,21,30,22,22,21,27,25,17,27,23,18,39,26,15,21,
+	12,18,18,27,20,18,15,19,11,17,33,12,18,15,19,18,16,26,17,18,
+	9,10,25,22,22,17,20,16,6,16,15,20,14,18,24,335,1517};
+
+enum
+{
+	MAX_HUFFMAN_INPUT=1400,
+	MAX_HUFFMAN_OUTPUT=MAX_HUFFMAN_INPUT*8,
+};
+
+static CHuffman gs_Huffman;
+static CRefHuffman gs_RefHuffman;
+
+// 0 random bytes, 1 mostly zeros, 2 snapshot like: zeros, small numbers and some random bytes
+static void HuffmanGenerate(unsigned char *pData, int Size, int Kind)
+{
+	for(int i = 0; i < Size; i++)
+	{
+		int r = Random()%16;
+		if(Kind == 0)
+			pData[i] = Random();
+		else if(Kind == 1)
+			pData[i] = r < 12 ? 0 : Random();
+		else
+			pData[i] = r < 10 ? 0 : r < 13 ? Random()%8 : Random();
+	}
+}
+
+static void HuffmanCheckCompress(const unsigned char *pInput, int Size)
+{
+	static unsigned char s_aRef[MAX_HUFFMAN_OUTPUT];
+	static unsigned char s_aOut[MAX_HUFFMAN_OUTPUT];
+	int Full = gs_RefHuffman.Compress(pInput, Size, s_aRef, sizeof(s_aRef));
+
+	// also output buffers that are just too small or just large enough
+	const int aOutputSizes[] = { (int)sizeof(s_aRef), Full+1, Full, Full-1, Full-2, Full-4, Full-5, 5, 2, 1 };
+	for(unsigned i = 0; i < sizeof(aOutputSizes)/sizeof(aOutputSizes[0]); i++)
+	{
+		int OutputSize = aOutputSizes[i];
+		if(OutputSize < 1)
+			continue;
+		int Expected = gs_RefHuffman.Compress(pInput, Size, s_aRef, OutputSize);
+		int Got = gs_Huffman.Compress(pInput, Size, s_aOut, OutputSize);
+		Compare("huffman compress", Size, OutputSize, Got, Expected, s_aOut, s_aRef);
+	}
+}
+
+// broken input decodes zero bits once it ran out of input, until the output is full
+static void HuffmanCheckDecompress(const unsigned char *pInput, int Size, int MaxOutput, bool AllOutputSizes)
+{
+	static unsigned char s_aRef[MAX_HUFFMAN_OUTPUT];
+	static unsigned char s_aOut[MAX_HUFFMAN_OUTPUT];
+	const int aOutputSizes[] = { MaxOutput, Size*8, Size, Size/2, 3, 1, 0 };
+	for(unsigned i = 0; i < (AllOutputSizes ? sizeof(aOutputSizes)/sizeof(aOutputSizes[0]) : 1); i++)
+	{
+		int OutputSize = min(aOutputSizes[i], MaxOutput);
+		int Expected = gs_RefHuffman.Decompress(pInput, Size, s_aRef, OutputSize);
+		int Got = gs_Huffman.Decompress(pInput, Size, s_aOut, OutputSize);
+		Compare("huffman decompress", Size, OutputSize, Got, Expected, s_aOut, s_aRef);
+	}
+}
+
+static void HuffmanCheckRoundTrip(const unsigned char *pInput, int Size)
+{
+	static unsigned char s_aPacked[MAX_HUFFMAN_OUTPUT];
+	static unsigned char s_aUnpacked[MAX_HUFFMAN_OUTPUT];
+	int Packed = gs_Huffman.Compress(pInput, Size, s_aPacked, sizeof(s_aPacked));
+	int Unpacked = gs_Huffman.Decompress(s_aPacked, Packed, s_aUnpacked, sizeof(s_aUnpacked));
+	Compare("huffman round trip", Size, Packed, Unpacked, Size, s_aUnpacked, pInput);
+}
+
+static void HuffmanRunChecks(const char *pTable)
+{
+	unsigned char aInput[MAX_HUFFMAN_INPUT];
+	unsigned char aPacked[MAX_HUFFMAN_OUTPUT];
+	int NumChecks = gs_NumChecks;
+	mem_zero(aInput, sizeof(aInput));
+
+	// every input of up to 2 bytes, with every truncation of the 1 byte ones
+	HuffmanCheckCompress(aInput, 0);
+	HuffmanCheckRoundTrip(aInput, 0);
+	for(int a = 0; a < 256; a++)
+	{
+		aInput[0] = a;
+		HuffmanCheckCompress(aInput, 1);
+		HuffmanCheckRoundTrip(aInput, 1);
+		int Packed = gs_Huffman.Compress(aInput, 1, aPacked, sizeof(aPacked));
+		for(int t = 0; t <= Packed; t++)
+			HuffmanCheckDecompress(aPacked, t, MAX_HUFFMAN_OUTPUT, true);
+
+		for(int b = 0; b < 256; b++)
+		{
+			aInput[1] = b;
+			HuffmanCheckCompress(aInput, 2);
+			HuffmanCheckRoundTrip(aInput, 2);
+			Packed = gs_Huffman.Compress(aInput, 2, aPacked, sizeof(aPacked));
+			HuffmanCheckDecompress(aPacked, Packed, MAX_HUFFMAN_OUTPUT, true);
+			HuffmanCheckDecompress(aPacked, Packed-1, MAX_HUFFMAN_OUTPUT, true);
+		}
+	}
+
+	// every stream of up to 3 bytes, most of them are broken
+	for(int i = 0; i < (1<<24); i++)
+	{
+		aInput[0] = i;
+		aInput[1] = i>>8;
+		aInput[2] = i>>16;
+		if(i < (1<<16))
+		{
+			HuffmanCheckDecompress(aInput, 1, 64, i < 256);
+			HuffmanCheckDecompress(aInput, 2, 64, true);
+		}
+		HuffmanCheckDecompress(aInput, 3, 64, false);
+	}
+
+	// random data up to the packet size, also truncated, with a flipped bit or just garbage
+	for(int i = 0; i < 100000; i++)
+	{
+		int Size = Random()%(i < 50000 ? 64 : MAX_HUFFMAN_INPUT+1);
+		HuffmanGenerate(aInput, Size, Random()%3);
+		HuffmanCheckCompress(aInput, Size);
+		HuffmanCheckRoundTrip(aInput, Size);
+
+		int Packed = gs_RefHuffman.Compress(aInput, Size, aPacked, sizeof(aPacked));
+		HuffmanCheckDecompress(aPacked, Packed, MAX_HUFFMAN_OUTPUT, true);
+		HuffmanCheckDecompress(aPacked, Random()%(Packed+1), MAX_HUFFMAN_OUTPUT, true);
+		aPacked[Random()%Packed] ^= 1<<(Random()%8);
+		HuffmanCheckDecompress(aPacked, Packed, MAX_HUFFMAN_OUTPUT, true);
+		HuffmanGenerate(aPacked, Size, 0);
+		HuffmanCheckDecompress(aPacked, Size, MAX_HUFFMAN_OUTPUT, true);
+	}
+
+	dbg_msg("compression_test", "huffman with the %s table: %d checks", pTable, gs_NumChecks-NumChecks);
+}
+
+template<class T>
+static void HuffmanTime(T *pHuffman, const unsigned char *pInput, int Size, const unsigned char *pPacked, int PackedSize, double *pCompress, double *pDecompress)
+{
+	enum { ROUNDS=10, ITERATIONS=20000 };
+	static unsigned char s_aOut[MAX_HUFFMAN_OUTPUT];
+	*pCompress = *pDecompress = 1e9;
+	for(int r = 0; r < ROUNDS; r++)
+	{
+		int64 Start = time_get();
+		for(int i = 0; i < ITERATIONS; i++)
+			pHuffman->Compress(pInput, Size, s_aOut, sizeof(s_aOut));
+		TakeBest(pCompress, Start, ITERATIONS);
+		Start = time_get();
+		for(int i = 0; i < ITERATIONS; i++)
+			pHuffman->Decompress(pPacked, PackedSize, s_aOut, sizeof(s_aOut));
+		TakeBest(pDecompress, Start, ITERATIONS);
+	}
+}
+
+static void HuffmanBenchmark()
+{
+	static const char *s_apKinds[] = { "random", "zeros", "snapshot" };
+	unsigned char aInput[MAX_HUFFMAN_INPUT];
+	unsigned char aPacked[MAX_HUFFMAN_OUTPUT];
+	for(int k = 0; k < 3; k++)
+	{
+		HuffmanGenerate(aInput, MAX_HUFFMAN_INPUT, k);
+		int Packed = gs_Huffman.Compress(aInput, MAX_HUFFMAN_INPUT, aPacked, sizeof(aPacked));
+		double RefCompress, RefDecompress, Compress, Decompress;
+		HuffmanTime(&gs_RefHuffman, aInput, MAX_HUFFMAN_INPUT, aPacked, Packed, &RefCompress, &RefDecompress);
+		HuffmanTime(&gs_Huffman, aInput, MAX_HUFFMAN_INPUT, aPacked, Packed, &Compress, &Decompress);
+		dbg_msg("compression_test", "huffman %-8s %d->%d bytes  compress %.0fns (reference %.0fns)  decompress %.0fns (reference %.0fns)",
+			s_apKinds[k], MAX_HUFFMAN_INPUT, Packed, Compress, RefCompress, Decompress, RefDecompress);
+	}
+}
+
+enum
+{
+	MAX_VARINT_INTS=2048,
+	// broken input makes Unpack read up to 4 bytes past the end, keep them in the buffers
+	MAX_VARINT_BYTES=MAX_VARINT_INTS*5+8,
+};
+
+// 0 snapshot delta like: mostly zeros and small numbers, 1 random, 2 random bit lengths
+static int VarIntGenerate(int Kind)
+{
+	int r = Random()%100;
+	if(Kind == 0)
+		return r < 70 ? 0 : r < 90 ? (int)(Random()%128)-64 : (int)(Random()%16384)-8192;
+	if(Kind == 1)
+		return (int)(Random()<<8)^Random();
+	int Bits = Random()%33;
+	int Value = Bits == 32 ? (int)((Random()<<8)^Random()) : (int)(Random()&((1u<<Bits)-1));
+	return Random()&1 ? Value : ~Value;
+}
+
+// Compress has to give the same as Pack for every int, with room for the longest one left
+static void VarIntCheckCompress(const int *pInput, int Num, int OutputSize)
+{
+	static unsigned char s_aRef[MAX_VARINT_BYTES];
+	static unsigned char s_aOut[MAX_VARINT_BYTES];
+	unsigned char *pRef = s_aRef;
+	long Expected = 0;
+	for(int i = 0; i < Num && Expected >= 0; i++)
+	{
+		if(s_aRef+OutputSize-pRef < 6)
+			Expected = -1;
+		else
+			pRef = CVariableInt::Pack(pRef, pInput[i]);
+	}
+	if(Expected == 0)
+		Expected = pRef-s_aRef;
+	long Got = CVariableInt::Compress(pInput, Num*4, s_aOut, OutputSize);
+	Compare("varint compress", Num*4, OutputSize, Got, Expected, s_aOut, s_aRef);
+}
+
+// Decompress has to give the same as Unpack until the input ends or the output is full
+static void VarIntCheckDecompress(const unsigned char *pInput, int Size, int OutputSize)
+{
+	static int s_aRef[MAX_VARINT_INTS];
+	static int s_aOut[MAX_VARINT_INTS];
+	const unsigned char *pSrc = pInput;
+	long Expected = 0;
+	int Num = 0;
+	while(pSrc < pInput+Size)
+	{
+		if(Num >= OutputSize/4)
+		{
+			Expected = -1;
+			break;
+		}
+		pSrc = CVariableInt::Unpack(pSrc, &s_aRef[Num++]);
+	}
+	if(Expected == 0)
+		Expected = Num*4;
+	long Got = CVariableInt::Decompress(pInput, Size, s_aOut, OutputSize);
+	Compare("varint decompress", Size, OutputSize, Got, Expected, s_aOut, s_aRef);
+}
+
+static void VarIntCheckRoundTrip(const int *pInput, int Num)
+{
+	static unsigned char s_aPacked[MAX_VARINT_BYTES];
+	static int s_aUnpacked[MAX_VARINT_INTS];
+	long Packed = CVariableInt::Compress(pInput, Num*4, s_aPacked, sizeof(s_aPacked));
+	long Unpacked = CVariableInt::Decompress(s_aPacked, Packed, s_aUnpacked, sizeof(s_aUnpacked));
+	Compare("varint round trip", Num*4, (int)Packed, Unpacked, Num*4, s_aUnpacked, pInput);
+}
+
+static void VarIntRunChecks()
+{
+	static int s_aInput[MAX_VARINT_INTS];
+	static unsigned char s_aPacked[MAX_VARINT_BYTES];
+	int NumChecks = gs_NumChecks;
+
+	// every int of up to 3 bytes and the ints around every power of two, each one packs
+	// into 1 byte for 6 bits and 1 more for every 7 bits after that
+	for(int i = -(1<<20); i < (1<<20); i++)
+	{
+		s_aInput[0] = i;
+		VarIntCheckCompress(s_aInput, 1, 6);
+		VarIntCheckRoundTrip(s_aInput, 1);
+		unsigned Value = i^(i>>31);
+		long Expected = Value < (1<<6) ? 1 : Value < (1<<13) ? 2 : 3;
+		long Got = CVariableInt::Pack(s_aPacked, i)-s_aPacked;
+		Compare("varint size", 4, 6, Got, Expected, &Got, &Expected);
+	}
+	for(int b = 20; b < 32; b++)
+	{
+		for(int d = -2; d <= 2; d++)
+		{
+			s_aInput[0] = (int)(1u<<b)+d;
+			s_aInput[1] = ~s_aInput[0];
+			VarIntCheckCompress(s_aInput, 2, MAX_VARINT_BYTES);
+			VarIntCheckRoundTrip(s_aInput, 2);
+		}
+	}
+
+	// every stream of up to 3 bytes, with room for 0 to 3 ints
+	mem_zero(s_aPacked, sizeof(s_aPacked));
+	for(int i = 0; i < (1<<24); i++)
+	{
+		s_aPacked[0] = i;
+		s_aPacked[1] = i>>8;
+		s_aPacked[2] = i>>16;
+		if(i < (1<<16))
+		{
+			for(int o = 0; o <= 8; o += 4)
+			{
+				if(i < (1<<8))
+					VarIntCheckDecompress(s_aPacked, 1, o);
+				VarIntCheckDecompress(s_aPacked, 2, o);
+			}
+		}
+		VarIntCheckDecompress(s_aPacked, 3, 12);
+	}
+
+	// random arrays with too small buffers, then their output truncated or as garbage
+	for(int i = 0; i < 300000; i++)
+	{
+		int Num = Random()%(i%10 == 0 ? MAX_VARINT_INTS : 80);
+		int Kind = Random()%3;
+		for(int n = 0; n < Num; n++)
+			s_aInput[n] = VarIntGenerate(Kind);
+
+		const int aOutputSizes[] = { MAX_VARINT_BYTES, (int)(Random()%(Num*6+20)), Num+12, Num*2, 5, 0 };
+		for(unsigned s = 0; s < sizeof(aOutputSizes)/sizeof(aOutputSizes[0]); s++)
+			VarIntCheckCompress(s_aInput, Num, aOutputSizes[s]);
+		VarIntCheckRoundTrip(s_aInput, Num);
+
+		mem_zero(s_aPacked, sizeof(s_aPacked));
+		int Packed = (int)CVariableInt::Compress(s_aInput, Num*4, s_aPacked, sizeof(s_aPacked));
+		for(int v = 0; v < 4; v++)
+		{
+			int Size = Packed;
+			if(v == 1)
+				Size = Random()%(Packed+1);
+			else if(v >= 2)
+			{
+				// plain garbage, then garbage of mostly single byte ints
+				Size = Random()%200;
+				for(int n = 0; n < Size; n++)
+					s_aPacked[n] = v == 2 || !(Random()&0x3ff) ? Random() : Random()&0x7f;
+			}
+
+			const int aOutputSizes[] = { (int)sizeof(int)*MAX_VARINT_INTS, Num*4, (int)(Random()%(Num*4+8)), 4, 0 };
+			for(unsigned s = 0; s < sizeof(aOutputSizes)/sizeof(aOutputSizes[0]); s++)
+				VarIntCheckDecompress(s_aPacked, Size, aOutputSizes[s]);
+		}
+	}
+
+	dbg_msg("compression_test", "varint: %d checks", gs_NumChecks-NumChecks);
+}
+
+static void VarIntBenchmark()
+{
+	enum { ROUNDS=9, ITERATIONS=5000 };
+	static const char *s_apKinds[] = { "delta", "random", "mixed" };
+	static int s_aInput[MAX_VARINT_INTS];
+	static int s_aOutput[MAX_VARINT_INTS];
+	static unsigned char s_aPacked[MAX_VARINT_BYTES];
+	for(int k = 0; k < 3; k++)
+	{
+		for(int i = 0; i < MAX_VARINT_INTS; i++)
+			s_aInput[i] = VarIntGenerate(k);
+		long Packed = CVariableInt::Compress(s_aInput, sizeof(s_aInput), s_aPacked, sizeof(s_aPacked));
+
+		double Compress = 1e9, Decompress = 1e9;
+		for(int r = 0; r < ROUNDS; r++)
+		{
+			int64 Start = time_get();
+			for(int i = 0; i < ITERATIONS; i++)
+				CVariableInt::Compress(s_aInput, sizeof(s_aInput), s_aPacked, sizeof(s_aPacked));
+			TakeBest(&Compress, Start, ITERATIONS);
+			Start = time_get();
+			for(int i = 0; i < ITERATIONS; i++)
+				CVariableInt::Decompress(s_aPacked, Packed, s_aOutput, sizeof(s_aOutput));
+			TakeBest(&Decompress, Start, ITERATIONS);
+		}
+		dbg_msg("compression_test", "varint %-6s %d ints->%ld bytes  compress %.0fns  decompress %.0fns",
+			s_apKinds[k], (int)MAX_VARINT_INTS, Packed, Compress, Decompress);
+	}
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	// a flat table where all codes are 8 or 9 bits and the skewed one of the network
+	unsigned aFlatTable[256];
+	for(int i = 0; i < 256; i++)
+		aFlatTable[i] = 1;
+
+	gs_Huffman.Init(aFlatTable);
+	gs_RefHuffman.Init(aFlatTable);
+	HuffmanRunChecks("flat");
+
+	gs_Huffman.Init(gs_aNetFreqTable);
+	gs_RefHuffman.Init(gs_aNetFreqTable);
+	HuffmanRunChecks("network");
+
+	VarIntRunChecks();
+
+	if(gs_NumFailures)
+	{
+		dbg_msg("compression_test", "%d of %d checks failed", gs_NumFailures, gs_NumChecks);
+		return 1;
+	}
+	dbg_msg("compression_test", "all passed");
+
+	if(argc < 2 || str_comp(argv[1], "-n") != 0) // ignore_convention
+	{
+		HuffmanBenchmark();
+		VarIntBenchmark();
+	}
+	return 0;
+}
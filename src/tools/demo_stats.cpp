@@ -0,0 +1,477 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/array.h>
+
+#include <engine/console.h>
+#include <engine/kernel.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+#include <engine/shared/demo.h>
+#include <engine/shared/jobs.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/snapshot.h>
+
+#include <game/gamecore.h>
+#include <game/version.h>
+#include <generated/protocol.h>
+
+// plays server demos without a client, one demo per job, and sums up what every player did.
+// writes two tab separated tables to the save directory: one row per player and one row per
+// player and heatmap cell. players are told apart by their name
+
+enum
+{
+	HEATMAP_SIZE=128,
+};
+
+static IStorage *s_pStorage = 0;
+static IConsole *s_pConsole = 0;
+static LOCK s_LoadLock = 0;
+static int s_CellTiles = 4;
+
+struct CPlayerStats
+{
+	char m_aName[MAX_NAME_LENGTH];
+	int m_Demos;
+	int m_Kills;
+	int m_Deaths;
+	int m_Suicides;
+	int m_aKills[NUM_WEAPONS];
+	int m_aShots[NUM_WEAPONS];
+	int m_DamageTaken; // health and armor of the damage events, the game caps them at 9 each
+	int m_SelfDamage;
+	int m_Chat;
+	int *m_pHeatmap; // position samples in cells of s_CellTiles tiles, allocated with the first one
+};
+
+class CStatsList
+{
+public:
+	array<CPlayerStats *> m_lpPlayers;
+
+	~CStatsList() { Clear(); }
+
+	void Clear()
+	{
+		for(int i = 0; i < m_lpPlayers.size(); i++)
+		{
+			mem_free(m_lpPlayers[i]->m_pHeatmap);
+			delete m_lpPlayers[i];
+		}
+		m_lpPlayers.clear();
+	}
+
+	CPlayerStats *Find(const char *pName)
+	{
+		for(int i = 0; i < m_lpPlayers.size(); i++)
+			if(str_comp(m_lpPlayers[i]->m_aName, pName) == 0)
+				return m_lpPlayers[i];
+
+		CPlayerStats *pStats = new CPlayerStats;
+		mem_zero(pStats, sizeof(*pStats));
+		str_copy(pStats->m_aName, pName, sizeof(pStats->m_aName));
+		m_lpPlayers.add(pStats);
+		return pStats;
+	}
+
+	void Merge(const CStatsList *pOther)
+	{
+		for(int i = 0; i < pOther->m_lpPlayers.size(); i++)
+		{
+			const CPlayerStats *pFrom = pOther->m_lpPlayers[i];
+			CPlayerStats *pTo = Find(pFrom->m_aName);
+			pTo->m_Demos += pFrom->m_Demos;
+			pTo->m_Kills += pFrom->m_Kills;
+			pTo->m_Deaths += pFrom->m_Deaths;
+			pTo->m_Suicides += pFrom->m_Suicides;
+			for(int w = 0; w < NUM_WEAPONS; w++)
+			{
+				pTo->m_aKills[w] += pFrom->m_aKills[w];
+				pTo->m_aShots[w] += pFrom->m_aShots[w];
+			}
+			pTo->m_DamageTaken += pFrom->m_DamageTaken;
+			pTo->m_SelfDamage += pFrom->m_SelfDamage;
+			pTo->m_Chat += pFrom->m_Chat;
+			if(pFrom->m_pHeatmap)
+			{
+				if(!pTo->m_pHeatmap)
+				{
+					pTo->m_pHeatmap = (int *)mem_alloc(HEATMAP_SIZE*HEATMAP_SIZE*sizeof(int), 1);
+					mem_zero(pTo->m_pHeatmap, HEATMAP_SIZE*HEATMAP_SIZE*sizeof(int));
+				}
+				for(int c = 0; c < HEATMAP_SIZE*HEATMAP_SIZE; c++)
+					pTo->m_pHeatmap[c] += pFrom->m_pHeatmap[c];
+			}
+		}
+	}
+};
+
+class CDemoStats : public CDemoPlayer::IListner
+{
+	CNetObjHandler m_NetObjHandler;
+	CStatsList *m_pStats;
+	CPlayerStats *m_apClients[MAX_CLIENTS];
+	int m_aLastAttackTick[MAX_CLIENTS];
+	int m_LastSnapshotSize;
+	int m_LastSnapshotCrc;
+
+	void OnCharacter(int ClientID, const CNetObj_Character *pChar)
+	{
+		CPlayerStats *pStats = m_apClients[ClientID];
+
+		// every attack gets a new attack tick
+		if(pChar->m_AttackTick > m_aLastAttackTick[ClientID] && m_aLastAttackTick[ClientID] != -1 &&
+			pChar->m_Weapon >= 0 && pChar->m_Weapon < NUM_WEAPONS)
+			pStats->m_aShots[pChar->m_Weapon]++;
+		m_aLastAttackTick[ClientID] = pChar->m_AttackTick;
+
+		if(!pStats->m_pHeatmap)
+		{
+			pStats->m_pHeatmap = (int *)mem_alloc(HEATMAP_SIZE*HEATMAP_SIZE*sizeof(int), 1);
+			mem_zero(pStats->m_pHeatmap, HEATMAP_SIZE*HEATMAP_SIZE*sizeof(int));
+		}
+		int CellSize = s_CellTiles*32;
+		int x = clamp(pChar->m_X/CellSize, 0, HEATMAP_SIZE-1);
+		int y = clamp(pChar->m_Y/CellSize, 0, HEATMAP_SIZE-1);
+		pStats->m_pHeatmap[y*HEATMAP_SIZE+x]++;
+	}
+
+public:
+	CDemoStats(CStatsList *pStats)
+	{
+		m_pStats = pStats;
+		mem_zero(m_apClients, sizeof(m_apClients));
+		for(int i = 0; i < MAX_CLIENTS; i++)
+			m_aLastAttackTick[i] = -1;
+		m_LastSnapshotSize = -1;
+		m_LastSnapshotCrc = 0;
+	}
+
+	virtual void OnDemoPlayerSnapshot(void *pData, int Size)
+	{
+		CSnapshot *pSnap = (CSnapshot *)pData;
+
+		// ticks without a snapshot get the last one again, its events already got counted
+		int Crc = pSnap->Crc();
+		bool Repeated = Size == m_LastSnapshotSize && Crc == m_LastSnapshotCrc;
+		m_LastSnapshotSize = Size;
+		m_LastSnapshotCrc = Crc;
+
+		// the names first, the client infos come after the objects that need them
+		for(int i = 0; i < pSnap->NumItems(); i++)
+		{
+			CSnapshotItem *pItem = pSnap->GetItem(i);
+			if(pItem->Type() != NETOBJTYPE_DE_CLIENTINFO || pItem->ID() >= MAX_CLIENTS ||
+				m_NetObjHandler.ValidateObj(pItem->Type(), pItem->Data(), pSnap->GetItemSize(i)) != 0)
+				continue;
+
+			const CNetObj_De_ClientInfo *pInfo = (const CNetObj_De_ClientInfo *)pItem->Data();
+			char aName[MAX_NAME_LENGTH];
+			IntsToStr(pInfo->m_aName, 4, aName);
+			if(!m_apClients[pItem->ID()] || str_comp(m_apClients[pItem->ID()]->m_aName, aName) != 0)
+			{
+				m_apClients[pItem->ID()] = m_pStats->Find(aName);
+				m_apClients[pItem->ID()]->m_Demos = 1;
+				m_aLastAttackTick[pItem->ID()] = -1;
+			}
+		}
+
+		for(int i = 0; i < pSnap->NumItems(); i++)
+		{
+			CSnapshotItem *pItem = pSnap->GetItem(i);
+			int Type = pItem->Type();
+			if((Type != NETOBJTYPE_CHARACTER && (Type != NETEVENTTYPE_DAMAGE || Repeated)) ||
+				m_NetObjHandler.ValidateObj(Type, pItem->Data(), pSnap->GetItemSize(i)) != 0)
+				continue;
+
+			if(Type == NETOBJTYPE_CHARACTER)
+			{
+				if(pItem->ID() < MAX_CLIENTS && m_apClients[pItem->ID()])
+					OnCharacter(pItem->ID(), (const CNetObj_Character *)pItem->Data());
+			}
+			else
+			{
+				const CNetEvent_Damage *pEvent = (const CNetEvent_Damage *)pItem->Data();
+				if(pEvent->m_ClientID >= 0 && pEvent->m_ClientID < MAX_CLIENTS && m_apClients[pEvent->m_ClientID])
+				{
+					CPlayerStats *pStats = m_apClients[pEvent->m_ClientID];
+					pStats->m_DamageTaken += pEvent->m_HealthAmount+pEvent->m_ArmorAmount;
+					if(pEvent->m_Self)
+						pStats->m_SelfDamage += pEvent->m_HealthAmount+pEvent->m_ArmorAmount;
+				}
+			}
+		}
+	}
+
+	virtual void OnDemoPlayerMessage(void *pData, int Size)
+	{
+		CUnpacker Unpacker;
+		Unpacker.Reset(pData, Size);
+
+		// unpack msgid and system flag
+		int Msg = Unpacker.GetInt();
+		int Sys = Msg&1;
+		Msg >>= 1;
+
+		if(Unpacker.Error() || Sys || (Msg != NETMSGTYPE_SV_KILLMSG && Msg != NETMSGTYPE_SV_CHAT))
+			return;
+
+		void *pRawMsg = m_NetObjHandler.SecureUnpackMsg(Msg, &Unpacker);
+		if(!pRawMsg)
+			return;
+
+		if(Msg == NETMSGTYPE_SV_KILLMSG)
+		{
+			const CNetMsg_Sv_KillMsg *pMsg = (const CNetMsg_Sv_KillMsg *)pRawMsg;
+			CPlayerStats *pVictim = pMsg->m_Victim >= 0 && pMsg->m_Victim < MAX_CLIENTS ? m_apClients[pMsg->m_Victim] : 0;
+			CPlayerStats *pKiller = pMsg->m_Killer >= 0 && pMsg->m_Killer < MAX_CLIENTS ? m_apClients[pMsg->m_Killer] : 0;
+			if(pVictim)
+				pVictim->m_Deaths++;
+			if(pKiller && pMsg->m_Killer == pMsg->m_Victim)
+				pKiller->m_Suicides++;
+			else if(pKiller)
+			{
+				pKiller->m_Kills++;
+				if(pMsg->m_Weapon >= 0 && pMsg->m_Weapon < NUM_WEAPONS)
+					pKiller->m_aKills[pMsg->m_Weapon]++;
+			}
+		}
+		else
+		{
+			const CNetMsg_Sv_Chat *pMsg = (const CNetMsg_Sv_Chat *)pRawMsg;
+			if(pMsg->m_ClientID >= 0 && pMsg->m_ClientID < MAX_CLIENTS && m_apClients[pMsg->m_ClientID])
+				m_apClients[pMsg->m_ClientID]->m_Chat++;
+		}
+	}
+};
+
+struct CDemoJob
+{
+	char m_aFilename[512];
+	CJob m_Job;
+	CStatsList m_Stats;
+	int m_Ticks;
+	bool m_Error;
+};
+
+static int DemoJob(void *pData)
+{
+	CDemoJob *pJob = (CDemoJob *)pData;
+	CNetObjHandler NetObjHandler;
+	CSnapshotDelta SnapshotDelta;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		SnapshotDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	CDemoPlayer *pPlayer = new CDemoPlayer(&SnapshotDelta);
+	CDemoStats Stats(&pJob->m_Stats);
+	pPlayer->SetListner(&Stats);
+
+	// loading writes the map of the demo to the downloaded maps
+	lock_wait(s_LoadLock);
+	const char *pError = pPlayer->Load(s_pStorage, s_pConsole, pJob->m_aFilename, IStorage::TYPE_ALL, GAME_NETVERSION);
+	lock_unlock(s_LoadLock);
+
+	if(!pError && pPlayer->GetDemoType() != IDemoPlayer::DEMOTYPE_SERVER)
+	{
+		dbg_msg("demo_stats", "'%s' is not a server demo", pJob->m_aFilename);
+		pError = "";
+	}
+
+	pJob->m_Error = pError != 0;
+	if(!pError)
+	{
+		// as fast as it reads, the player pauses at the end
+		while(pPlayer->IsPlaying() && !pPlayer->BaseInfo()->m_Paused)
+			pPlayer->NextFrame();
+		pJob->m_Ticks = pPlayer->BaseInfo()->m_CurrentTick-pPlayer->BaseInfo()->m_FirstTick;
+		pPlayer->Stop();
+	}
+
+	delete pPlayer;
+	return 0;
+}
+
+static array<CDemoJob *> s_lpJobs;
+
+static void AddDemo(const char *pFilename)
+{
+	CDemoJob *pJob = new CDemoJob;
+	str_copy(pJob->m_aFilename, pFilename, sizeof(pJob->m_aFilename));
+	pJob->m_Ticks = 0;
+	pJob->m_Error = false;
+	s_lpJobs.add(pJob);
+}
+
+static int DemolistCallback(const char *pName, int IsDir, int DirType, void *pUser)
+{
+	int Length = str_length(pName);
+	if(IsDir || Length < 5 || str_comp(pName+Length-5, ".demo") != 0)
+		return 0;
+
+	char aBuf[512];
+	str_format(aBuf, sizeof(aBuf), "%s/%s", (const char *)pUser, pName);
+	AddDemo(aBuf);
+	return 0;
+}
+
+static bool WriteTables(const char *pPrefix, CStatsList *pStats)
+{
+	static const char *s_apWeapons[NUM_WEAPONS] = {"hammer", "gun", "shotgun", "grenade", "laser", "ninja"};
+	char aFilename[128];
+	char aBuf[1024];
+	char aColumn[32];
+
+	// the players
+	str_format(aFilename, sizeof(aFilename), "%s_players.tsv", pPrefix);
+	IOHANDLE File = s_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE, aBuf, sizeof(aBuf));
+	if(!File)
+	{
+		dbg_msg("demo_stats", "failed to open '%s' for writing", aFilename);
+		return false;
+	}
+	dbg_msg("demo_stats", "writing '%s'", aBuf);
+
+	str_copy(aBuf, "name\tdemos\tkills\tdeaths\tsuicides", sizeof(aBuf));
+	for(int w = 0; w < NUM_WEAPONS; w++)
+	{
+		str_format(aColumn, sizeof(aColumn), "\tkills_%s", s_apWeapons[w]);
+		str_append(aBuf, aColumn, sizeof(aBuf));
+	}
+	for(int w = 0; w < NUM_WEAPONS; w++)
+	{
+		str_format(aColumn, sizeof(aColumn), "\tshots_%s", s_apWeapons[w]);
+		str_append(aBuf, aColumn, sizeof(aBuf));
+	}
+	str_append(aBuf, "\tdamage_taken\tself_damage\tchat\n", sizeof(aBuf));
+	io_write(File, aBuf, str_length(aBuf));
+
+	for(int i = 0; i < pStats->m_lpPlayers.size(); i++)
+	{
+		const CPlayerStats *pPlayer = pStats->m_lpPlayers[i];
+		str_format(aBuf, sizeof(aBuf), "%s\t%d\t%d\t%d\t%d", pPlayer->m_aName, pPlayer->m_Demos, pPlayer->m_Kills, pPlayer->m_Deaths, pPlayer->m_Suicides);
+		for(int w = 0; w < NUM_WEAPONS; w++)
+		{
+			str_format(aColumn, sizeof(aColumn), "\t%d", pPlayer->m_aKills[w]);
+			str_append(aBuf, aColumn, sizeof(aBuf));
+		}
+		for(int w = 0; w < NUM_WEAPONS; w++)
+		{
+			str_format(aColumn, sizeof(aColumn), "\t%d", pPlayer->m_aShots[w]);
+			str_append(aBuf, aColumn, sizeof(aBuf));
+		}
+		str_format(aColumn, sizeof(aColumn), "\t%d\t%d\t%d\n", pPlayer->m_DamageTaken, pPlayer->m_SelfDamage, pPlayer->m_Chat);
+		str_append(aBuf, aColumn, sizeof(aBuf));
+		io_write(File, aBuf, str_length(aBuf));
+	}
+	io_close(File);
+
+	// the heatmap, only the cells with samples
+	str_format(aFilename, sizeof(aFilename), "%s_heatmap.tsv", pPrefix);
+	File = s_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE, aBuf, sizeof(aBuf));
+	if(!File)
+	{
+		dbg_msg("demo_stats", "failed to open '%s' for writing", aFilename);
+		return false;
+	}
+	dbg_msg("demo_stats", "writing '%s'", aBuf);
+
+	str_copy(aBuf, "name\ttile_x\ttile_y\tsamples\n", sizeof(aBuf));
+	io_write(File, aBuf, str_length(aBuf));
+	for(int i = 0; i < pStats->m_lpPlayers.size(); i++)
+	{
+		const CPlayerStats *pPlayer = pStats->m_lpPlayers[i];
+		if(!pPlayer->m_pHeatmap)
+			continue;
+		for(int c = 0; c < HEATMAP_SIZE*HEATMAP_SIZE; c++)
+		{
+			if(!pPlayer->m_pHeatmap[c])
+				continue;
+			str_format(aBuf, sizeof(aBuf), "%s\t%d\t%d\t%d\n", pPlayer->m_aName,
+				(c%HEATMAP_SIZE)*s_CellTiles, (c/HEATMAP_SIZE)*s_CellTiles, pPlayer->m_pHeatmap[c]);
+			io_write(File, aBuf, str_length(aBuf));
+		}
+	}
+	io_close(File);
+	return true;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	IKernel *pKernel = IKernel::Create();
+	s_pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, argc, argv);
+	s_pConsole = CreateConsole(CFGFLAG_SERVER);
+
+	bool RegisterFail = !pKernel->RegisterInterface(s_pStorage);
+	RegisterFail |= !pKernel->RegisterInterface(s_pConsole);
+
+	if(RegisterFail)
+		return -1;
+
+	int NumThreads = thread_num_cpus();
+	const char *pPrefix = "demo_stats";
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-j") == 0 && i+1 < argc) // ignore_convention
+			NumThreads = str_toint(argv[++i]); // ignore_convention
+		else if(str_comp(argv[i], "-c") == 0 && i+1 < argc) // ignore_convention
+			s_CellTiles = max(1, str_toint(argv[++i])); // ignore_convention
+		else if(str_comp(argv[i], "-o") == 0 && i+1 < argc) // ignore_convention
+			pPrefix = argv[++i]; // ignore_convention
+		else
+		{
+			// a directory adds all the demos in it
+			int Length = str_length(argv[i]); // ignore_convention
+			if(Length >= 5 && str_comp(argv[i]+Length-5, ".demo") == 0) // ignore_convention
+				AddDemo(argv[i]); // ignore_convention
+			else
+				s_pStorage->ListDirectory(IStorage::TYPE_ALL, argv[i], DemolistCallback, (void *)argv[i]); // ignore_convention
+		}
+	}
+
+	if(!s_lpJobs.size())
+	{
+		dbg_msg("usage", "%s [-j threads] [-c heatmap cell size in tiles] [-o output prefix] demos or directories with demos", argv[0]); // ignore_convention
+		return -1;
+	}
+
+	CNetBase::Init();
+	s_LoadLock = lock_create();
+	CJobPool *pJobPool = new CJobPool;
+	pJobPool->Init(max(1, NumThreads));
+
+	// a few demos ahead of the one being merged, the heatmaps of all demos at once would not fit
+	int64 StartTime = time_get();
+	int Window = max(1, NumThreads)*2;
+	int NumQueued = 0;
+	int NumFailed = 0;
+	int64 Ticks = 0;
+	CStatsList Stats;
+	for(int i = 0; i < s_lpJobs.size(); i++)
+	{
+		for(; NumQueued < min(i+Window, s_lpJobs.size()); NumQueued++)
+			pJobPool->Add(&s_lpJobs[NumQueued]->m_Job, DemoJob, s_lpJobs[NumQueued]);
+
+		CDemoJob *pJob = s_lpJobs[i];
+		pJobPool->WaitFor(&pJob->m_Job);
+		if(pJob->m_Error)
+			NumFailed++;
+		Ticks += pJob->m_Ticks;
+		Stats.Merge(&pJob->m_Stats);
+		delete pJob;
+	}
+	s_lpJobs.clear();
+
+	float Seconds = (time_get()-StartTime)/(float)time_freq();
+	dbg_msg("demo_stats", "%d demos, %d failed, %lld ticks in %.2fs, %d players", NumQueued, NumFailed, Ticks, Seconds, Stats.m_lpPlayers.size());
+
+	bool Written = WriteTables(pPrefix, &Stats);
+
+	delete pJobPool;
+	lock_destroy(s_LoadLock);
+	return Written ? 0 : -1;
+}
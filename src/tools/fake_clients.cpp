@@ -0,0 +1,661 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <math.h>
+
+#include <engine/message.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+
+#include <game/version.h>
+#include <generated/protocol.h>
+
+// connects many clients from one process to a server for load tests. they go through the
+// same handshake as the real client, unpack and ack every snapshot, send inputs every tick
+// and report the round trip time, the snapshot sizes and the lost snapshots
+
+static CSnapshotDelta s_SnapshotDelta;
+static int64 s_PingInterval = 0;
+static const char *s_pPassword = "";
+static const char *s_pAccountPassword = 0;
+static const char *s_pNamePrefix = "load";
+static bool s_DownloadMap = false;
+static bool s_RandomInput = false;
+
+struct CLoadStats
+{
+	int m_Snapshots;
+	int m_EmptySnapshots;
+	int64 m_PackedBytes; // as received, after the huffman stage
+	int64 m_SnapshotBytes; // unpacked
+	int m_MaxPackedSize;
+	int m_LostSnapshots;
+	int m_DeltaErrors;
+	int m_Pings;
+	int64 m_RttSum;
+	int64 m_RttMax;
+
+	void Reset() { mem_zero(this, sizeof(*this)); }
+
+	void Add(const CLoadStats *pOther)
+	{
+		m_Snapshots += pOther->m_Snapshots;
+		m_EmptySnapshots += pOther->m_EmptySnapshots;
+		m_PackedBytes += pOther->m_PackedBytes;
+		m_SnapshotBytes += pOther->m_SnapshotBytes;
+		m_MaxPackedSize = max(m_MaxPackedSize, pOther->m_MaxPackedSize);
+		m_LostSnapshots += pOther->m_LostSnapshots;
+		m_DeltaErrors += pOther->m_DeltaErrors;
+		m_Pings += pOther->m_Pings;
+		m_RttSum += pOther->m_RttSum;
+		m_RttMax = max(m_RttMax, pOther->m_RttMax);
+	}
+};
+
+static CLoadStats s_Stats; // since the last report
+
+class CFakeClient
+{
+public:
+	enum
+	{
+		STATE_OFFLINE=0,
+		STATE_CONNECTING,
+		STATE_LOADING,
+		STATE_READY,
+		STATE_INGAME,
+	};
+
+private:
+	CNetClient m_Net;
+	int m_Index;
+	int m_State;
+	char m_aName[MAX_NAME_LENGTH];
+
+	// map download
+	int m_MapSize;
+	int m_MapAmount;
+	int m_MapChunk;
+	int m_MapChunkNum;
+	int m_MapChunkSize;
+
+	// snapshots
+	CSnapshotStorage m_SnapshotStorage;
+	unsigned char m_aSnapshotIncommingData[CSnapshot::MAX_SIZE];
+	unsigned m_SnapshotParts;
+	int m_CurrentRecvTick;
+	int64 m_CurrentRecvTime;
+	int m_AckGameTick;
+	int m_SnapCrcErrors;
+	int m_LastSnapTick;
+	bool m_LastSnapWasDelta;
+	int m_SnapStep; // ticks between two snapshots, every second tick unless the server has high bandwidth on
+
+	// input
+	CNetObj_PlayerInput m_Input;
+	int m_PredTick;
+	int m_Frame;
+	int m_NextChange;
+	unsigned m_Seed;
+
+	int64 m_PingStartTime;
+	int64 m_NextPing;
+
+	void SendMsg(CMsgPacker *pMsg, int Flags)
+	{
+		CNetChunk Packet;
+		Packet.m_ClientID = 0;
+		Packet.m_pData = pMsg->Data();
+		Packet.m_DataSize = pMsg->Size();
+		Packet.m_Flags = 0;
+		if(Flags&MSGFLAG_VITAL)
+			Packet.m_Flags |= NETSENDFLAG_VITAL;
+		if(Flags&MSGFLAG_FLUSH)
+			Packet.m_Flags |= NETSENDFLAG_FLUSH;
+		m_Net.Send(&Packet);
+	}
+
+	template<class T> void SendGameMsg(T *pMsg)
+	{
+		CMsgPacker Packer(pMsg->MsgID(), false);
+		if(pMsg->Pack(&Packer))
+			return;
+		SendMsg(&Packer, MSGFLAG_VITAL);
+	}
+
+	void SendChat(const char *pText)
+	{
+		CNetMsg_Cl_Say Msg;
+		Msg.m_Mode = CHAT_ALL;
+		Msg.m_Target = -1;
+		Msg.m_pMessage = pText;
+		SendGameMsg(&Msg);
+	}
+
+	int Random(int Num)
+	{
+		m_Seed = m_Seed*1103515245+12345;
+		return (m_Seed>>16)%Num;
+	}
+
+	void MakeInput()
+	{
+		m_Frame++;
+		if(s_RandomInput)
+		{
+			// hold a random input for a random time
+			if(m_Frame < m_NextChange)
+				return;
+			m_NextChange = m_Frame+10+Random(40);
+			m_Input.m_Direction = Random(3)-1;
+			m_Input.m_TargetX = Random(512)-256;
+			m_Input.m_TargetY = Random(512)-256;
+			m_Input.m_Jump = Random(4) == 0;
+			m_Input.m_Hook = Random(3) == 0;
+			if((m_Input.m_Fire&1) || Random(2))
+				m_Input.m_Fire++;
+			if(Random(5) == 0)
+				m_Input.m_WantedWeapon = Random(NUM_WEAPONS-1)+1;
+		}
+		else
+		{
+			// every client runs the same script with its own offset
+			int Frame = m_Frame+m_Index*37;
+			m_Input.m_Direction = (Frame/40)%3-1;
+			m_Input.m_TargetX = (int)(cosf(Frame*0.05f)*100);
+			m_Input.m_TargetY = (int)(sinf(Frame*0.05f)*100);
+			m_Input.m_Jump = Frame%60 < 5;
+			m_Input.m_Hook = Frame%90 < 30;
+			if(Frame%10 == 0)
+				m_Input.m_Fire++;
+			m_Input.m_WantedWeapon = (Frame/100)%(NUM_WEAPONS-1)+1;
+		}
+	}
+
+	void SendInput()
+	{
+		CMsgPacker Msg(NETMSG_INPUT, true);
+		Msg.AddInt(m_AckGameTick);
+		Msg.AddInt(m_PredTick);
+		Msg.AddInt(sizeof(m_Input));
+		for(int i = 0; i < (int)(sizeof(m_Input)/sizeof(int)); i++)
+			Msg.AddInt(((int *)&m_Input)[i]);
+
+		int PingCorrection = 0;
+		int64 TagTime;
+		if(m_SnapshotStorage.Get(m_AckGameTick, &TagTime, 0, 0) >= 0)
+			PingCorrection = (int)(((time_get()-TagTime)*1000)/time_freq());
+		Msg.AddInt(PingCorrection);
+		SendMsg(&Msg, MSGFLAG_FLUSH);
+	}
+
+	void OnMapChange(CUnpacker *pUnpacker)
+	{
+		pUnpacker->GetString(CUnpacker::SANITIZE_CC|CUnpacker::SKIP_START_WHITESPACES);
+		pUnpacker->GetInt(); // crc
+		int MapSize = pUnpacker->GetInt();
+		int MapChunkNum = pUnpacker->GetInt();
+		int MapChunkSize = pUnpacker->GetInt();
+		if(pUnpacker->Error() || MapSize <= 0 || MapChunkNum <= 0 || MapChunkSize <= 0)
+			return;
+
+		m_State = STATE_LOADING;
+		m_SnapshotStorage.PurgeAll();
+		m_SnapshotParts = 0;
+		m_CurrentRecvTick = 0;
+		m_AckGameTick = -1;
+
+		// the map is thrown away, the download only puts the load on the server
+		if(!s_DownloadMap)
+		{
+			CMsgPacker Msg(NETMSG_READY, true);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+			return;
+		}
+
+		m_MapSize = MapSize;
+		m_MapAmount = 0;
+		m_MapChunk = 0;
+		m_MapChunkNum = MapChunkNum;
+		m_MapChunkSize = MapChunkSize;
+		CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA, true);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+	}
+
+	void OnMapData(CUnpacker *pUnpacker)
+	{
+		if(m_State != STATE_LOADING || m_MapAmount >= m_MapSize)
+			return;
+
+		int Size = min(m_MapChunkSize, m_MapSize-m_MapAmount);
+		pUnpacker->GetRaw(Size);
+		if(pUnpacker->Error())
+			return;
+
+		m_MapChunk++;
+		m_MapAmount += Size;
+		if(m_MapAmount == m_MapSize)
+		{
+			CMsgPacker Msg(NETMSG_READY, true);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+		}
+		else if(m_MapChunk%m_MapChunkNum == 0)
+		{
+			CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA, true);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+		}
+	}
+
+	void OnConnectionReady()
+	{
+		CNetMsg_Cl_StartInfo Msg;
+		mem_zero(&Msg, sizeof(Msg));
+		Msg.m_pName = m_aName;
+		Msg.m_pClan = "";
+		Msg.m_Country = -1;
+		for(int p = 0; p < 6; p++)
+		{
+			Msg.m_apSkinPartNames[p] = "standard";
+			Msg.m_aUseCustomColors[p] = 0;
+			Msg.m_aSkinPartColors[p] = 0;
+		}
+		SendGameMsg(&Msg);
+		m_State = STATE_READY;
+	}
+
+	void OnReadyToEnter()
+	{
+		if(m_State != STATE_READY)
+			return;
+
+		CMsgPacker Msg(NETMSG_ENTERGAME, true);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+		m_State = STATE_INGAME;
+
+		if(s_pAccountPassword)
+		{
+			// registering fails for accounts that already exist, the login works then
+			char aBuf[128];
+			str_format(aBuf, sizeof(aBuf), "/register %s %s", m_aName, s_pAccountPassword);
+			SendChat(aBuf);
+			str_format(aBuf, sizeof(aBuf), "/login %s %s", m_aName, s_pAccountPassword);
+			SendChat(aBuf);
+		}
+	}
+
+	void OnSnapshot(int Msg, CUnpacker *pUnpacker)
+	{
+		int NumParts = 1;
+		int Part = 0;
+		int GameTick = pUnpacker->GetInt();
+		int DeltaTick = GameTick-pUnpacker->GetInt();
+		int PartSize = 0;
+		int Crc = 0;
+
+		if(m_State < STATE_LOADING)
+			return;
+
+		if(Msg == NETMSG_SNAP)
+		{
+			NumParts = pUnpacker->GetInt();
+			Part = pUnpacker->GetInt();
+		}
+
+		if(Msg != NETMSG_SNAPEMPTY)
+		{
+			Crc = pUnpacker->GetInt();
+			PartSize = pUnpacker->GetInt();
+		}
+
+		const unsigned char *pData = pUnpacker->GetRaw(PartSize);
+		if(pUnpacker->Error() || NumParts < 1 || NumParts > CSnapshot::MAX_PARTS || Part < 0 || Part >= NumParts || PartSize < 0 || PartSize > MAX_SNAPSHOT_PACKSIZE)
+			return;
+		if(GameTick < m_CurrentRecvTick)
+			return;
+
+		if(GameTick != m_CurrentRecvTick)
+			m_SnapshotParts = 0;
+		mem_copy(m_aSnapshotIncommingData + Part*MAX_SNAPSHOT_PACKSIZE, pData, PartSize);
+		m_SnapshotParts |= 1<<Part;
+		if(m_SnapshotParts != (unsigned)((1<<NumParts)-1))
+		{
+			m_CurrentRecvTick = GameTick;
+			return;
+		}
+		m_SnapshotParts = 0;
+
+		// the server sends deltas at the full rate only, the ones in between got lost
+		if(DeltaTick >= 0 && m_LastSnapWasDelta && GameTick > m_LastSnapTick)
+		{
+			m_SnapStep = min(m_SnapStep, GameTick-m_LastSnapTick);
+			s_Stats.m_LostSnapshots += (GameTick-m_LastSnapTick)/m_SnapStep-1;
+		}
+		m_LastSnapTick = GameTick;
+		m_LastSnapWasDelta = DeltaTick >= 0;
+
+		// find the snapshot the server took as delta
+		static CSnapshot s_EmptySnap;
+		CSnapshot *pDeltaShot = &s_EmptySnap;
+		if(DeltaTick >= 0 && m_SnapshotStorage.Get(DeltaTick, 0, &pDeltaShot, 0) < 0)
+		{
+			// makes the server send a full snapshot
+			s_Stats.m_DeltaErrors++;
+			m_AckGameTick = -1;
+			return;
+		}
+
+		unsigned char aDeltaData[CSnapshot::MAX_SIZE];
+		unsigned char aSnapshotData[CSnapshot::MAX_SIZE];
+		void *pDeltaData = s_SnapshotDelta.EmptyDelta();
+		int DeltaSize = sizeof(int)*3;
+		int CompleteSize = (NumParts-1)*MAX_SNAPSHOT_PACKSIZE + PartSize;
+		if(CompleteSize)
+		{
+			DeltaSize = CVariableInt::Decompress(m_aSnapshotIncommingData, CompleteSize, aDeltaData, sizeof(aDeltaData));
+			if(DeltaSize < 0)
+			{
+				s_Stats.m_DeltaErrors++;
+				return;
+			}
+			pDeltaData = aDeltaData;
+		}
+
+		CSnapshot *pSnapshot = (CSnapshot *)aSnapshotData;
+		int SnapSize = s_SnapshotDelta.UnpackDelta(pDeltaShot, pSnapshot, pDeltaData, DeltaSize);
+		if(SnapSize < 0 || (Msg != NETMSG_SNAPEMPTY && pSnapshot->Crc() != Crc))
+		{
+			s_Stats.m_DeltaErrors++;
+			if(++m_SnapCrcErrors > 10)
+			{
+				m_AckGameTick = -1;
+				m_SnapCrcErrors = 0;
+			}
+			return;
+		}
+		if(m_SnapCrcErrors)
+			m_SnapCrcErrors--;
+
+		// the server takes the acked snapshot or a newer one as delta
+		m_SnapshotStorage.PurgeUntil(min(DeltaTick, m_AckGameTick));
+		m_SnapshotStorage.Add(GameTick, time_get(), SnapSize, pSnapshot, 0);
+
+		s_Stats.m_Snapshots++;
+		if(Msg == NETMSG_SNAPEMPTY)
+			s_Stats.m_EmptySnapshots++;
+		s_Stats.m_PackedBytes += CompleteSize;
+		s_Stats.m_SnapshotBytes += SnapSize;
+		s_Stats.m_MaxPackedSize = max(s_Stats.m_MaxPackedSize, CompleteSize);
+
+		m_CurrentRecvTick = GameTick;
+		m_CurrentRecvTime = time_get();
+		m_AckGameTick = GameTick;
+	}
+
+	void OnPacket(CNetChunk *pPacket)
+	{
+		CUnpacker Unpacker;
+		Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
+
+		// unpack msgid and system flag
+		int Msg = Unpacker.GetInt();
+		int Sys = Msg&1;
+		Msg >>= 1;
+		if(Unpacker.Error())
+			return;
+
+		bool Vital = (pPacket->m_Flags&NET_CHUNKFLAG_VITAL) != 0;
+		if(Sys)
+		{
+			if(Vital && Msg == NETMSG_MAP_CHANGE)
+				OnMapChange(&Unpacker);
+			else if(Vital && Msg == NETMSG_MAP_DATA)
+				OnMapData(&Unpacker);
+			else if(Vital && Msg == NETMSG_CON_READY)
+				OnConnectionReady();
+			else if(Msg == NETMSG_PING)
+			{
+				CMsgPacker Reply(NETMSG_PING_REPLY, true);
+				SendMsg(&Reply, 0);
+			}
+			else if(Msg == NETMSG_PING_REPLY && m_PingStartTime)
+			{
+				int64 Rtt = time_get()-m_PingStartTime;
+				m_PingStartTime = 0;
+				s_Stats.m_Pings++;
+				s_Stats.m_RttSum += Rtt;
+				s_Stats.m_RttMax = max(s_Stats.m_RttMax, Rtt);
+			}
+			else if(Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAPEMPTY)
+				OnSnapshot(Msg, &Unpacker);
+		}
+		else if(Vital && Msg == NETMSGTYPE_SV_READYTOENTER)
+			OnReadyToEnter();
+	}
+
+public:
+	CFakeClient()
+	{
+		m_State = STATE_OFFLINE;
+		m_SnapshotStorage.Init();
+	}
+
+	~CFakeClient()
+	{
+		m_SnapshotStorage.PurgeAll();
+	}
+
+	int State() const { return m_State; }
+	const CNetConnectionStats *NetStats() const { return m_Net.Stats(); }
+
+	bool Connect(int Index, NETADDR *pAddr)
+	{
+		NETADDR BindAddr;
+		mem_zero(&BindAddr, sizeof(BindAddr));
+		BindAddr.type = pAddr->type;
+		if(!m_Net.Open(BindAddr, 0))
+			return false;
+
+		m_Index = Index;
+		str_format(m_aName, sizeof(m_aName), "%s%d", s_pNamePrefix, Index);
+		m_State = STATE_CONNECTING;
+		m_CurrentRecvTick = 0;
+		m_CurrentRecvTime = 0;
+		m_AckGameTick = -1;
+		m_SnapCrcErrors = 0;
+		m_SnapshotParts = 0;
+		m_LastSnapTick = 0;
+		m_LastSnapWasDelta = false;
+		m_SnapStep = 2;
+		mem_zero(&m_Input, sizeof(m_Input));
+		m_PredTick = 0;
+		m_Frame = 0;
+		m_NextChange = 0;
+		m_Seed = Index*7919+1;
+		m_PingStartTime = 0;
+		m_NextPing = 0;
+		m_Net.Connect(pAddr);
+		return true;
+	}
+
+	void Disconnect()
+	{
+		if(m_State == STATE_OFFLINE)
+			return;
+		m_Net.Disconnect("load test done");
+		m_Net.Update();
+		m_Net.Close();
+		m_State = STATE_OFFLINE;
+	}
+
+	void Update()
+	{
+		if(m_State == STATE_OFFLINE)
+			return;
+
+		m_Net.Update();
+		if(m_Net.State() == NETSTATE_OFFLINE)
+		{
+			dbg_msg("fake_clients", "%s disconnected: %s", m_aName, m_Net.ErrorString());
+			m_Net.Close();
+			m_State = STATE_OFFLINE;
+			return;
+		}
+
+		// send the info once the connection is up
+		if(m_State == STATE_CONNECTING && m_Net.State() == NETSTATE_ONLINE)
+		{
+			CMsgPacker Msg(NETMSG_INFO, true);
+			Msg.AddString(GAME_NETVERSION, 128);
+			Msg.AddString(s_pPassword, 128);
+			Msg.AddInt(CLIENT_VERSION);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH);
+			m_State = STATE_LOADING;
+		}
+
+		CNetChunk Packet;
+		while(m_Net.Recv(&Packet))
+		{
+			if(Packet.m_ClientID != -1)
+				OnPacket(&Packet);
+		}
+
+		if(m_State != STATE_INGAME || !m_CurrentRecvTime)
+			return;
+
+		// one input per tick, a few ticks ahead of the last snapshot
+		int64 Now = time_get();
+		int PredTick = m_CurrentRecvTick + (int)((Now-m_CurrentRecvTime)*SERVER_TICK_SPEED/time_freq()) + 3;
+		if(PredTick > m_PredTick)
+		{
+			m_PredTick = PredTick;
+			MakeInput();
+			SendInput();
+		}
+
+		if(Now > m_NextPing)
+		{
+			m_NextPing = Now+s_PingInterval;
+			m_PingStartTime = Now;
+			CMsgPacker Msg(NETMSG_PING, true);
+			SendMsg(&Msg, MSGFLAG_FLUSH);
+		}
+	}
+};
+
+static void Report(CFakeClient *pClients, int NumClients, float Seconds, CLoadStats *pStats)
+{
+	int aStates[CFakeClient::STATE_INGAME+1] = {0};
+	int64 RecvBytes = 0, SentBytes = 0;
+	for(int i = 0; i < NumClients; i++)
+	{
+		aStates[pClients[i].State()]++;
+		RecvBytes += pClients[i].NetStats()->m_RecvBytes;
+		SentBytes += pClients[i].NetStats()->m_SentBytes;
+	}
+
+	float Freq = time_freq()/1000.0f;
+	dbg_msg("fake_clients", "%.0fs: %d in game, %d joining, %d offline | rtt %.1fms avg %.1fms max | %.1f snaps/s per client, %.0f bytes packed avg %d max, %.0f bytes unpacked, %d empty | %d lost, %d delta errors | %.1f kB received %.1f kB sent in total",
+		Seconds, aStates[CFakeClient::STATE_INGAME], NumClients-aStates[CFakeClient::STATE_INGAME]-aStates[CFakeClient::STATE_OFFLINE], aStates[CFakeClient::STATE_OFFLINE],
+		pStats->m_Pings ? pStats->m_RttSum/Freq/pStats->m_Pings : 0.0f, pStats->m_RttMax/Freq,
+		aStates[CFakeClient::STATE_INGAME] && Seconds > 0 ? pStats->m_Snapshots/Seconds/aStates[CFakeClient::STATE_INGAME] : 0.0f,
+		pStats->m_Snapshots ? pStats->m_PackedBytes/(float)pStats->m_Snapshots : 0.0f, pStats->m_MaxPackedSize,
+		pStats->m_Snapshots ? pStats->m_SnapshotBytes/(float)pStats->m_Snapshots : 0.0f, pStats->m_EmptySnapshots,
+		pStats->m_LostSnapshots, pStats->m_DeltaErrors, RecvBytes/1024.0f, SentBytes/1024.0f);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumClients = 16;
+	int Duration = 60;
+	int ConnectInterval = 50;
+	int ReportInterval = 5;
+	const char *pAddress = 0;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-n") == 0 && i+1 < argc) // ignore_convention
+			NumClients = max(1, str_toint(argv[++i])); // ignore_convention
+		else if(str_comp(argv[i], "-t") == 0 && i+1 < argc) // ignore_convention
+			Duration = str_toint(argv[++i]); // ignore_convention
+		else if(str_comp(argv[i], "-i") == 0 && i+1 < argc) // ignore_convention
+			ConnectInterval = max(0, str_toint(argv[++i])); // ignore_convention
+		else if(str_comp(argv[i], "-r") == 0 && i+1 < argc) // ignore_convention
+			ReportInterval = max(1, str_toint(argv[++i])); // ignore_convention
+		else if(str_comp(argv[i], "-p") == 0 && i+1 < argc) // ignore_convention
+			s_pPassword = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-a") == 0 && i+1 < argc) // ignore_convention
+			s_pAccountPassword = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-N") == 0 && i+1 < argc) // ignore_convention
+			s_pNamePrefix = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-d") == 0) // ignore_convention
+			s_DownloadMap = true;
+		else if(str_comp(argv[i], "-R") == 0) // ignore_convention
+			s_RandomInput = true;
+		else
+			pAddress = argv[i]; // ignore_convention
+	}
+
+	net_init();
+	NETADDR Addr;
+	if(!pAddress || net_host_lookup(pAddress, &Addr, NETTYPE_ALL) != 0)
+	{
+		dbg_msg("usage", "%s [-n clients] [-t seconds] [-i connect interval in ms] [-r report interval in seconds] [-p server password] [-a account password] [-N name prefix] [-d] [-R] host[:port]", argv[0]); // ignore_convention
+		dbg_msg("usage", "-d downloads the map, -R sends random inputs instead of the script, -a registers and logs in every client");
+		return -1;
+	}
+	if(!Addr.port)
+		Addr.port = 8303;
+
+	CNetBase::Init();
+	CNetObjHandler NetObjHandler;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		s_SnapshotDelta.SetStaticsize(i, NetObjHandler.GetObjSize(i));
+	s_PingInterval = time_freq();
+
+	CFakeClient *pClients = new CFakeClient[NumClients];
+	CLoadStats Total;
+	Total.Reset();
+	s_Stats.Reset();
+
+	int64 StartTime = time_get();
+	int64 LastReport = StartTime;
+	int NumConnected = 0;
+	while(time_get()-StartTime < Duration*time_freq())
+	{
+		// spread the connects so the handshakes do not all arrive at once
+		int64 Now = time_get();
+		while(NumConnected < NumClients && Now-StartTime >= NumConnected*ConnectInterval*time_freq()/1000)
+		{
+			if(!pClients[NumConnected].Connect(NumConnected, &Addr))
+				dbg_msg("fake_clients", "couldn't open a socket for client %d", NumConnected);
+			NumConnected++;
+		}
+
+		for(int i = 0; i < NumConnected; i++)
+			pClients[i].Update();
+
+		if(Now-LastReport >= ReportInterval*time_freq())
+		{
+			Report(pClients, NumClients, (Now-LastReport)/(float)time_freq(), &s_Stats);
+			Total.Add(&s_Stats);
+			s_Stats.Reset();
+			LastReport = Now;
+		}
+
+		thread_sleep(1);
+	}
+
+	Total.Add(&s_Stats);
+	Report(pClients, NumClients, (time_get()-StartTime)/(float)time_freq(), &Total);
+
+	for(int i = 0; i < NumClients; i++)
+		pClients[i].Disconnect();
+	delete[] pClients;
+	return 0;
+}
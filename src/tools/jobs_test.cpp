@@ -0,0 +1,203 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/threading.h>
+
+#include <engine/shared/jobs.h>
+
+// checks the job pool: dependencies, children, ParallelFor and that WaitFor neither spins
+// forever nor runs unrelated blocking jobs. exits with 1 on the first failure
+
+static int s_Failures = 0;
+
+static void Check(bool Ok, const char *pWhat, int NumThreads)
+{
+	if(!Ok)
+	{
+		dbg_msg("jobs_test", "FAILED with %d threads: %s", NumThreads, pWhat);
+		s_Failures++;
+	}
+}
+
+struct COrderData
+{
+	volatile unsigned *m_pCounter;
+	int m_Order;
+};
+
+static int OrderJob(void *pData)
+{
+	COrderData *pOrder = (COrderData *)pData;
+	pOrder->m_Order = atomic_inc(pOrder->m_pCounter)-1;
+	return pOrder->m_Order;
+}
+
+static int SleepJob(void *pData)
+{
+	thread_sleep(*(int *)pData);
+	return 1;
+}
+
+struct CParentData
+{
+	CJobPool *m_pPool;
+	CJob m_Job;
+	CJob m_aChildren[8];
+	COrderData m_aOrders[8];
+	volatile unsigned m_Counter;
+};
+
+static int ParentJob(void *pData)
+{
+	static int s_Sleep = 20;
+	CParentData *pParent = (CParentData *)pData;
+	CJob *pSelf = &pParent->m_Job;
+	for(int i = 0; i < 8; i++)
+	{
+		pParent->m_aOrders[i].m_pCounter = &pParent->m_Counter;
+		if(i == 0)
+			pParent->m_pPool->Add(&pParent->m_aChildren[i], SleepJob, &s_Sleep, CJobPool::PRIORITY_NORMAL, pSelf);
+		else
+			pParent->m_pPool->Add(&pParent->m_aChildren[i], OrderJob, &pParent->m_aOrders[i], CJobPool::PRIORITY_NORMAL, pSelf);
+	}
+	return 0;
+}
+
+static void CountBatch(void *pUser, int Start, int End)
+{
+	volatile unsigned *pCounts = (volatile unsigned *)pUser;
+	for(int i = Start; i < End; i++)
+		atomic_inc(&pCounts[i]);
+}
+
+static void TestDependencies(CJobPool *pPool, int NumThreads)
+{
+	// waiting for a job that was never added returns right away
+	CJob Unused;
+	pPool->WaitFor(&Unused);
+	Check(Unused.Status() == CJob::STATE_DONE, "waiting for a job that was never added", NumThreads);
+
+	// a chain, every job only runs after the one before it is done
+	enum { CHAIN=16 };
+	volatile unsigned Counter = 0;
+	CJob aJobs[CHAIN];
+	COrderData aOrders[CHAIN];
+	int Sleep = 10;
+	CJob First;
+	pPool->Add(&First, SleepJob, &Sleep);
+	for(int i = 0; i < CHAIN; i++)
+	{
+		aOrders[i].m_pCounter = &Counter;
+		aOrders[i].m_Order = -1;
+		pPool->AddAfter(i == 0 ? &First : &aJobs[i-1], &aJobs[i], OrderJob, &aOrders[i]);
+	}
+	pPool->WaitFor(&aJobs[CHAIN-1]);
+	bool InOrder = true;
+	for(int i = 0; i < CHAIN; i++)
+		InOrder &= aOrders[i].m_Order == i && aJobs[i].Status() == CJob::STATE_DONE;
+	Check(InOrder, "dependency chain out of order", NumThreads);
+
+	// depending on a job that is done already queues right away
+	COrderData Late;
+	Late.m_pCounter = &Counter;
+	CJob LateJob;
+	pPool->AddAfter(&aJobs[0], &LateJob, OrderJob, &Late);
+	pPool->WaitFor(&LateJob);
+	Check(LateJob.Status() == CJob::STATE_DONE && LateJob.Result() == CHAIN, "dependency on a finished job", NumThreads);
+
+	// a parent is only done with all its children
+	CParentData *pParent = new CParentData;
+	pParent->m_pPool = pPool;
+	pParent->m_Counter = 0;
+	pPool->Add(&pParent->m_Job, ParentJob, pParent);
+	pPool->WaitFor(&pParent->m_Job);
+	bool ChildrenDone = pParent->m_Counter == 7;
+	for(int i = 0; i < 8; i++)
+		ChildrenDone &= pParent->m_aChildren[i].Status() == CJob::STATE_DONE;
+	Check(ChildrenDone, "parent done before its children", NumThreads);
+	delete pParent;
+}
+
+static void TestParallelFor(CJobPool *pPool, int NumThreads)
+{
+	static const int s_aNums[] = { 0, 1, 7, 1000, 100000 };
+	static const int s_aMinBatches[] = { 1, 64, 100000 };
+	volatile unsigned *pCounts = new unsigned[100000];
+	for(int n = 0; n < (int)(sizeof(s_aNums)/sizeof(s_aNums[0])); n++)
+	{
+		for(int b = 0; b < (int)(sizeof(s_aMinBatches)/sizeof(s_aMinBatches[0])); b++)
+		{
+			int Num = s_aNums[n];
+			mem_zero((void *)pCounts, sizeof(unsigned)*100000);
+			pPool->ParallelFor(Num, s_aMinBatches[b], CountBatch, (void *)pCounts);
+			bool Once = true;
+			for(int i = 0; i < 100000; i++)
+				Once &= pCounts[i] == (i < Num ? 1u : 0u);
+			char aBuf[128];
+			str_format(aBuf, sizeof(aBuf), "ParallelFor over %d with batches of at least %d", Num, s_aMinBatches[b]);
+			Check(Once, aBuf, NumThreads);
+		}
+	}
+	delete[] pCounts;
+}
+
+static void TestWait(CJobPool *pPool, int NumThreads)
+{
+	if(!NumThreads)
+		return;
+
+	// keep every worker busy with blocking jobs and some more in the queues
+	enum { NUM_BLOCKERS=8 };
+	int Sleep = 200;
+	CJob aBlockers[NUM_BLOCKERS];
+	for(int i = 0; i < NumThreads+NUM_BLOCKERS/2 && i < NUM_BLOCKERS; i++)
+		pPool->Add(&aBlockers[i], SleepJob, &Sleep, CJobPool::PRIORITY_LOW);
+	thread_sleep(10);
+
+	// the caller runs the job it waits for, but none of the queued blocking ones
+	volatile unsigned Counter = 0;
+	COrderData Order;
+	Order.m_pCounter = &Counter;
+	CJob Job;
+	int64 Start = time_get();
+	pPool->Add(&Job, OrderJob, &Order, CJobPool::PRIORITY_LOW);
+	pPool->WaitFor(&Job);
+	int64 Waited = time_get()-Start;
+	Check(Job.Status() == CJob::STATE_DONE, "WaitFor returned early", NumThreads);
+	Check(Waited < time_freq()/10, "WaitFor ran a blocking job on the caller", NumThreads);
+
+	for(int i = 0; i < NumThreads+NUM_BLOCKERS/2 && i < NUM_BLOCKERS; i++)
+		pPool->WaitFor(&aBlockers[i]);
+
+	// a job that already runs on a worker gets waited for by sleeping
+	int Short = 50;
+	CJob Sleeper;
+	pPool->Add(&Sleeper, SleepJob, &Short, CJobPool::PRIORITY_HIGH);
+	thread_sleep(10);
+	Start = time_get();
+	pPool->WaitFor(&Sleeper);
+	Waited = time_get()-Start;
+	Check(Sleeper.Status() == CJob::STATE_DONE && Sleeper.Result() == 1 && Waited < time_freq(), "WaitFor on a running job", NumThreads);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	static const int s_aThreads[] = { 0, 1, 2, 4 };
+	for(int t = 0; t < (int)(sizeof(s_aThreads)/sizeof(s_aThreads[0])); t++)
+	{
+		CJobPool *pPool = new CJobPool;
+		pPool->Init(s_aThreads[t]);
+		TestDependencies(pPool, s_aThreads[t]);
+		TestParallelFor(pPool, s_aThreads[t]);
+		TestWait(pPool, s_aThreads[t]);
+		delete pPool;
+	}
+
+	if(s_Failures)
+		return 1;
+	dbg_msg("jobs_test", "all passed");
+	return 0;
+}